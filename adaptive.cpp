@@ -0,0 +1,456 @@
+// adaptive.cpp
+#include "adaptive.h"
+#include "parallel.h"
+#include "rest.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <glm/gtc/constants.hpp>
+
+namespace {
+
+const int CIRCLE_SEGMENTS = 48;
+const int BATCH_STEPS = 8;              // Steps cut from the local model before the region is updated
+const int SEARCH_ITERATIONS = 10;
+const size_t MAX_PASS_STEPS = 200000;
+const size_t MAX_REGION_STEPS = 5000000;
+const size_t MAX_REGION_PASSES = 100000;
+const int HELIX_SEGMENTS = 24;          // Per revolution of an entry helix
+
+double pathsArea(const ClipperLib::Paths& paths) {
+    double area = 0.0;
+    for (const ClipperLib::Path& path : paths) area += ClipperLib::Area(path);
+    return area / (CLIPPER_SCALE * CLIPPER_SCALE);
+}
+
+ClipperLib::Paths clip(ClipperLib::ClipType type, const ClipperLib::Paths& subject, const ClipperLib::Paths& clipPaths) {
+    ClipperLib::Clipper clipper;
+    clipper.AddPaths(subject, ClipperLib::ptSubject, true);
+    clipper.AddPaths(clipPaths, ClipperLib::ptClip, true);
+    ClipperLib::Paths result;
+    clipper.Execute(type, result, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+    return result;
+}
+
+ClipperLib::Paths offsetRegion(const ClipperLib::Paths& region, float delta, float arcTolerance) {
+    ClipperLib::ClipperOffset offset;
+    offset.ArcTolerance = arcTolerance * CLIPPER_SCALE;
+    offset.AddPaths(region, ClipperLib::jtRound, ClipperLib::etClosedPolygon);
+    ClipperLib::Paths result;
+    offset.Execute(result, delta * CLIPPER_SCALE);
+    return result;
+}
+
+// Area covered by the tool moving along a polyline
+ClipperLib::Paths sweepPolyline(const ClipperLib::Path& line, float radius, float arcTolerance) {
+    ClipperLib::ClipperOffset offset;
+    offset.ArcTolerance = arcTolerance * CLIPPER_SCALE;
+    offset.AddPath(line, ClipperLib::jtRound, ClipperLib::etOpenRound);
+    ClipperLib::Paths result;
+    offset.Execute(result, radius * CLIPPER_SCALE);
+    return result;
+}
+
+ClipperLib::Path circlePath(const glm::vec2& center, float radius) {
+    ClipperLib::Path path(CIRCLE_SEGMENTS);
+    for (int i = 0; i < CIRCLE_SEGMENTS; i++) {
+        float angle = 2.0f * glm::pi<float>() * i / CIRCLE_SEGMENTS;
+        path[i] = toClipperPoint(center + radius * glm::vec2(std::cos(angle), std::sin(angle)));
+    }
+    return path;
+}
+
+ClipperLib::Path boxPath(const glm::vec2& center, float halfSize) {
+    ClipperLib::Path path;
+    path.push_back(toClipperPoint(center + glm::vec2(-halfSize, -halfSize)));
+    path.push_back(toClipperPoint(center + glm::vec2(halfSize, -halfSize)));
+    path.push_back(toClipperPoint(center + glm::vec2(halfSize, halfSize)));
+    path.push_back(toClipperPoint(center + glm::vec2(-halfSize, halfSize)));
+    return path;
+}
+
+// Clipper regions never overlap themselves, so a point is inside when an odd number of
+// their paths (outers and holes) contain it
+bool insideRegion(const ClipperLib::Paths& region, const glm::vec2& point) {
+    ClipperLib::IntPoint p = toClipperPoint(point);
+    int count = 0;
+    for (const ClipperLib::Path& path : region) {
+        if (ClipperLib::PointInPolygon(p, path) != 0) count++;
+    }
+    return count % 2 == 1;
+}
+
+glm::vec2 rotate(const glm::vec2& v, float angle) {
+    float c = std::cos(angle), s = std::sin(angle);
+    return glm::vec2(c * v.x - s * v.y, s * v.x + c * v.y);
+}
+
+// Material of one region on one layer, and everything generated for it
+struct RegionJob {
+    size_t layer = 0;
+    ClipperLib::Paths material;
+    std::vector<Toolpath> toolpaths;
+    AdaptiveStats stats;
+};
+
+struct LayerSetup {
+    ClipperLib::Paths part;
+    ClipperLib::Paths allowed;          // Where the tool centre may go without touching the part
+};
+
+class RegionClearer {
+public:
+    RegionClearer(RegionJob& job, const Layer& layer, const LayerSetup& setup, float safeHeight, const glm::vec2& home, const AdaptiveSettings& settings)
+        : job(job), part(setup.part), allowed(setup.allowed), height(layer.height), rampHeight(std::max(layer.thickness, 0.1f * settings.toolRadius)),
+        safeHeight(safeHeight), position(home), settings(settings) {
+        radius = settings.toolRadius;
+        step = std::max(settings.stepLength, 0.05f) * radius;
+        target = glm::clamp(settings.stepover, 0.01f, 1.0f) * 2.0f * radius;
+        high = target * (1.0f + settings.engagementTolerance);
+        // Climb milling (M3) keeps the material on the tool's right in machine XY. toMachine
+        // mirrors the (x, z) plane used here, so that is the left here: a positive turn.
+        towardMaterial = settings.climb ? 1.0f : -1.0f;
+        arcTolerance = 0.01f * radius;
+        minArea = 0.05f * target * step;
+        remaining = job.material;
+    }
+
+    void run() {
+        size_t stalls = 0;
+        while (job.stats.steps < MAX_REGION_STEPS && job.stats.passes < MAX_REGION_PASSES) {
+            dropSlivers();
+            if (remaining.empty()) break;
+
+            glm::vec2 entry, direction;
+            if (!findEntry(entry, direction)) {
+                if (!helixEntry()) break;   // Nothing left the tool can reach
+                continue;
+            }
+            linkTo(entry);
+            job.stats.passes++;
+            size_t steps = runPass(direction);
+            if (steps == 0) {
+                // Not enough material around this entry to steer along; leave it for the
+                // finishing pass so the next entry search finds somewhere else
+                remaining = clip(ClipperLib::ctDifference, remaining, { circlePath(entry, 1.5f * radius) });
+                if (++stalls > MAX_REGION_PASSES) break;
+            }
+        }
+        closeToolpath();
+    }
+
+private:
+    void dropSlivers() {
+        ClipperLib::CleanPolygons(remaining, 0.001 * radius * CLIPPER_SCALE);
+        double limit = minArea * CLIPPER_SCALE * CLIPPER_SCALE;
+        remaining.erase(std::remove_if(remaining.begin(), remaining.end(), [limit](const ClipperLib::Path& path) {
+            return path.size() < 3 || std::fabs(ClipperLib::Area(path)) < limit;
+        }), remaining.end());
+    }
+
+    // Closest point where the tool touches the remaining material without cutting it. Paths
+    // from Clipper have their area on the left in (x, z), which is where towardMaterial
+    // puts it for climb milling, so climb walks them forwards and conventional backwards.
+    bool findEntry(glm::vec2& entry, glm::vec2& direction) {
+        ClipperLib::Paths touch = offsetRegion(remaining, radius * 1.02f, arcTolerance);
+        float best = std::numeric_limits<float>::max();
+        for (const ClipperLib::Path& path : touch) {
+            for (size_t i = 0; i < path.size(); i++) {
+                glm::vec2 point = fromClipperPoint(path[i]);
+                float distance = glm::distance(point, position);
+                if (distance >= best || !insideRegion(allowed, point)) continue;
+                glm::vec2 next = fromClipperPoint(path[settings.climb ? (i + 1) % path.size() : (i + path.size() - 1) % path.size()]);
+                if (glm::length(next - point) <= 0.0f) continue;
+                best = distance;
+                entry = point;
+                direction = glm::normalize(next - point);
+            }
+        }
+        return best < std::numeric_limits<float>::max();
+    }
+
+    // Material with no open side: ramp down on a helix inside it and clear a starting hole
+    bool helixEntry() {
+        ClipperLib::Paths reachable = clip(ClipperLib::ctIntersection, remaining, allowed);
+        float helixRadius = 0.5f * radius;
+        ClipperLib::Paths core = offsetRegion(reachable, -helixRadius, arcTolerance);
+        const ClipperLib::Paths& candidates = core.empty() ? reachable : core;
+        if (candidates.empty() || candidates.front().empty()) return false;
+        glm::vec2 center = fromClipperPoint(candidates.front().front());
+        if (core.empty()) helixRadius = 0.1f * radius;
+
+        closeToolpath();
+        glm::vec2 start = center + glm::vec2(helixRadius, 0.0f);
+        openToolpath(start, height + rampHeight);
+        const int turns = 2;
+        for (int i = 1; i <= turns * HELIX_SEGMENTS; i++) {
+            // The material is outside the helix, so it turns away from towardMaterial: climb
+            // runs clockwise in (x, z), counter-clockwise (G3) in machine XY
+            float angle = -towardMaterial * 2.0f * glm::pi<float>() * i / HELIX_SEGMENTS;
+            glm::vec2 p = center + helixRadius * glm::vec2(std::cos(angle), std::sin(angle));
+            float z = height + rampHeight * (1.0f - float(i) / (turns * HELIX_SEGMENTS));
+            toolpath().moves.push_back({ MoveType::Linear, glm::vec3(p.x, z, p.y), settings.plungeFeedrate });
+        }
+        position = start;
+        remaining = clip(ClipperLib::ctDifference, remaining, { circlePath(center, helixRadius + radius) });
+        job.stats.passes++;
+        return true;
+    }
+
+    // Stay down when the tool can travel to the entry through cleared space. The whole sweep
+    // is tested against the part, so a link never crosses a wall between two pockets.
+    void linkTo(const glm::vec2& entry) {
+        if (open) {
+            ClipperLib::Path line = { toClipperPoint(position), toClipperPoint(entry) };
+            ClipperLib::Paths swept = sweepPolyline(line, radius * 0.98f, arcTolerance);
+            bool clear = glm::distance(position, entry) < 4.0f * radius
+                && insideRegion(allowed, entry)
+                && pathsArea(clip(ClipperLib::ctIntersection, swept, remaining)) < minArea
+                && clip(ClipperLib::ctIntersection, swept, part).empty();
+            if (clear) {
+                cutTo(entry);
+                return;
+            }
+            closeToolpath();
+        }
+        openToolpath(entry, height);
+    }
+
+    size_t runPass(glm::vec2 direction) {
+        size_t steps = 0;
+        ClipperLib::Path batch = { toClipperPoint(position) };
+        ClipperLib::Paths local = localMaterial();
+
+        while (steps < MAX_PASS_STEPS && job.stats.steps < MAX_REGION_STEPS) {
+            auto engagementAt = [&](float turn, glm::vec2& next) {
+                glm::vec2 d = rotate(direction, towardMaterial * turn);
+                next = position + d * step;
+                if (!insideRegion(allowed, next)) return std::numeric_limits<float>::max();
+                ClipperLib::Paths cut = clip(ClipperLib::ctIntersection, local, { circlePath(next, radius) });
+                return float(pathsArea(cut)) / step;
+            };
+
+            // Turning toward the material increases the engagement, so bisect the turn for
+            // the target. Where even the sharpest turn finds less, follow the material edge.
+            const float maxTurn = 0.5f * glm::pi<float>();
+            glm::vec2 towardNext, awayNext;
+            float towardEngagement = engagementAt(maxTurn, towardNext);
+            if (towardEngagement < 0.1f * target) break;        // Out of material
+            float goal = std::min(target, 0.9f * towardEngagement);
+            float awayEngagement = engagementAt(-maxTurn, awayNext);
+            if (awayEngagement > high) break;                   // Boxed in; try another entry
+
+            glm::vec2 next = awayNext;
+            float engagement = awayEngagement;
+            if (awayEngagement < goal) {
+                float lo = -maxTurn, hi = maxTurn;
+                glm::vec2 loNext = awayNext, hiNext = towardNext;
+                float loEngagement = awayEngagement, hiEngagement = towardEngagement;
+                for (int i = 0; i < SEARCH_ITERATIONS; i++) {
+                    float mid = 0.5f * (lo + hi);
+                    glm::vec2 candidate;
+                    float value = engagementAt(mid, candidate);
+                    if (value >= goal) {
+                        hi = mid;
+                        hiNext = candidate;
+                        hiEngagement = value;
+                        if (value <= goal * (1.0f + settings.engagementTolerance)) break;
+                    }
+                    else {
+                        lo = mid;
+                        loNext = candidate;
+                        loEngagement = value;
+                    }
+                }
+                // The part boundary makes the engagement jump; stay on the valid side of it
+                bool useHigh = hiEngagement <= high;
+                next = useHigh ? hiNext : loNext;
+                engagement = useHigh ? hiEngagement : loEngagement;
+            }
+
+            direction = glm::normalize(next - position);
+            position = next;
+            cutTo(next);
+            local = clip(ClipperLib::ctDifference, local, { circlePath(next, radius) });
+            batch.push_back(toClipperPoint(next));
+            steps++;
+            job.stats.steps++;
+            float fraction = engagement / (2.0f * radius);
+            job.stats.minEngagement = job.stats.maxEngagement == 0.0f ? fraction : std::min(job.stats.minEngagement, fraction);
+            job.stats.maxEngagement = std::max(job.stats.maxEngagement, fraction);
+
+            if (batch.size() > BATCH_STEPS) {
+                commit(batch);
+                batch = { batch.back() };
+                local = localMaterial();
+            }
+        }
+        if (batch.size() > 1) commit(batch);
+        return steps;
+    }
+
+    // Remaining material within reach of the next batch of steps
+    ClipperLib::Paths localMaterial() {
+        float reach = radius * 1.2f + (BATCH_STEPS + 1) * step;
+        return clip(ClipperLib::ctIntersection, remaining, { boxPath(position, reach) });
+    }
+
+    void commit(const ClipperLib::Path& batch) {
+        remaining = clip(ClipperLib::ctDifference, remaining, sweepPolyline(batch, radius, arcTolerance));
+    }
+
+    Toolpath& toolpath() { return job.toolpaths.back(); }
+
+    void openToolpath(const glm::vec2& point, float plungeTo) {
+        job.toolpaths.emplace_back();
+        toolpath().start = glm::vec3(point.x, safeHeight, point.y);
+        toolpath().moves.push_back({ MoveType::Linear, glm::vec3(point.x, plungeTo, point.y), settings.plungeFeedrate });
+        position = point;
+        open = true;
+    }
+
+    void closeToolpath() {
+        if (!open) return;
+        toolpath().moves.push_back({ MoveType::Rapid, glm::vec3(position.x, safeHeight, position.y), 0.0f });
+        open = false;
+    }
+
+    void cutTo(const glm::vec2& point) {
+        toolpath().moves.push_back({ MoveType::Linear, glm::vec3(point.x, height, point.y), settings.feedrate });
+        position = point;
+    }
+
+    RegionJob& job;
+    const ClipperLib::Paths& part;
+    const ClipperLib::Paths& allowed;
+    float height, rampHeight, safeHeight;
+    glm::vec2 position;
+    const AdaptiveSettings& settings;
+    float radius = 0.0f, step = 0.0f, target = 0.0f, high = 0.0f;
+    float towardMaterial = 1.0f, arcTolerance = 0.0f, minArea = 0.0f;
+    ClipperLib::Paths remaining;
+    bool open = false;
+};
+
+// Each outer contour of a PolyTree with its holes; islands inside holes become their own entries
+void collectZones(const ClipperLib::PolyNode& node, std::vector<ClipperLib::Paths>& zones) {
+    for (const ClipperLib::PolyNode* outer : node.Childs) {
+        ClipperLib::Paths zone = { outer->Contour };
+        for (const ClipperLib::PolyNode* hole : outer->Childs) {
+            zone.push_back(hole->Contour);
+            collectZones(*hole, zones);
+        }
+        zones.push_back(zone);
+    }
+}
+
+} // namespace
+
+std::vector<Toolpath> generateAdaptiveToolpaths(const std::vector<Layer>& layers, const AdaptiveSettings& settings, AdaptiveStats* stats,
+    const std::vector<ClipperLib::Paths>* rest) {
+    if (stats) *stats = AdaptiveStats();
+    if (layers.empty() || settings.toolRadius <= 0.0f) return {};
+    if (rest && rest->size() != layers.size()) rest = nullptr;
+
+    // Stock: bounding box of every layer plus the margin
+    glm::vec2 boundsMin(std::numeric_limits<float>::max()), boundsMax(-std::numeric_limits<float>::max());
+    for (const Layer& layer : layers) {
+        for (const Contour& contour : layer.contours) {
+            for (const glm::vec2& p : contour.points) {
+                boundsMin = glm::min(boundsMin, p);
+                boundsMax = glm::max(boundsMax, p);
+            }
+        }
+    }
+    if (boundsMin.x > boundsMax.x) return {};
+    boundsMin -= glm::vec2(settings.stockMargin);
+    boundsMax += glm::vec2(settings.stockMargin);
+    ClipperLib::Paths stock = { {
+        toClipperPoint(boundsMin), toClipperPoint(glm::vec2(boundsMax.x, boundsMin.y)),
+        toClipperPoint(boundsMax), toClipperPoint(glm::vec2(boundsMin.x, boundsMax.y)) } };
+
+    ProfileSettings profile;
+    profile.toolRadius = settings.toolRadius;
+    profile.feedrate = settings.feedrate;
+    profile.plungeFeedrate = settings.plungeFeedrate;
+    profile.clearance = settings.clearance;
+    profile.climb = settings.climb;
+    float safeHeight = profileSafeHeight(layers, profile);
+    float radius = settings.toolRadius;
+    float arcTolerance = 0.01f * radius;
+
+    // Per layer: where the tool may go, the material it can reach, and that material split
+    // into regions whose tool zones do not touch, so they can be cleared independently
+    std::vector<LayerSetup> setups(layers.size());
+    std::vector<std::vector<RegionJob>> layerJobs(layers.size());
+    parallelFor(layers.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            ClipperLib::Clipper clipper;
+            clipper.AddPaths(contoursToClipperPaths(layers[i].contours), ClipperLib::ptSubject, true);
+            ClipperLib::Paths& part = setups[i].part;
+            clipper.Execute(ClipperLib::ctUnion, part, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+
+            ClipperLib::Paths material = clip(ClipperLib::ctDifference, stock, part);
+            setups[i].allowed = clip(ClipperLib::ctDifference, offsetRegion(stock, 1.5f * radius, arcTolerance),
+                offsetRegion(part, radius, arcTolerance));
+            ClipperLib::Paths reachable = clip(ClipperLib::ctIntersection, material, offsetRegion(setups[i].allowed, radius, arcTolerance));
+            if (rest) {
+                reachable = clip(ClipperLib::ctIntersection, reachable, (*rest)[i]);
+            }
+
+            ClipperLib::ClipperOffset offset;
+            offset.ArcTolerance = arcTolerance * CLIPPER_SCALE;
+            offset.AddPaths(reachable, ClipperLib::jtRound, ClipperLib::etClosedPolygon);
+            ClipperLib::PolyTree zoneTree;
+            offset.Execute(zoneTree, radius * CLIPPER_SCALE);
+            std::vector<ClipperLib::Paths> zones;
+            collectZones(zoneTree, zones);
+
+            for (const ClipperLib::Paths& zone : zones) {
+                RegionJob job;
+                job.layer = i;
+                job.material = clip(ClipperLib::ctIntersection, reachable, zone);
+                if (!job.material.empty()) layerJobs[i].push_back(std::move(job));
+            }
+        }
+    }, 1);
+
+    std::vector<RegionJob*> jobs;
+    for (std::vector<RegionJob>& regionJobs : layerJobs) {
+        for (RegionJob& job : regionJobs) jobs.push_back(&job);
+    }
+    parallelFor(jobs.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            RegionJob& job = *jobs[i];
+            RegionClearer clearer(job, layers[job.layer], setups[job.layer], safeHeight, boundsMin, settings);
+            clearer.run();
+        }
+    }, 1);
+
+    // Top layer first; each layer's regions, then its finishing profile
+    std::vector<Toolpath> toolpaths;
+    for (size_t i = layers.size(); i-- > 0;) {
+        for (RegionJob& job : layerJobs[i]) {
+            for (Toolpath& toolpath : job.toolpaths) toolpaths.push_back(std::move(toolpath));
+            if (stats) {
+                stats->regions++;
+                stats->passes += job.stats.passes;
+                stats->steps += job.stats.steps;
+                if (job.stats.maxEngagement > 0.0f) {
+                    stats->minEngagement = stats->maxEngagement == 0.0f ? job.stats.minEngagement : std::min(stats->minEngagement, job.stats.minEngagement);
+                    stats->maxEngagement = std::max(stats->maxEngagement, job.stats.maxEngagement);
+                }
+            }
+        }
+        if (settings.finishPass) {
+            std::vector<Toolpath> finish = generateLayerProfile(layers[i], safeHeight, profile);
+            if (rest) {
+                RestSettings restSettings;
+                restSettings.toolRadius = radius;
+                finish = restrictToRest(finish, layers, *rest, restSettings);
+            }
+            for (Toolpath& toolpath : finish) toolpaths.push_back(std::move(toolpath));
+        }
+    }
+    return toolpaths;
+}
@@ -0,0 +1,44 @@
+// adaptive.h
+#ifndef ADAPTIVE_H
+#define ADAPTIVE_H
+
+#include <vector>
+#include <cstddef>
+#include "slicer.h"
+#include "toolpath.h"
+
+// Adaptive (constant engagement) roughing. The stock is the bounding box of all layers plus
+// a margin; on every layer the material between stock and part is cleared by paths that
+// steer step by step so the tool's radial engagement stays inside a band around the target,
+// instead of following offsets that bury the tool in corners. The remaining material is a
+// Clipper region that is cut away as the tool moves. Regions that the tool cannot reach from
+// one another are independent and generated in parallel, across all layers.
+
+struct AdaptiveSettings {
+    float toolRadius = 3.0f;
+    float stepover = 0.15f;             // Target radial engagement, fraction of the tool diameter
+    float engagementTolerance = 0.3f;   // Accepted deviation from the target, relative
+    float stepLength = 0.25f;           // Distance per steering step, fraction of the tool radius
+    float stockMargin = 2.0f;           // Stock around the bounding box of the layers
+    float feedrate = 2500.0f;           // Units per minute; engagement control allows more than profiling
+    float plungeFeedrate = 300.0f;
+    float clearance = 5.0f;             // Rapid height above the highest layer
+    bool climb = true;
+    bool finishPass = true;             // Profile around the part after clearing each layer
+};
+
+struct AdaptiveStats {
+    size_t regions = 0;
+    size_t passes = 0;                  // Entries into material
+    size_t steps = 0;
+    float minEngagement = 0.0f;         // Over all steps that cut, fraction of the diameter
+    float maxEngagement = 0.0f;
+};
+
+// Adaptive clearing of every layer, top layer first, followed by its finishing profile. With
+// rest material (one region per layer, from computeRestMaterial) only that is cleared and
+// the finishing profile is restricted to it.
+std::vector<Toolpath> generateAdaptiveToolpaths(const std::vector<Layer>& layers, const AdaptiveSettings& settings, AdaptiveStats* stats = nullptr,
+    const std::vector<ClipperLib::Paths>* rest = nullptr);
+
+#endif // ADAPTIVE_H
@@ -0,0 +1,181 @@
+// arcfit.cpp
+#include "arcfit.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Points of a planar run in machine XY, in double precision for the circle fits
+struct RunPoints {
+    std::vector<double> x;
+    std::vector<double> y;
+};
+
+struct FittedArc {
+    double centerX = 0.0;
+    double centerY = 0.0;
+    bool counterClockwise = false;
+};
+
+// Checks whether points first..last lie on one arc within the tolerance. The circle goes
+// through the first, middle and last point; every other point and every chord is then tested.
+bool fitArc(const RunPoints& run, size_t first, size_t last, const ArcFitSettings& settings, FittedArc& arc) {
+    size_t middle = (first + last) / 2;
+    double ox = run.x[first], oy = run.y[first];
+    double bx = run.x[middle] - ox, by = run.y[middle] - oy;
+    double cx = run.x[last] - ox, cy = run.y[last] - oy;
+
+    double d = 2.0 * (bx * cy - by * cx);
+    double span = bx * bx + by * by + cx * cx + cy * cy;
+    if (std::fabs(d) <= 1e-12 * span) return false;   // Collinear
+
+    double b2 = bx * bx + by * by, c2 = cx * cx + cy * cy;
+    double ux = (cy * b2 - by * c2) / d;
+    double uy = (bx * c2 - cx * b2) / d;
+    double radius = std::sqrt(ux * ux + uy * uy);
+    if (radius < settings.minRadius || radius > settings.maxRadius) return false;
+
+    bool counterClockwise = d > 0.0;
+    double tolerance = settings.tolerance;
+    double swept = 0.0;
+    for (size_t k = first; k < last; k++) {
+        double px = run.x[k] - ox - ux, py = run.y[k] - oy - uy;
+        double qx = run.x[k + 1] - ox - ux, qy = run.y[k + 1] - oy - uy;
+
+        if (k > first && std::fabs(std::sqrt(px * px + py * py) - radius) > tolerance) return false;
+
+        // Every step turns the same way and less than half a circle
+        double cross = px * qy - py * qx;
+        if (counterClockwise ? cross <= 0.0 : cross >= 0.0) return false;
+        swept += std::atan2(std::fabs(cross), px * qx + py * qy);
+
+        // The arc bulges away from each chord by its sagitta
+        double chord2 = (qx - px) * (qx - px) + (qy - py) * (qy - py);
+        if (chord2 > 4.0 * radius * radius) return false;
+        if (radius - std::sqrt(radius * radius - 0.25 * chord2) > tolerance) return false;
+    }
+    if (swept >= 2.0 * 3.14159265358979323846 - 1e-3) return false;
+
+    arc.centerX = ox + ux;
+    arc.centerY = oy + uy;
+    arc.counterClockwise = counterClockwise;
+    return true;
+}
+
+// Greedy longest-arc cover of one run. Moves [runBegin, runEnd) of the source are the run and
+// run.x/y hold the start point followed by each move's target.
+void fitRun(const std::vector<ToolpathMove>& moves, size_t runBegin, size_t runEnd, const RunPoints& run, float height,
+    const ArcFitSettings& settings, std::vector<ToolpathMove>& out, size_t& arcs) {
+    size_t count = runEnd - runBegin;
+    size_t minSegments = static_cast<size_t>(std::max(settings.minSegments, 2));
+    size_t k = 0;
+    while (k < count) {
+        FittedArc arc, candidate;
+        size_t best = 0;
+        if (count - k >= minSegments && fitArc(run, k, k + minSegments, settings, arc)) {
+            // Gallop forward, then bisect between the last fit and the first failure
+            size_t lo = k + minSegments, hi = 0, step = minSegments;
+            while (lo < count) {
+                size_t next = std::min(count, lo + step);
+                if (!fitArc(run, k, next, settings, candidate)) {
+                    hi = next;
+                    break;
+                }
+                lo = next;
+                arc = candidate;
+                step *= 2;
+            }
+            while (hi > lo + 1) {
+                size_t mid = (lo + hi) / 2;
+                if (fitArc(run, k, mid, settings, candidate)) {
+                    lo = mid;
+                    arc = candidate;
+                }
+                else {
+                    hi = mid;
+                }
+            }
+            best = lo;
+        }
+
+        if (best == 0) {
+            out.push_back(moves[runBegin + k]);
+            k++;
+            continue;
+        }
+
+        const ToolpathMove& last = moves[runBegin + best - 1];
+        ToolpathMove move;
+        move.type = arc.counterClockwise ? MoveType::ArcCCW : MoveType::ArcCW;
+        move.target = last.target;
+        move.feedrate = last.feedrate;
+        move.center = fromMachine(glm::vec3(static_cast<float>(arc.centerX), static_cast<float>(arc.centerY), height));
+        out.push_back(move);
+        arcs++;
+        k = best;
+    }
+}
+
+Toolpath fitToolpath(const Toolpath& toolpath, const ArcFitSettings& settings, size_t& arcs) {
+    Toolpath result;
+    result.start = toolpath.start;
+    result.moves.reserve(toolpath.moves.size());
+
+    const std::vector<ToolpathMove>& moves = toolpath.moves;
+    RunPoints run;
+    glm::vec3 from = toolpath.start;
+    size_t i = 0;
+    while (i < moves.size()) {
+        // A run is a sequence of linear moves at the height of its start point and one feedrate
+        auto extends = [&](const ToolpathMove& move, float feedrate) {
+            return move.type == MoveType::Linear && move.feedrate == feedrate && std::fabs(move.target.y - from.y) < 1e-6f;
+        };
+        if (!extends(moves[i], moves[i].feedrate)) {
+            result.moves.push_back(moves[i]);
+            from = moves[i].target;
+            i++;
+            continue;
+        }
+
+        size_t runEnd = i;
+        float feedrate = moves[i].feedrate;
+        while (runEnd < moves.size() && extends(moves[runEnd], feedrate)) runEnd++;
+
+        run.x.clear();
+        run.y.clear();
+        glm::vec3 machine = toMachine(from);
+        run.x.push_back(machine.x);
+        run.y.push_back(machine.y);
+        for (size_t m = i; m < runEnd; m++) {
+            machine = toMachine(moves[m].target);
+            run.x.push_back(machine.x);
+            run.y.push_back(machine.y);
+        }
+        fitRun(moves, i, runEnd, run, toMachine(from).z, settings, result.moves, arcs);
+
+        from = moves[runEnd - 1].target;
+        i = runEnd;
+    }
+    return result;
+}
+
+} // namespace
+
+std::vector<Toolpath> fitArcs(const std::vector<Toolpath>& toolpaths, const ArcFitSettings& settings, ArcFitStats* stats) {
+    std::vector<Toolpath> result(toolpaths.size());
+    std::vector<size_t> arcs(toolpaths.size(), 0);
+    parallelFor(toolpaths.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            result[i] = fitToolpath(toolpaths[i], settings, arcs[i]);
+        }
+    }, 1);
+
+    if (stats) {
+        stats->movesIn = countMoves(toolpaths);
+        stats->movesOut = countMoves(result);
+        stats->arcs = 0;
+        for (size_t count : arcs) stats->arcs += count;
+    }
+    return result;
+}
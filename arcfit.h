@@ -0,0 +1,27 @@
+// arcfit.h
+#ifndef ARCFIT_H
+#define ARCFIT_H
+
+#include <vector>
+#include <cstddef>
+#include "toolpath.h"
+
+struct ArcFitSettings {
+    float tolerance = 0.01f;        // Largest distance between the original points/chords and the arc
+    int minSegments = 3;            // Shortest run of linear moves worth replacing
+    float minRadius = 0.05f;        // Smaller arcs are left as lines
+    float maxRadius = 2000.0f;      // Nearly straight runs are left as lines
+};
+
+struct ArcFitStats {
+    size_t movesIn = 0;
+    size_t movesOut = 0;
+    size_t arcs = 0;
+};
+
+// Replaces runs of linear moves with G2/G3 arcs wherever every original point and chord stays
+// within the tolerance of a single arc. Runs must share one height and one feedrate and turn
+// in one direction. Toolpaths are independent and processed in parallel.
+std::vector<Toolpath> fitArcs(const std::vector<Toolpath>& toolpaths, const ArcFitSettings& settings, ArcFitStats* stats = nullptr);
+
+#endif // ARCFIT_H
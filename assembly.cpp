@@ -0,0 +1,112 @@
+// assembly.cpp
+#include "assembly.h"
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+
+AssemblyImporter::AssemblyImporter() : importedFiles(0), failedFiles(0) {
+}
+
+AssemblyImporter::~AssemblyImporter() {
+    pool.reset(); // Finish the running imports before the queue goes away
+}
+
+bool AssemblyImporter::start(const std::vector<std::string>& paths, const ImportSettings& settings) {
+    if (isBusy()) {
+        std::cerr << "Error: An import is already running" << std::endl;
+        return false;
+    }
+    if (paths.empty()) {
+        return false;
+    }
+
+    totalFiles = paths.size();
+    uploadedFiles = 0;
+    importedFiles = 0;
+    failedFiles = 0;
+    uploadQueue.clear();
+
+    // One importer per file; more threads than files would just sit idle
+    unsigned int threads = static_cast<unsigned int>(std::min<size_t>(paths.size(), parallelThreadCount()));
+    pool = std::make_unique<ThreadPool>(threads);
+    for (const std::string& path : paths) {
+        pool->submit([this, path, settings]() {
+            ImportedFile file;
+            file.path = path;
+            if (!importModelData(path, file.meshData, settings)) {
+                std::cerr << "Error: Failed to import " << path << std::endl;
+                failedFiles++;
+            }
+            importedFiles++;
+
+            std::lock_guard<std::mutex> lock(queueMutex);
+            uploadQueue.push_back(std::move(file));
+        });
+    }
+    return true;
+}
+
+bool AssemblyImporter::pumpUploads(std::vector<Mesh>& meshes, size_t byteBudget) {
+    if (!isBusy()) return false;
+
+    size_t uploadedBytes = 0;
+    while (uploadedBytes < byteBudget) {
+        ImportedFile* file = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            if (uploadQueue.empty()) break;
+            file = &uploadQueue.front(); // Only this thread pops, so the element stays valid
+        }
+
+        while (file->nextMesh < file->meshData.size() && uploadedBytes < byteBudget) {
+            MeshData& data = file->meshData[file->nextMesh++];
+            uploadedBytes += data.vertices.size() * sizeof(float) + data.indices.size() * sizeof(unsigned int);
+            Mesh mesh = uploadMesh(std::move(data)); // Leaves nothing behind in the queue
+            if (mesh.VAO) {
+                meshes.push_back(std::move(mesh));
+            }
+        }
+        if (file->nextMesh < file->meshData.size()) break;
+
+        std::cout << "Loaded " << file->path << std::endl;
+        std::lock_guard<std::mutex> lock(queueMutex);
+        uploadQueue.pop_front();
+        uploadedFiles++;
+    }
+
+    if (uploadedFiles == totalFiles) {
+        pool.reset();
+        return true;
+    }
+    return false;
+}
+
+std::vector<std::string> splitFileSelection(const char* selection) {
+    std::vector<std::string> paths;
+    if (!selection) return paths;
+
+    std::string all = selection;
+    size_t start = 0;
+    while (start <= all.size()) {
+        size_t end = all.find('|', start);
+        if (end == std::string::npos) end = all.size();
+        if (end > start) paths.push_back(all.substr(start, end - start));
+        start = end + 1;
+    }
+    return paths;
+}
+
+std::vector<std::string> listModelFiles(const std::string& directory) {
+    std::vector<std::string> paths;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, ec)) {
+        if (!entry.is_regular_file()) continue;
+        std::string extension = entry.path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (extension == ".obj" || extension == ".stl") {
+            paths.push_back(entry.path().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
@@ -0,0 +1,57 @@
+// assembly.h
+#ifndef ASSEMBLY_H
+#define ASSEMBLY_H
+
+#include <vector>
+#include <string>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include "model.h"
+#include "parallel.h"
+
+// Imports a set of model files (fixture plus parts of a job) concurrently. Every file is
+// parsed on a pool thread with its own Assimp importer; the finished mesh data waits in a
+// single queue and is uploaded to OpenGL from the render thread.
+class AssemblyImporter {
+public:
+    AssemblyImporter();
+    ~AssemblyImporter();
+
+    // Start importing; fails if an import is already running. Every file is imported with
+    // the settings as they are now, whatever the UI changes while the import runs.
+    bool start(const std::vector<std::string>& paths, const ImportSettings& settings = importSettings);
+
+    // Upload finished meshes into the mesh list, up to roughly byteBudget bytes per call so
+    // that frames stay short. Returns true on the call that uploads the last file.
+    bool pumpUploads(std::vector<Mesh>& meshes, size_t byteBudget = size_t(64) * 1024 * 1024);
+
+    bool isBusy() const { return pool != nullptr; }
+    size_t filesTotal() const { return totalFiles; }
+    size_t filesImported() const { return importedFiles; }
+    size_t filesFailed() const { return failedFiles; }
+
+private:
+    struct ImportedFile {
+        std::string path;
+        std::vector<MeshData> meshData;
+        size_t nextMesh = 0;        // Meshes before this one are already uploaded
+    };
+
+    std::unique_ptr<ThreadPool> pool;
+    std::mutex queueMutex;
+    std::deque<ImportedFile> uploadQueue;
+    size_t totalFiles = 0;
+    size_t uploadedFiles = 0;
+    std::atomic<size_t> importedFiles;
+    std::atomic<size_t> failedFiles;
+};
+
+// Split a multi-selection from tinyfd_openFileDialog ("a.stl|b.stl") into paths
+std::vector<std::string> splitFileSelection(const char* selection);
+
+// Model files (.obj, .stl) directly inside a directory, sorted by name
+std::vector<std::string> listModelFiles(const std::string& directory);
+
+#endif // ASSEMBLY_H
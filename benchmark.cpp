@@ -0,0 +1,468 @@
+// benchmark.cpp
+#include "benchmark.h"
+#include <GL/glew.h>      // Must be included before other OpenGL headers
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include "callbacks.h"
+#include "camera.h"
+#include "model.h"
+#include "shader.h"
+
+namespace {
+
+// GL context without a window or display server, so the run works headless on CI
+struct BenchContext {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLSurface surface = EGL_NO_SURFACE;
+    EGLContext context = EGL_NO_CONTEXT;
+};
+
+bool hasExtension(const char* extensions, const char* name) {
+    if (!extensions) return false;
+    size_t length = std::strlen(name);
+    for (const char* p = std::strstr(extensions, name); p; p = std::strstr(p + length, name)) {
+        if ((p == extensions || p[-1] == ' ') && (p[length] == ' ' || p[length] == '\0')) return true;
+    }
+    return false;
+}
+
+// Mesa's surfaceless platform needs no display at all; the device platform (NVIDIA) renders
+// on the first GPU. Without either, the default display is used.
+EGLDisplay openDisplay() {
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay && hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display != EGL_NO_DISPLAY) return display;
+    }
+    auto queryDevices = reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(eglGetProcAddress("eglQueryDevicesEXT"));
+    if (getPlatformDisplay && queryDevices && hasExtension(clientExtensions, "EGL_EXT_platform_device")) {
+        EGLDeviceEXT device;
+        EGLint deviceCount = 0;
+        if (queryDevices(1, &device, &deviceCount) && deviceCount > 0) {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, device, nullptr);
+            if (display != EGL_NO_DISPLAY) return display;
+        }
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+void destroyContext(BenchContext& bench) {
+    if (bench.display == EGL_NO_DISPLAY) return;
+    eglMakeCurrent(bench.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (bench.context != EGL_NO_CONTEXT) eglDestroyContext(bench.display, bench.context);
+    if (bench.surface != EGL_NO_SURFACE) eglDestroySurface(bench.display, bench.surface);
+    eglTerminate(bench.display);
+    bench = BenchContext();
+}
+
+// OpenGL 3.3 core context. Everything is drawn into framebuffer objects, so the surface is
+// only a placeholder: a small pbuffer, or none where the driver allows surfaceless contexts.
+bool createContext(BenchContext& bench) {
+    bench.display = openDisplay();
+    if (bench.display == EGL_NO_DISPLAY || !eglInitialize(bench.display, nullptr, nullptr)) {
+        std::cerr << "Error: No EGL display" << std::endl;
+        bench.display = EGL_NO_DISPLAY;
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "Error: EGL does not support desktop OpenGL" << std::endl;
+        destroyContext(bench);
+        return false;
+    }
+
+    EGLint configAttributes[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(bench.display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        configAttributes[1] = EGL_DONT_CARE;
+        if (!eglChooseConfig(bench.display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+            std::cerr << "Error: No EGL config for OpenGL" << std::endl;
+            destroyContext(bench);
+            return false;
+        }
+    }
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    bench.context = eglCreateContext(bench.display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (bench.context == EGL_NO_CONTEXT) {
+        std::cerr << "Error: Could not create an OpenGL 3.3 context" << std::endl;
+        destroyContext(bench);
+        return false;
+    }
+    const EGLint surfaceAttributes[] = { EGL_WIDTH, 16, EGL_HEIGHT, 16, EGL_NONE };
+    bench.surface = eglCreatePbufferSurface(bench.display, config, surfaceAttributes);
+    if (!eglMakeCurrent(bench.display, bench.surface, bench.surface, bench.context)) {
+        std::cerr << "Error: Could not make the EGL context current" << std::endl;
+        destroyContext(bench);
+        return false;
+    }
+    return true;
+}
+
+double nowMs() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Offscreen colour and depth target of one scene
+struct BenchTarget {
+    GLuint framebuffer = 0;
+    GLuint color = 0;
+    GLuint depth = 0;
+};
+
+bool createTarget(BenchTarget& target, int width, int height) {
+    glGenFramebuffers(1, &target.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+
+    glGenRenderbuffers(1, &target.color);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, target.color);
+
+    glGenRenderbuffers(1, &target.depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, target.depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target.depth);
+
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void destroyTarget(BenchTarget& target) {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &target.framebuffer);
+    glDeleteRenderbuffers(1, &target.color);
+    glDeleteRenderbuffers(1, &target.depth);
+    target = BenchTarget();
+}
+
+void deleteMeshes(std::vector<Mesh>& meshes) {
+    for (Mesh& mesh : meshes) {
+        glDeleteVertexArrays(1, &mesh.VAO);
+        glDeleteBuffers(1, &mesh.VBO);
+        glDeleteBuffers(1, &mesh.EBO);
+    }
+    meshes.clear();
+}
+
+// UV sphere of radius 1 resting on the grid, so scenes can run without model files
+MeshData buildSphere(int segments) {
+    MeshData data;
+    int rings = std::max(segments / 2, 2);
+    segments = std::max(segments, 3);
+    for (int ring = 0; ring <= rings; ring++) {
+        float theta = glm::pi<float>() * ring / rings;
+        for (int segment = 0; segment <= segments; segment++) {
+            float phi = 2.0f * glm::pi<float>() * segment / segments;
+            glm::vec3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            glm::vec3 position = normal + glm::vec3(0.0f, 1.0f, 0.0f);
+            data.vertices.insert(data.vertices.end(), { position.x, position.y, position.z, normal.x, normal.y, normal.z });
+        }
+    }
+    for (int ring = 0; ring < rings; ring++) {
+        for (int segment = 0; segment < segments; segment++) {
+            unsigned int a = ring * (segments + 1) + segment;
+            unsigned int b = a + segments + 1;
+            data.indices.insert(data.indices.end(), { a, a + 1, b, a + 1, b + 1, b });
+        }
+    }
+    return data;
+}
+
+bool loadSceneMeshes(const BenchScene& scene, std::vector<Mesh>& meshes) {
+    const std::string builtinSphere = "builtin:sphere:";
+    if (scene.model.compare(0, builtinSphere.size(), builtinSphere) == 0) {
+        meshes.push_back(uploadMesh(buildSphere(std::atoi(scene.model.c_str() + builtinSphere.size()))));
+    }
+    else {
+        loadModel(scene.model, meshes);
+        positionModelOnGrid(meshes);
+    }
+    return !meshes.empty() && meshes.front().VAO != 0;
+}
+
+// Rows top to bottom, RGB
+std::vector<unsigned char> readPixels(int width, int height) {
+    std::vector<unsigned char> pixels(size_t(width) * height * 3);
+    std::vector<unsigned char> row(size_t(width) * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+    for (int y = 0; y < height / 2; y++) {
+        unsigned char* top = &pixels[size_t(y) * width * 3];
+        unsigned char* bottom = &pixels[size_t(height - 1 - y) * width * 3];
+        std::copy(top, top + row.size(), row.begin());
+        std::copy(bottom, bottom + row.size(), top);
+        std::copy(row.begin(), row.end(), bottom);
+    }
+    return pixels;
+}
+
+bool writePPM(const std::string& path, int width, int height, const std::vector<unsigned char>& pixels) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Error: Could not write " << path << std::endl;
+        return false;
+    }
+    out << "P6\n" << width << " " << height << "\n255\n";
+    out.write(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+    return bool(out);
+}
+
+bool readPPM(const std::string& path, int& width, int& height, std::vector<unsigned char>& pixels) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    std::string magic;
+    int maxValue = 0;
+    in >> magic >> width >> height >> maxValue;
+    in.get(); // Single whitespace before the pixel data
+    if (magic != "P6" || maxValue != 255 || width <= 0 || height <= 0) {
+        std::cerr << "Error: " << path << " is not a binary 8-bit PPM" << std::endl;
+        return false;
+    }
+    pixels.resize(size_t(width) * height * 3);
+    in.read(reinterpret_cast<char*>(pixels.data()), pixels.size());
+    return bool(in);
+}
+
+double percentile(std::vector<double> values, double fraction) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = std::min(values.size() - 1, size_t(fraction * (values.size() - 1) + 0.5));
+    return values[index];
+}
+
+// Orbit pose for a point of the run, looking at the centre of the scene bounds
+void placeCamera(Camera& camera, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float yaw, float pitch) {
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float distance = glm::length(boundsMax - boundsMin) * 1.5f;
+    camera.target = center;
+    camera.position = center + distance * glm::vec3(std::cos(glm::radians(pitch)) * std::cos(glm::radians(yaw)),
+        std::sin(glm::radians(pitch)), std::cos(glm::radians(pitch)) * std::sin(glm::radians(yaw)));
+    camera.up = glm::vec3(0.0f, 1.0f, 0.0f);
+}
+
+BenchResult runScene(ShaderManager& shaders, const BenchScene& scene, bool record) {
+    BenchResult result;
+
+    std::vector<Mesh> meshes;
+    if (!loadSceneMeshes(scene, meshes)) {
+        std::cerr << "Error: Could not load " << scene.model << std::endl;
+        deleteMeshes(meshes);
+        return result;
+    }
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+    for (const Mesh& mesh : meshes) {
+        glm::vec3 min, max;
+        computeBoundingBox(mesh, min, max);
+        boundsMin = glm::min(boundsMin, min);
+        boundsMax = glm::max(boundsMax, max);
+    }
+
+    BenchTarget target;
+    if (!createTarget(target, scene.width, scene.height)) {
+        std::cerr << "Error: Offscreen framebuffer is not complete" << std::endl;
+        destroyTarget(target);
+        deleteMeshes(meshes);
+        return result;
+    }
+    glViewport(0, 0, scene.width, scene.height);
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+
+    Camera camera(glm::vec3(5.0f, 5.0f, 5.0f), glm::vec3(0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(camera.fov), float(scene.width) / float(scene.height), 0.1f, 100.0f);
+    GLuint program = shaders.program(SHADER_DEFAULT);
+    GLuint query = 0;
+    glGenQueries(1, &query);
+
+    int totalFrames = scene.warmup + scene.frames;
+    for (int frame = 0; frame < totalFrames; frame++) {
+        // The last frame returns to the start pose, which is what the reference shows
+        float t = frame + 1 < totalFrames ? float(frame) / float(totalFrames) : 0.0f;
+        placeCamera(camera, boundsMin, boundsMax, -45.0f + scene.orbit * t, scene.pitch);
+
+        renderStats = RenderStats();
+        double start = nowMs();
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        renderScene(nullptr, program, meshes, camera, 1.0f, glm::vec3(1.0f), glm::vec3(1.2f, 1.0f, 2.0f), glm::vec3(1.0f, 0.5f, 0.2f), projection);
+        glEndQuery(GL_TIME_ELAPSED);
+        glFinish();
+        double cpuMs = nowMs() - start;
+
+        GLuint64 gpuNs = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &gpuNs);
+        if (frame >= scene.warmup) {
+            result.cpuMs.push_back(cpuMs);
+            result.gpuMs.push_back(gpuNs / 1.0e6);
+        }
+        result.drawCalls = std::max(result.drawCalls, renderStats.drawCalls);
+        result.triangles = std::max(result.triangles, renderStats.triangles);
+    }
+    glDeleteQueries(1, &query);
+
+    result.passed = true;
+    if (scene.budgetMs > 0.0f && percentile(result.cpuMs, 0.95) > scene.budgetMs) result.passed = false;
+    if (scene.maxDraws > 0 && result.drawCalls > scene.maxDraws) result.passed = false;
+    if (scene.maxTriangles > 0 && result.triangles > scene.maxTriangles) result.passed = false;
+
+    result.imageDifference = -1.0;
+    if (!scene.reference.empty()) {
+        std::vector<unsigned char> pixels = readPixels(scene.width, scene.height);
+        int referenceWidth = 0, referenceHeight = 0;
+        std::vector<unsigned char> reference;
+        if (record) {
+            std::cout << "Recording reference " << scene.reference << std::endl;
+            if (!writePPM(scene.reference, scene.width, scene.height, pixels)) result.passed = false;
+        }
+        else if (!readPPM(scene.reference, referenceWidth, referenceHeight, reference)) {
+            // A lost reference must not turn the image check off
+            std::cerr << "Error: Missing reference " << scene.reference << " (run with --record to create it)" << std::endl;
+            writePPM(scene.reference + ".actual.ppm", scene.width, scene.height, pixels);
+            result.passed = false;
+        }
+        else if (referenceWidth != scene.width || referenceHeight != scene.height) {
+            std::cerr << "Error: " << scene.reference << " is " << referenceWidth << "x" << referenceHeight << std::endl;
+            result.passed = false;
+        }
+        else {
+            unsigned long long sum = 0;
+            for (size_t i = 0; i < pixels.size(); i++) {
+                sum += std::abs(int(pixels[i]) - int(reference[i]));
+            }
+            result.imageDifference = double(sum) / double(pixels.size());
+            if (result.imageDifference > scene.tolerance) {
+                result.passed = false;
+                writePPM(scene.reference + ".actual.ppm", scene.width, scene.height, pixels);
+            }
+        }
+    }
+
+    destroyTarget(target);
+    deleteMeshes(meshes);
+    return result;
+}
+
+} // namespace
+
+bool loadBenchScenes(const std::string& path, std::vector<BenchScene>& scenes) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Error: Could not open " << path << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        BenchScene scene;
+        if (!(words >> scene.name)) continue;
+        if (!(words >> scene.model)) {
+            std::cerr << "Error: " << path << ":" << lineNumber << ": missing model" << std::endl;
+            return false;
+        }
+
+        std::string word;
+        while (words >> word) {
+            size_t equals = word.find('=');
+            if (equals == std::string::npos) {
+                std::cerr << "Error: " << path << ":" << lineNumber << ": expected key=value, got " << word << std::endl;
+                return false;
+            }
+            std::string key = word.substr(0, equals);
+            std::string value = word.substr(equals + 1);
+            if (key == "frames") scene.frames = std::max(1, std::atoi(value.c_str()));
+            else if (key == "warmup") scene.warmup = std::max(0, std::atoi(value.c_str()));
+            else if (key == "width") scene.width = std::max(1, std::atoi(value.c_str()));
+            else if (key == "height") scene.height = std::max(1, std::atoi(value.c_str()));
+            else if (key == "orbit") scene.orbit = float(std::atof(value.c_str()));
+            else if (key == "pitch") scene.pitch = float(std::atof(value.c_str()));
+            else if (key == "budget_ms") scene.budgetMs = float(std::atof(value.c_str()));
+            else if (key == "max_draws") scene.maxDraws = unsigned(std::strtoul(value.c_str(), nullptr, 10));
+            else if (key == "max_triangles") scene.maxTriangles = std::strtoull(value.c_str(), nullptr, 10);
+            else if (key == "reference") scene.reference = value;
+            else if (key == "tolerance") scene.tolerance = float(std::atof(value.c_str()));
+            else {
+                std::cerr << "Error: " << path << ":" << lineNumber << ": unknown key " << key << std::endl;
+                return false;
+            }
+        }
+        scenes.push_back(scene);
+    }
+    return true;
+}
+
+int runBenchmark(const std::string& scenePath, bool record) {
+    std::vector<BenchScene> scenes;
+    if (!loadBenchScenes(scenePath, scenes)) {
+        return 2;
+    }
+    if (scenes.empty()) {
+        std::cerr << "Error: No scenes in " << scenePath << std::endl;
+        return 2;
+    }
+
+    // Without a GPU, Mesa's llvmpipe serves the context (LIBGL_ALWAYS_SOFTWARE=1 forces it
+    // for stable images)
+    BenchContext bench;
+    if (!createContext(bench)) {
+        return 2;
+    }
+
+    // GLEW built without EGL support loads the GL entry points and then fails looking for
+    // a GLX display, which this context does not need
+    glewExperimental = GL_TRUE;
+    GLenum err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    if (err == GLEW_ERROR_NO_GLX_DISPLAY) err = GLEW_OK;
+#endif
+    if (err != GLEW_OK) {
+        std::cerr << "Failed to initialize GLEW: " << glewGetErrorString(err) << std::endl;
+        destroyContext(bench);
+        return 2;
+    }
+    std::cout << "Renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+    ShaderManager shaders;
+    shaders.init("shader_cache", "shaders");
+
+    int failures = 0;
+    for (const BenchScene& scene : scenes) {
+        BenchResult result = runScene(shaders, scene, record);
+        if (!result.passed) failures++;
+
+        char line[512];
+        snprintf(line, sizeof(line),
+            "%-16s cpu %.2f / %.2f / %.2f ms, gpu %.2f / %.2f ms (median / p95 / max), %u draws, %llu triangles, image %s -> %s",
+            scene.name.c_str(), percentile(result.cpuMs, 0.5), percentile(result.cpuMs, 0.95), percentile(result.cpuMs, 1.0),
+            percentile(result.gpuMs, 0.5), percentile(result.gpuMs, 0.95), result.drawCalls, result.triangles,
+            result.imageDifference < 0.0 ? "n/a" : std::to_string(result.imageDifference).c_str(),
+            result.passed ? "PASS" : "FAIL");
+        std::cout << line << std::endl;
+    }
+
+    shaders.release();
+    destroyContext(bench);
+
+    std::cout << scenes.size() - failures << " / " << scenes.size() << " scenes passed" << std::endl;
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,58 @@
+// benchmark.h
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <string>
+#include <vector>
+
+// Headless render regression run, started with "--bench [scenes.txt] [--record]" or by the
+// test target. Each scene is loaded into an EGL context that needs no window or display,
+// rendered with renderScene into an offscreen framebuffer along a scripted orbit, and
+// checked against its budgets and a reference image.
+//
+// Scene file, one scene per line ('#' starts a comment):
+//   <name> <model path | builtin:sphere:<segments>> [key=value ...]
+// Keys:
+//   frames, warmup          Timed and untimed frames (120, 10)
+//   width, height           Framebuffer size (640, 360)
+//   orbit, pitch            Degrees the camera orbits during the run, elevation (360, 30)
+//   budget_ms               Limit for the 95th percentile frame time (0 = none)
+//   max_draws, max_triangles  Limits per frame (0 = none)
+//   reference               Binary PPM compared with the last frame. A missing reference fails
+//                           the scene; --record writes every reference from this run instead.
+//   tolerance               Allowed mean absolute channel difference, 0-255 (2)
+
+struct BenchScene {
+    std::string name;
+    std::string model;
+    int frames = 120;
+    int warmup = 10;
+    int width = 640;
+    int height = 360;
+    float orbit = 360.0f;
+    float pitch = 30.0f;
+    float budgetMs = 0.0f;
+    unsigned int maxDraws = 0;
+    unsigned long long maxTriangles = 0;
+    std::string reference;
+    float tolerance = 2.0f;
+};
+
+struct BenchResult {
+    std::vector<double> cpuMs;          // Wall time per frame, submission to glFinish
+    std::vector<double> gpuMs;          // GL_TIME_ELAPSED per frame
+    unsigned int drawCalls = 0;         // Per frame
+    unsigned long long triangles = 0;
+    double imageDifference = 0.0;       // Mean absolute channel difference, -1 when not compared
+    bool passed = false;
+};
+
+// Reads a scene file; returns false with a message on a malformed line
+bool loadBenchScenes(const std::string& path, std::vector<BenchScene>& scenes);
+
+// Runs every scene and prints one result line each. Returns the process exit code:
+// 0 when all scenes pass, 1 when any budget or image check fails, 2 on setup errors.
+// With record, the last frames are saved as the new references instead of compared.
+int runBenchmark(const std::string& scenePath, bool record = false);
+
+#endif // BENCHMARK_H
@@ -17,6 +17,7 @@ glm::vec3 dragStartPosition;
 glm::vec3 selectedObjectPosition;
 glm::vec3 dragAxis;
 extern Camera camera;
+RenderStats renderStats;
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
     if (button == GLFW_MOUSE_BUTTON_RIGHT) {
@@ -119,13 +120,18 @@ glm::vec3 GetWorldCoordinatesAtMousePosition(GLFWwindow* window) {
 
 void renderScene(GLFWwindow* window, GLuint shaderProgram, const std::vector<Mesh>& meshes, Camera& camera,
     float lightIntensity, glm::vec3 lightColor, glm::vec3 lightPos, glm::vec3 objectColor) {
+    glm::mat4 projection = glm::perspective(glm::radians(camera.fov), 1280.0f / 720.0f, 0.1f, 100.0f);
+    renderScene(window, shaderProgram, meshes, camera, lightIntensity, lightColor, lightPos, objectColor, projection);
+}
+
+void renderScene(GLFWwindow* window, GLuint shaderProgram, const std::vector<Mesh>& meshes, Camera& camera,
+    float lightIntensity, glm::vec3 lightColor, glm::vec3 lightPos, glm::vec3 objectColor, const glm::mat4& projection) {
     // Clear the screen and set up shader program
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glUseProgram(shaderProgram);
 
-    // Update the view and projection matrices
+    // Update the view matrix
     glm::mat4 view = camera.GetViewMatrix();
-    glm::mat4 projection = glm::perspective(glm::radians(camera.fov), 1280.0f / 720.0f, 0.1f, 100.0f);
 
     // Set the shader uniforms
     glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
@@ -142,7 +148,9 @@ void renderScene(GLFWwindow* window, GLuint shaderProgram, const std::vector<Mes
         glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
 
         glBindVertexArray(mesh.VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(mesh.indices.size()), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
+        renderStats.drawCalls++;
+        renderStats.triangles += mesh.indexCount / 3;
     }
 }
@@ -18,8 +18,22 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 
+// Work submitted by renderScene since the last reset; reset once per frame to read a frame's work
+struct RenderStats {
+    unsigned int drawCalls = 0;
+    unsigned long long triangles = 0;
+};
+
+extern RenderStats renderStats;
+
+// Translation renderScene applies to the meshes (moved by dragging)
+extern glm::vec3 selectedObjectPosition;
+
 // Render the scene (includes shader, model, and camera updates)
 void renderScene(GLFWwindow* window, GLuint shaderProgram, const std::vector<Mesh>& meshes, Camera& camera,float lightIntensity, glm::vec3 lightColor, glm::vec3 lightPos, glm::vec3 objectColor);
 
+// Render the scene with an explicit projection matrix (offscreen tiles, screenshots)
+void renderScene(GLFWwindow* window, GLuint shaderProgram, const std::vector<Mesh>& meshes, Camera& camera, float lightIntensity, glm::vec3 lightColor, glm::vec3 lightPos, glm::vec3 objectColor, const glm::mat4& projection);
+
 glm::vec3 GetWorldCoordinatesAtMousePosition(GLFWwindow* window);
 #endif // CALLBACKS_H
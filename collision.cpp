@@ -0,0 +1,324 @@
+// collision.cpp
+#include "collision.h"
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const unsigned int LEAF_TRIANGLES = 4;
+const int MAX_RAMP_PIECES = 1000;
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+float cross(const glm::vec2& a, const glm::vec2& b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+float pointSegmentDistance2(const glm::vec2& p, const glm::vec2& a, const glm::vec2& b) {
+    glm::vec2 ab = b - a;
+    float length2 = glm::dot(ab, ab);
+    float t = length2 > 0.0f ? glm::clamp(glm::dot(p - a, ab) / length2, 0.0f, 1.0f) : 0.0f;
+    glm::vec2 d = p - (a + t * ab);
+    return glm::dot(d, d);
+}
+
+float segmentDistance2(const glm::vec2& a, const glm::vec2& b, const glm::vec2& c, const glm::vec2& d) {
+    // Proper crossing
+    float d1 = cross(b - a, c - a), d2 = cross(b - a, d - a);
+    float d3 = cross(d - c, a - c), d4 = cross(d - c, b - c);
+    if (((d1 > 0.0f && d2 < 0.0f) || (d1 < 0.0f && d2 > 0.0f)) && ((d3 > 0.0f && d4 < 0.0f) || (d3 < 0.0f && d4 > 0.0f))) {
+        return 0.0f;
+    }
+    return std::min(std::min(pointSegmentDistance2(a, c, d), pointSegmentDistance2(b, c, d)),
+        std::min(pointSegmentDistance2(c, a, b), pointSegmentDistance2(d, a, b)));
+}
+
+// Sutherland-Hodgman against one horizontal plane; keeps the side above (or below) it
+int clipPolygon(const glm::vec3* in, int count, glm::vec3* out, float level, bool keepAbove) {
+    int result = 0;
+    for (int i = 0; i < count; i++) {
+        const glm::vec3& a = in[i];
+        const glm::vec3& b = in[(i + 1) % count];
+        float da = keepAbove ? a.y - level : level - a.y;
+        float db = keepAbove ? b.y - level : level - b.y;
+        if (da >= 0.0f) out[result++] = a;
+        if ((da >= 0.0f) != (db >= 0.0f)) out[result++] = a + (b - a) * (da / (da - db));
+    }
+    return result;
+}
+
+// Whether a triangle meets the volume swept by a vertical cylinder moving along a horizontal
+// segment: the part of the triangle inside the slab, seen from above, within the radius of
+// the segment
+bool triangleHitsSweep(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c,
+    const glm::vec2& from, const glm::vec2& to, float radius, float bottom, float top) {
+    glm::vec3 triangle[3] = { a, b, c };
+    glm::vec3 clipped[4], slab[5];
+    int count = clipPolygon(triangle, 3, clipped, bottom, true);
+    count = clipPolygon(clipped, count, slab, top, false);
+    if (count == 0) return false;
+
+    glm::vec2 polygon[5];
+    for (int i = 0; i < count; i++) polygon[i] = glm::vec2(slab[i].x, slab[i].z);
+
+    // Segment inside the polygon (convex, either winding)
+    if (count >= 3) {
+        bool positive = false, negative = false;
+        for (int i = 0; i < count; i++) {
+            float side = cross(polygon[(i + 1) % count] - polygon[i], from - polygon[i]);
+            positive |= side > 0.0f;
+            negative |= side < 0.0f;
+        }
+        if (positive != negative) return true;
+    }
+
+    float radius2 = radius * radius;
+    if (count == 1) return pointSegmentDistance2(polygon[0], from, to) <= radius2;
+    for (int i = 0; i < count; i++) {
+        if (segmentDistance2(from, to, polygon[i], polygon[(i + 1) % count]) <= radius2) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+void CollisionChecker::setGeometry(std::vector<Mesh>& meshes) {
+    positions.clear();
+    indices.clear();
+    nodes.clear();
+    geometryDirty = true;
+    if (meshes.empty()) return;
+
+    // Own copy of the positions, so released mesh copies can be dropped again and checks
+    // never read meshes back from the GPU
+    ensureCpuCopies(meshes);
+    size_t vertexCount = 0, indexCount = 0;
+    for (const Mesh& mesh : meshes) {
+        vertexCount += mesh.vertices.size() / 6;
+        indexCount += mesh.indices.size() / 3 * 3;
+    }
+    positions.reserve(vertexCount);
+    indices.reserve(indexCount);
+    for (const Mesh& mesh : meshes) {
+        unsigned int base = static_cast<unsigned int>(positions.size());
+        for (size_t i = 0; i + 5 < mesh.vertices.size(); i += 6) {
+            positions.emplace_back(mesh.vertices[i], mesh.vertices[i + 1], mesh.vertices[i + 2]);
+        }
+        size_t usable = mesh.indices.size() / 3 * 3;
+        for (size_t i = 0; i < usable; i++) {
+            indices.push_back(base + mesh.indices[i]);
+        }
+    }
+    applyMemoryPolicy(meshes);
+}
+
+void CollisionChecker::clear() {
+    geometryDirty = false;
+    positions.clear();
+    indices.clear();
+    nodes.clear();
+    buildMs = 0.0;
+}
+
+void CollisionChecker::build() {
+    auto start = std::chrono::steady_clock::now();
+    geometryDirty = false;
+    nodes.clear();
+    unsigned int triangles = static_cast<unsigned int>(indices.size() / 3);
+    if (triangles == 0) return;
+    std::vector<glm::vec3> centroids(triangles);
+    parallelFor(triangles, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            centroids[i] = (positions[indices[3 * i]] + positions[indices[3 * i + 1]] + positions[indices[3 * i + 2]]) / 3.0f;
+        }
+    });
+    std::vector<unsigned int> order(triangles);
+    for (unsigned int i = 0; i < triangles; i++) order[i] = i;
+
+    nodes.reserve(2 * (triangles / LEAF_TRIANGLES) + 1);
+    buildNode(order, centroids, 0, triangles);
+
+    // Store the triangles in leaf order so leaves read them contiguously
+    std::vector<unsigned int> sorted(indices.size());
+    parallelFor(triangles, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            for (int k = 0; k < 3; k++) sorted[3 * i + k] = indices[3 * order[i] + k];
+        }
+    });
+    indices.swap(sorted);
+    buildMs = millisecondsSince(start);
+}
+
+// Median split on the axis with the widest spread of centroids; bounds are filled bottom-up
+unsigned int CollisionChecker::buildNode(std::vector<unsigned int>& order, const std::vector<glm::vec3>& centroids, unsigned int begin, unsigned int end) {
+    unsigned int index = static_cast<unsigned int>(nodes.size());
+    nodes.emplace_back();
+
+    glm::vec3 centroidMin(std::numeric_limits<float>::max()), centroidMax(-std::numeric_limits<float>::max());
+    for (unsigned int i = begin; i < end; i++) {
+        centroidMin = glm::min(centroidMin, centroids[order[i]]);
+        centroidMax = glm::max(centroidMax, centroids[order[i]]);
+    }
+    glm::vec3 extent = centroidMax - centroidMin;
+    int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : extent.y >= extent.z ? 1 : 2;
+
+    if (end - begin <= LEAF_TRIANGLES || extent[axis] <= 0.0f) {
+        Node& leaf = nodes[index];
+        leaf.first = begin;
+        leaf.count = end - begin;
+        leaf.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        leaf.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+        for (unsigned int i = begin; i < end; i++) {
+            for (int k = 0; k < 3; k++) {
+                const glm::vec3& p = positions[indices[3 * order[i] + k]];
+                leaf.boundsMin = glm::min(leaf.boundsMin, p);
+                leaf.boundsMax = glm::max(leaf.boundsMax, p);
+            }
+        }
+        return index;
+    }
+
+    unsigned int middle = begin + (end - begin) / 2;
+    std::nth_element(order.begin() + begin, order.begin() + middle, order.begin() + end,
+        [&](unsigned int a, unsigned int b) { return centroids[a][axis] < centroids[b][axis]; });
+    unsigned int left = buildNode(order, centroids, begin, middle);
+    unsigned int right = buildNode(order, centroids, middle, end);
+
+    Node& node = nodes[index];
+    node.first = right;
+    node.count = 0;
+    node.boundsMin = glm::min(nodes[left].boundsMin, nodes[right].boundsMin);
+    node.boundsMax = glm::max(nodes[left].boundsMax, nodes[right].boundsMax);
+    return index;
+}
+
+bool CollisionChecker::sweepHits(const glm::vec2& from, const glm::vec2& to, float radius, float bottom, float top) const {
+    glm::vec3 queryMin(std::min(from.x, to.x) - radius, bottom, std::min(from.y, to.y) - radius);
+    glm::vec3 queryMax(std::max(from.x, to.x) + radius, top, std::max(from.y, to.y) + radius);
+
+    unsigned int stack[64];
+    int size = 0;
+    stack[size++] = 0;
+    while (size > 0) {
+        const Node& node = nodes[stack[--size]];
+        if (node.boundsMax.x < queryMin.x || node.boundsMax.y < queryMin.y || node.boundsMax.z < queryMin.z ||
+            node.boundsMin.x > queryMax.x || node.boundsMin.y > queryMax.y || node.boundsMin.z > queryMax.z) {
+            continue;
+        }
+        if (node.count > 0) {
+            for (unsigned int t = node.first; t < node.first + node.count; t++) {
+                if (triangleHitsSweep(positions[indices[3 * t]], positions[indices[3 * t + 1]], positions[indices[3 * t + 2]],
+                    from, to, radius, bottom, top)) {
+                    return true;
+                }
+            }
+            continue;
+        }
+        stack[size++] = static_cast<unsigned int>(&node - nodes.data()) + 1;
+        stack[size++] = node.first;
+    }
+    return false;
+}
+
+CollisionReport CollisionChecker::check(const std::vector<Toolpath>& toolpaths, const CollisionSettings& settings, const std::atomic<bool>* cancel) {
+    auto start = std::chrono::steady_clock::now();
+    if (geometryDirty) build();
+
+    CollisionReport report;
+    struct MoveRef {
+        glm::vec3 from;
+        const ToolpathMove* move;
+    };
+    std::vector<MoveRef> moves;
+    moves.reserve(countMoves(toolpaths));
+    for (const Toolpath& toolpath : toolpaths) {
+        glm::vec3 from = toolpath.start;
+        for (const ToolpathMove& move : toolpath.moves) {
+            moves.push_back({ from, &move });
+            from = move.target;
+        }
+    }
+    report.moves.assign(moves.size(), 0);
+    if (nodes.empty() || moves.empty()) {
+        report.ms = millisecondsSince(start);
+        return report;
+    }
+
+    // Heights are relative to the tool tip. The flutes start just above the tip and are
+    // narrowed by the tolerance, so floors under the tip and tangent walls do not count.
+    struct Component {
+        float bottom;
+        float top;
+        float radius;
+        char part;
+    };
+    const ToolAssembly& tool = settings.tool;
+    const Component components[3] = {
+        { settings.tolerance, tool.fluteLength, tool.toolRadius - settings.tolerance, COLLISION_TOOL },
+        { tool.fluteLength, tool.stickout, tool.shankRadius + settings.clearance, COLLISION_SHANK },
+        { tool.stickout, tool.stickout + tool.holderLength, tool.holderRadius + settings.clearance, COLLISION_HOLDER }
+    };
+    const char allParts = COLLISION_TOOL | COLLISION_SHANK | COLLISION_HOLDER;
+    float rise = std::max(0.05f, 0.25f * tool.toolRadius);   // Height change per checked piece of a ramp
+
+    std::atomic<bool> found{ false };
+    std::atomic<bool> skipped{ false };
+    parallelFor(moves.size(), [&](size_t begin, size_t end) {
+        std::vector<glm::vec3> points;
+        for (size_t i = begin; i < end; i++) {
+            if ((settings.stopAtFirst && found.load(std::memory_order_relaxed)) || (cancel && cancel->load(std::memory_order_relaxed))) {
+                skipped.store(true, std::memory_order_relaxed);
+                break;
+            }
+            const ToolpathMove& move = *moves[i].move;
+            points.clear();
+            if (isArc(move.type)) {
+                interpolateArc(moves[i].from, move, settings.arcTolerance, points);
+            }
+            else {
+                points.push_back(move.target);
+            }
+
+            char hits = 0;
+            glm::vec3 a = moves[i].from;
+            for (const glm::vec3& b : points) {
+                float horizontal = glm::length(glm::vec2(b.x - a.x, b.z - a.z));
+                float dy = std::fabs(b.y - a.y);
+                int pieces = horizontal > 0.0f && dy > rise ? std::min(MAX_RAMP_PIECES, static_cast<int>(std::ceil(dy / rise))) : 1;
+                for (int k = 0; k < pieces && hits != allParts; k++) {
+                    glm::vec3 p0 = glm::mix(a, b, float(k) / pieces);
+                    glm::vec3 p1 = glm::mix(a, b, float(k + 1) / pieces);
+                    float low = std::min(p0.y, p1.y), high = std::max(p0.y, p1.y);
+                    for (const Component& component : components) {
+                        if ((hits & component.part) || component.top <= component.bottom || component.radius <= 0.0f) continue;
+                        if (sweepHits(glm::vec2(p0.x, p0.z), glm::vec2(p1.x, p1.z), component.radius, low + component.bottom, high + component.top)) {
+                            hits |= component.part;
+                        }
+                    }
+                }
+                if (hits == allParts) break;
+                a = b;
+            }
+            report.moves[i] = hits;
+            if (hits) found.store(true, std::memory_order_relaxed);
+        }
+    }, 64);
+
+    for (char hits : report.moves) {
+        if (!hits) continue;
+        report.collidingMoves++;
+        if (hits & COLLISION_TOOL) report.toolHits++;
+        if (hits & COLLISION_SHANK) report.shankHits++;
+        if (hits & COLLISION_HOLDER) report.holderHits++;
+    }
+    report.complete = !skipped.load();
+    report.cancelled = cancel && cancel->load();
+    report.ms = millisecondsSince(start);
+    return report;
+}
@@ -0,0 +1,91 @@
+// collision.h
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "model.h"
+#include "toolpath.h"
+
+// Checks toolpaths for collisions of the tool assembly with every loaded mesh (the part and
+// any fixtures or clamps). The assembly is a stack of vertical cylinders: flutes, shank and
+// holder. A move sweeps each cylinder along its segment; for moves at one height the swept
+// volume is a slab whose cross-section is the segment widened by the radius, and that is
+// tested exactly against triangles clipped to the slab. Ramps are split so their slabs stay
+// thin. Triangles are kept in a bounding volume hierarchy that is built once per geometry,
+// and moves are checked in parallel batches, each move stopping at its first hit. A check
+// touches only the checker's own copy of the geometry, so it can run on a worker thread.
+
+struct ToolAssembly {
+    float toolRadius = 3.0f;
+    float fluteLength = 15.0f;          // Cutting length from the tip
+    float shankRadius = 3.0f;
+    float stickout = 30.0f;             // Tip to holder face
+    float holderRadius = 15.0f;
+    float holderLength = 40.0f;
+};
+
+struct CollisionSettings {
+    ToolAssembly tool;
+    float tolerance = 0.02f;            // Flutes may touch the part this closely (profiles are tangent)
+    float clearance = 0.5f;             // Minimum distance of shank and holder from any mesh
+    float arcTolerance = 0.01f;         // Arcs are checked as chords within this distance
+    bool stopAtFirst = false;           // Stop all batches once one collision is found
+};
+
+// Which part of the assembly hit, per move (bits)
+enum CollisionPart : char {
+    COLLISION_TOOL = 1 << 0,
+    COLLISION_SHANK = 1 << 1,
+    COLLISION_HOLDER = 1 << 2
+};
+
+struct CollisionReport {
+    std::vector<char> moves;            // CollisionPart bits, one per move in toolpath order
+    size_t collidingMoves = 0;
+    size_t toolHits = 0;
+    size_t shankHits = 0;
+    size_t holderHits = 0;
+    bool complete = true;               // False when stopAtFirst or a cancel skipped moves
+    bool cancelled = false;
+    double ms = 0.0;
+};
+
+class CollisionChecker {
+public:
+    // Use these meshes as obstacles; call again after they are loaded or moved. The positions
+    // are copied here, while the CPU copies are still around; the hierarchy is rebuilt on the
+    // next check. Not safe while a check is running.
+    void setGeometry(std::vector<Mesh>& meshes);
+
+    // Stops early, with cancelled set, once cancel becomes true
+    CollisionReport check(const std::vector<Toolpath>& toolpaths, const CollisionSettings& settings, const std::atomic<bool>* cancel = nullptr);
+
+    void clear();
+
+    size_t triangleCount() const { return indices.size() / 3; }
+    double lastBuildMs() const { return buildMs; }
+
+private:
+    // Inner nodes keep their left child right after them; count == 0 marks them
+    struct Node {
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+        unsigned int first = 0;         // Right child, or first triangle of a leaf
+        unsigned int count = 0;
+    };
+
+    void build();
+    unsigned int buildNode(std::vector<unsigned int>& order, const std::vector<glm::vec3>& centroids, unsigned int begin, unsigned int end);
+    bool sweepHits(const glm::vec2& from, const glm::vec2& to, float radius, float bottom, float top) const;
+
+    bool geometryDirty = false;
+    std::vector<glm::vec3> positions;
+    std::vector<unsigned int> indices;  // Three per triangle, in hierarchy order
+    std::vector<Node> nodes;
+    double buildMs = 0.0;
+};
+
+#endif // COLLISION_H
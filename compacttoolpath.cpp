@@ -0,0 +1,437 @@
+// compacttoolpath.cpp
+#include "compacttoolpath.h"
+#include "parallel.h"
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <cmath>
+#include <climits>
+#include <cfloat>
+#include <iostream>
+
+namespace {
+
+unsigned long long zigzag(long long value) {
+    return (static_cast<unsigned long long>(value) << 1) ^ static_cast<unsigned long long>(value >> 63);
+}
+
+long long unzigzag(unsigned long long value) {
+    return static_cast<long long>(value >> 1) ^ -static_cast<long long>(value & 1);
+}
+
+void putVarint(std::vector<unsigned char>& out, long long value) {
+    unsigned long long bits = zigzag(value);
+    while (bits >= 0x80) {
+        out.push_back(static_cast<unsigned char>(bits | 0x80));
+        bits >>= 7;
+    }
+    out.push_back(static_cast<unsigned char>(bits));
+}
+
+// Never reads at or past end; a truncated or overlong varint yields the bits read so far
+long long getVarint(const unsigned char*& p, const unsigned char* end) {
+    unsigned long long bits = 0;
+    int shift = 0;
+    while (p < end) {
+        unsigned char byte = *p++;
+        if (shift < 64) bits |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+        shift += 7;
+        if (!(byte & 0x80)) break;
+    }
+    return unzigzag(bits);
+}
+
+// offset + size <= limit without overflowing
+bool fitsWithin(unsigned long long offset, unsigned long long size, unsigned long long limit) {
+    return offset <= limit && size <= limit - offset;
+}
+
+size_t alignTo8(size_t value) {
+    return (value + 7) & ~size_t(7);
+}
+
+struct FixedPoint {
+    long long x = 0, y = 0, z = 0;
+};
+
+FixedPoint quantize(const glm::vec3& p, double quantum) {
+    auto axis = [quantum](float v) {
+        double steps = std::round(v / quantum);
+        return static_cast<long long>(std::clamp(steps, double(INT_MIN), double(INT_MAX)));
+    };
+    return { axis(p.x), axis(p.y), axis(p.z) };
+}
+
+glm::vec3 dequantize(const FixedPoint& p, double quantum) {
+    return glm::vec3(static_cast<float>(p.x * quantum), static_cast<float>(p.y * quantum), static_cast<float>(p.z * quantum));
+}
+
+void growBounds(float boundsMin[3], float boundsMax[3], const glm::vec3& p) {
+    for (int axis = 0; axis < 3; axis++) {
+        boundsMin[axis] = std::min(boundsMin[axis], p[axis]);
+        boundsMax[axis] = std::max(boundsMax[axis], p[axis]);
+    }
+}
+
+// Walks the moves of one chunk: visit(globalMove, pathIndex, from, move)
+template <typename Visitor>
+void forEachChunkMove(const CompactToolpath& toolpath, size_t index, Visitor visit) {
+    const CompactToolpathHeader& header = toolpath.header();
+    const CompactToolpathChunk& chunk = toolpath.chunk(index);
+    const unsigned char* opcodes = toolpath.data() + header.opcodeOffset + chunk.firstMove;
+    const unsigned char* deltas = toolpath.data() + header.deltaOffset + chunk.deltaOffset;
+    const unsigned char* deltasEnd = toolpath.data() + header.deltaOffset + header.deltaSize;
+    const unsigned char* arcs = toolpath.data() + header.arcOffset + chunk.arcOffset;
+    const unsigned char* arcsEnd = toolpath.data() + header.arcOffset + header.arcSize;
+    const float* extraFeeds = reinterpret_cast<const float*>(toolpath.data() + header.extraFeedOffset) + chunk.extraFeedIndex;
+
+    size_t pathIndex = toolpath.pathOfMove(chunk.firstMove);
+    unsigned long long nextPathMove = pathIndex + 1 < toolpath.pathCount() ? toolpath.path(pathIndex + 1).firstMove : ULLONG_MAX;
+    FixedPoint position = { chunk.base[0], chunk.base[1], chunk.base[2] };
+
+    for (unsigned int i = 0; i < chunk.moveCount; i++) {
+        unsigned long long global = chunk.firstMove + i;
+        while (global == nextPathMove) {
+            pathIndex++;
+            const CompactToolpathPath& path = toolpath.path(pathIndex);
+            position = { path.start[0], path.start[1], path.start[2] };
+            nextPathMove = pathIndex + 1 < toolpath.pathCount() ? toolpath.path(pathIndex + 1).firstMove : ULLONG_MAX;
+        }
+
+        FixedPoint start = position;
+        position.x += getVarint(deltas, deltasEnd);
+        position.y += getVarint(deltas, deltasEnd);
+        position.z += getVarint(deltas, deltasEnd);
+
+        unsigned char opcode = opcodes[i];
+        ToolpathMove move;
+        move.type = static_cast<MoveType>(opcode & 3);
+        unsigned char feedSlot = opcode >> 2;
+        move.feedrate = feedSlot == COMPACT_FEED_ESCAPE ? *extraFeeds++ : header.palette[feedSlot];
+        move.target = dequantize(position, header.quantum);
+        if (isArc(move.type)) {
+            FixedPoint center = start;
+            center.x += getVarint(arcs, arcsEnd);
+            center.y += getVarint(arcs, arcsEnd);
+            center.z += getVarint(arcs, arcsEnd);
+            move.center = dequantize(center, header.quantum);
+        }
+        visit(global, pathIndex, dequantize(start, header.quantum), move);
+    }
+}
+
+// Encoded streams of one chunk before they are packed into the buffer
+struct EncodedChunk {
+    CompactToolpathChunk info;
+    std::vector<unsigned char> deltas;
+    std::vector<unsigned char> arcs;
+    std::vector<float> extraFeeds;
+};
+
+} // namespace
+
+void CompactToolpath::build(const std::vector<Toolpath>& toolpaths, double quantum) {
+    clear();
+
+    size_t pathCount = toolpaths.size();
+    std::vector<unsigned long long> pathFirst(pathCount + 1, 0);
+    for (size_t p = 0; p < pathCount; p++) {
+        pathFirst[p + 1] = pathFirst[p] + toolpaths[p].moves.size();
+    }
+    unsigned long long moveCount = pathFirst[pathCount];
+    size_t chunkCount = static_cast<size_t>((moveCount + COMPACT_CHUNK_MOVES - 1) / COMPACT_CHUNK_MOVES);
+
+    // Feed palette: the first distinct feedrates; the rest are escaped
+    std::vector<float> palette;
+    for (const Toolpath& toolpath : toolpaths) {
+        for (const ToolpathMove& move : toolpath.moves) {
+            if (palette.size() == COMPACT_FEED_PALETTE) break;
+            if (std::find(palette.begin(), palette.end(), move.feedrate) == palette.end()) palette.push_back(move.feedrate);
+        }
+    }
+
+    std::vector<unsigned char> opcodes(static_cast<size_t>(moveCount));
+    std::vector<EncodedChunk> chunks(chunkCount);
+    parallelFor(chunkCount, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            EncodedChunk& encoded = chunks[c];
+            CompactToolpathChunk& info = encoded.info;
+            unsigned long long first = c * static_cast<unsigned long long>(COMPACT_CHUNK_MOVES);
+            unsigned long long last = std::min<unsigned long long>(moveCount, first + COMPACT_CHUNK_MOVES);
+            encoded.deltas.reserve(static_cast<size_t>(last - first) * 5);
+
+            size_t p = std::upper_bound(pathFirst.begin(), pathFirst.begin() + pathCount, first) - pathFirst.begin() - 1;
+            FixedPoint position = first == pathFirst[p]
+                ? quantize(toolpaths[p].start, quantum)
+                : quantize(toolpaths[p].moves[static_cast<size_t>(first - pathFirst[p] - 1)].target, quantum);
+
+            info = CompactToolpathChunk();
+            info.firstMove = first;
+            info.moveCount = static_cast<unsigned int>(last - first);
+            info.base[0] = static_cast<int>(position.x);
+            info.base[1] = static_cast<int>(position.y);
+            info.base[2] = static_cast<int>(position.z);
+            for (int axis = 0; axis < 3; axis++) {
+                info.boundsMin[axis] = FLT_MAX;
+                info.boundsMax[axis] = -FLT_MAX;
+            }
+            growBounds(info.boundsMin, info.boundsMax, dequantize(position, quantum));
+
+            for (unsigned long long m = first; m < last; m++) {
+                // Deltas restart from the start of every path
+                while (m == pathFirst[p + 1]) {
+                    p++;
+                    position = quantize(toolpaths[p].start, quantum);
+                    growBounds(info.boundsMin, info.boundsMax, dequantize(position, quantum));
+                }
+                const ToolpathMove& move = toolpaths[p].moves[static_cast<size_t>(m - pathFirst[p])];
+
+                FixedPoint target = quantize(move.target, quantum);
+                putVarint(encoded.deltas, target.x - position.x);
+                putVarint(encoded.deltas, target.y - position.y);
+                putVarint(encoded.deltas, target.z - position.z);
+
+                size_t slot = std::find(palette.begin(), palette.end(), move.feedrate) - palette.begin();
+                if (slot == palette.size()) {
+                    slot = COMPACT_FEED_ESCAPE;
+                    encoded.extraFeeds.push_back(move.feedrate);
+                }
+                opcodes[static_cast<size_t>(m)] = static_cast<unsigned char>(static_cast<unsigned char>(move.type) | (slot << 2));
+
+                glm::vec3 targetPoint = dequantize(target, quantum);
+                growBounds(info.boundsMin, info.boundsMax, targetPoint);
+                if (isArc(move.type)) {
+                    FixedPoint center = quantize(move.center, quantum);
+                    putVarint(encoded.arcs, center.x - position.x);
+                    putVarint(encoded.arcs, center.y - position.y);
+                    putVarint(encoded.arcs, center.z - position.z);
+
+                    // Whole circle in the arc plane; cheap and never too small
+                    glm::vec3 centerPoint = dequantize(center, quantum);
+                    float radius = glm::length(glm::vec2(centerPoint.x, centerPoint.z) - glm::vec2(targetPoint.x, targetPoint.z));
+                    growBounds(info.boundsMin, info.boundsMax, glm::vec3(centerPoint.x - radius, targetPoint.y, centerPoint.z - radius));
+                    growBounds(info.boundsMin, info.boundsMax, glm::vec3(centerPoint.x + radius, targetPoint.y, centerPoint.z + radius));
+                }
+                position = target;
+            }
+        }
+    }, 1);
+
+    // Stream offsets of every chunk
+    unsigned long long deltaSize = 0, arcSize = 0, extraFeedCount = 0;
+    for (EncodedChunk& encoded : chunks) {
+        encoded.info.deltaOffset = deltaSize;
+        encoded.info.arcOffset = arcSize;
+        encoded.info.extraFeedIndex = extraFeedCount;
+        deltaSize += encoded.deltas.size();
+        arcSize += encoded.arcs.size();
+        extraFeedCount += encoded.extraFeeds.size();
+    }
+
+    CompactToolpathHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, "TPCK", 4);
+    header.version = COMPACT_TOOLPATH_VERSION;
+    header.quantum = quantum;
+    header.moveCount = moveCount;
+    header.pathCount = pathCount;
+    header.chunkCount = chunkCount;
+    header.pathTableOffset = alignTo8(sizeof(CompactToolpathHeader));
+    header.chunkTableOffset = header.pathTableOffset + pathCount * sizeof(CompactToolpathPath);
+    header.opcodeOffset = header.chunkTableOffset + chunkCount * sizeof(CompactToolpathChunk);
+    header.deltaOffset = alignTo8(static_cast<size_t>(header.opcodeOffset + moveCount));
+    header.deltaSize = deltaSize;
+    header.arcOffset = alignTo8(static_cast<size_t>(header.deltaOffset + deltaSize));
+    header.arcSize = arcSize;
+    header.extraFeedOffset = alignTo8(static_cast<size_t>(header.arcOffset + arcSize));
+    header.extraFeedCount = extraFeedCount;
+    header.paletteCount = static_cast<unsigned int>(palette.size());
+    std::copy(palette.begin(), palette.end(), header.palette);
+    for (int axis = 0; axis < 3; axis++) {
+        header.boundsMin[axis] = FLT_MAX;
+        header.boundsMax[axis] = -FLT_MAX;
+    }
+    for (const EncodedChunk& encoded : chunks) {
+        for (int axis = 0; axis < 3; axis++) {
+            header.boundsMin[axis] = std::min(header.boundsMin[axis], encoded.info.boundsMin[axis]);
+            header.boundsMax[axis] = std::max(header.boundsMax[axis], encoded.info.boundsMax[axis]);
+        }
+    }
+
+    storage.assign(static_cast<size_t>(header.extraFeedOffset + extraFeedCount * sizeof(float)), 0);
+    unsigned char* out = storage.data();
+    std::memcpy(out, &header, sizeof(header));
+
+    CompactToolpathPath* paths = reinterpret_cast<CompactToolpathPath*>(out + header.pathTableOffset);
+    for (size_t p = 0; p < pathCount; p++) {
+        FixedPoint start = quantize(toolpaths[p].start, quantum);
+        paths[p].firstMove = pathFirst[p];
+        paths[p].start[0] = static_cast<int>(start.x);
+        paths[p].start[1] = static_cast<int>(start.y);
+        paths[p].start[2] = static_cast<int>(start.z);
+        paths[p].reserved = 0;
+    }
+    if (moveCount > 0) {
+        std::memcpy(out + header.opcodeOffset, opcodes.data(), opcodes.size());
+    }
+
+    parallelFor(chunkCount, [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            const EncodedChunk& encoded = chunks[c];
+            std::memcpy(out + header.chunkTableOffset + c * sizeof(CompactToolpathChunk), &encoded.info, sizeof(CompactToolpathChunk));
+            if (!encoded.deltas.empty()) {
+                std::memcpy(out + header.deltaOffset + encoded.info.deltaOffset, encoded.deltas.data(), encoded.deltas.size());
+            }
+            if (!encoded.arcs.empty()) {
+                std::memcpy(out + header.arcOffset + encoded.info.arcOffset, encoded.arcs.data(), encoded.arcs.size());
+            }
+            if (!encoded.extraFeeds.empty()) {
+                std::memcpy(out + header.extraFeedOffset + encoded.info.extraFeedIndex * sizeof(float), encoded.extraFeeds.data(),
+                    encoded.extraFeeds.size() * sizeof(float));
+            }
+        }
+    }, 16);
+
+    bytes = storage.data();
+    length = storage.size();
+}
+
+bool CompactToolpath::save(const std::string& path) const {
+    if (!bytes) return false;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Error: Could not write " << path << std::endl;
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(bytes), length);
+    return static_cast<bool>(out);
+}
+
+bool CompactToolpath::open(const std::string& path) {
+    clear();
+    if (!mapping.open(path)) return false;
+    bytes = mapping.data();
+    length = mapping.size();
+    if (!validate()) {
+        std::cerr << "Error: " << path << " is not a valid toolpath file" << std::endl;
+        clear();
+        return false;
+    }
+    return true;
+}
+
+void CompactToolpath::clear() {
+    storage.clear();
+    storage.shrink_to_fit();
+    mapping.close();
+    bytes = nullptr;
+    length = 0;
+}
+
+// Everything the decoder trusts is checked here, so a corrupt or hostile file is rejected
+// instead of read out of bounds: the layout, the path and chunk tables and the opcodes.
+// Varints are bounded by their stream while decoding.
+bool CompactToolpath::validate() const {
+    if (length < sizeof(CompactToolpathHeader)) return false;
+    const CompactToolpathHeader& h = header();
+    if (std::memcmp(h.magic, "TPCK", 4) != 0 || h.version != COMPACT_TOOLPATH_VERSION || !(h.quantum > 0.0)) return false;
+    if (h.paletteCount > COMPACT_FEED_PALETTE) return false;
+
+    // Layout: the sections in order, aligned for the tables read in place, and counts small
+    // enough that their sizes cannot overflow
+    if (h.pathTableOffset % 8 != 0 || h.chunkTableOffset % 8 != 0 || h.extraFeedOffset % sizeof(float) != 0) return false;
+    if (h.pathCount > length / sizeof(CompactToolpathPath) || h.chunkCount > length / sizeof(CompactToolpathChunk)) return false;
+    if (h.moveCount > length || h.extraFeedCount > length / sizeof(float)) return false;
+    if (h.pathTableOffset < sizeof(CompactToolpathHeader)) return false;
+    if (!fitsWithin(h.pathTableOffset, h.pathCount * sizeof(CompactToolpathPath), h.chunkTableOffset)) return false;
+    if (!fitsWithin(h.chunkTableOffset, h.chunkCount * sizeof(CompactToolpathChunk), h.opcodeOffset)) return false;
+    if (!fitsWithin(h.opcodeOffset, h.moveCount, h.deltaOffset) || !fitsWithin(h.deltaOffset, h.deltaSize, h.arcOffset)) return false;
+    if (!fitsWithin(h.arcOffset, h.arcSize, h.extraFeedOffset)) return false;
+    if (!fitsWithin(h.extraFeedOffset, h.extraFeedCount * sizeof(float), length)) return false;
+    if (h.chunkCount != (h.moveCount + COMPACT_CHUNK_MOVES - 1) / COMPACT_CHUNK_MOVES) return false;
+
+    // Paths start at move 0 and never go back; pathOfMove searches them
+    if (h.moveCount > 0 && h.pathCount == 0) return false;
+    for (size_t p = 0; p < h.pathCount; p++) {
+        unsigned long long first = path(p).firstMove;
+        if (first > h.moveCount || (p == 0 && first != 0) || (p > 0 && first < path(p - 1).firstMove)) return false;
+    }
+
+    // Chunks cover the moves in order and their stream offsets stay inside the streams
+    for (size_t c = 0; c < h.chunkCount; c++) {
+        const CompactToolpathChunk& info = chunk(c);
+        unsigned long long first = c * static_cast<unsigned long long>(COMPACT_CHUNK_MOVES);
+        if (info.firstMove != first || info.moveCount != std::min<unsigned long long>(COMPACT_CHUNK_MOVES, h.moveCount - first)) return false;
+        if (info.deltaOffset > h.deltaSize || info.arcOffset > h.arcSize || info.extraFeedIndex > h.extraFeedCount) return false;
+        if (c > 0) {
+            const CompactToolpathChunk& previous = chunk(c - 1);
+            if (info.deltaOffset < previous.deltaOffset || info.arcOffset < previous.arcOffset || info.extraFeedIndex < previous.extraFeedIndex) return false;
+        }
+
+        // Every escaped feedrate of the chunk has its entry in the extra feed table, and
+        // every other one addresses a palette entry
+        unsigned long long escapes = 0;
+        const unsigned char* opcodes = bytes + h.opcodeOffset + info.firstMove;
+        for (unsigned int i = 0; i < info.moveCount; i++) {
+            unsigned char feedSlot = opcodes[i] >> 2;
+            if (feedSlot == COMPACT_FEED_ESCAPE) escapes++;
+            else if (feedSlot >= h.paletteCount) return false;
+        }
+        unsigned long long nextIndex = c + 1 < h.chunkCount ? chunk(c + 1).extraFeedIndex : h.extraFeedCount;
+        if (nextIndex < info.extraFeedIndex || nextIndex - info.extraFeedIndex != escapes) return false;
+    }
+    return true;
+}
+
+const CompactToolpathChunk& CompactToolpath::chunk(size_t index) const {
+    return reinterpret_cast<const CompactToolpathChunk*>(bytes + header().chunkTableOffset)[index];
+}
+
+const CompactToolpathPath& CompactToolpath::path(size_t index) const {
+    return reinterpret_cast<const CompactToolpathPath*>(bytes + header().pathTableOffset)[index];
+}
+
+size_t CompactToolpath::pathOfMove(unsigned long long move) const {
+    // Last path starting at or before the move; empty paths share their first move with the next one
+    size_t lo = 0, hi = pathCount();
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (path(mid).firstMove <= move) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+void CompactToolpath::decodeChunk(size_t index, std::vector<ToolpathMove>& moves, std::vector<glm::vec3>& from) const {
+    moves.clear();
+    from.clear();
+    moves.reserve(chunk(index).moveCount);
+    from.reserve(chunk(index).moveCount);
+    forEachChunkMove(*this, index, [&](unsigned long long, size_t, const glm::vec3& start, const ToolpathMove& move) {
+        moves.push_back(move);
+        from.push_back(start);
+    });
+}
+
+std::vector<Toolpath> CompactToolpath::toToolpaths() const {
+    size_t paths = pathCount();
+    std::vector<Toolpath> toolpaths(paths);
+    if (paths == 0) return toolpaths;
+
+    double quantum = header().quantum;
+    for (size_t p = 0; p < paths; p++) {
+        const CompactToolpathPath& entry = path(p);
+        unsigned long long next = p + 1 < paths ? path(p + 1).firstMove : header().moveCount;
+        toolpaths[p].start = dequantize({ entry.start[0], entry.start[1], entry.start[2] }, quantum);
+        toolpaths[p].moves.resize(static_cast<size_t>(next - entry.firstMove));
+    }
+
+    parallelFor(chunkCount(), [&](size_t begin, size_t end) {
+        for (size_t c = begin; c < end; c++) {
+            forEachChunkMove(*this, c, [&](unsigned long long global, size_t p, const glm::vec3&, const ToolpathMove& move) {
+                toolpaths[p].moves[static_cast<size_t>(global - path(p).firstMove)] = move;
+            });
+        }
+    }, 1);
+    return toolpaths;
+}
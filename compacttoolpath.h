@@ -0,0 +1,116 @@
+// compacttoolpath.h
+#ifndef COMPACTTOOLPATH_H
+#define COMPACTTOOLPATH_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "toolpath.h"
+#include "mappedfile.h"
+
+// Compact storage for very long toolpaths. Positions are fixed-point integers (one step is
+// the quantum, 1 um by default) and each move stores only its difference from the previous
+// position as zigzag varints, so typical contour moves take 5-7 bytes including their
+// opcode. The move streams are split into chunks that decode independently and carry their
+// own bounds for culling.
+//
+// The same bytes are used in memory and on disk (*.tpk): a saved file is memory mapped and
+// read in place, and every consumer (preview, G-code writer) decodes from that one buffer.
+
+const unsigned int COMPACT_TOOLPATH_VERSION = 1;
+const unsigned int COMPACT_CHUNK_MOVES = 4096;     // Moves per chunk
+const unsigned int COMPACT_FEED_PALETTE = 63;      // Feedrates addressable from the opcode byte
+
+// Opcode byte per move: bits 0-1 the MoveType, bits 2-7 an index into the feed palette, or
+// COMPACT_FEED_PALETTE when the feedrate is stored in the extra feed table instead
+const unsigned char COMPACT_FEED_ESCAPE = COMPACT_FEED_PALETTE;
+
+// File header; all offsets are from the start of the buffer and 8-byte aligned
+struct CompactToolpathHeader {
+    char magic[4];                          // "TPCK"
+    unsigned int version;
+    double quantum;                         // Model units per fixed-point step
+    unsigned long long moveCount;
+    unsigned long long pathCount;
+    unsigned long long chunkCount;
+    unsigned long long pathTableOffset;     // CompactToolpathPath[pathCount]
+    unsigned long long chunkTableOffset;    // CompactToolpathChunk[chunkCount]
+    unsigned long long opcodeOffset;        // One byte per move
+    unsigned long long deltaOffset;         // Position deltas, 3 varints per move
+    unsigned long long deltaSize;
+    unsigned long long arcOffset;           // Arc centres relative to the move start, 3 varints per arc
+    unsigned long long arcSize;
+    unsigned long long extraFeedOffset;     // float per escaped feedrate
+    unsigned long long extraFeedCount;
+    unsigned int paletteCount;
+    unsigned int reserved;
+    float palette[COMPACT_FEED_PALETTE + 1];
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+// Path table entry: where each toolpath starts
+struct CompactToolpathPath {
+    unsigned long long firstMove;
+    int start[3];                           // Fixed-point start position
+    unsigned int reserved;
+};
+
+// Chunk table entry
+struct CompactToolpathChunk {
+    unsigned long long firstMove;
+    unsigned long long deltaOffset;         // Byte offsets of the chunk inside each stream
+    unsigned long long arcOffset;
+    unsigned long long extraFeedIndex;
+    int base[3];                            // Fixed-point tool position before the first move
+    unsigned int moveCount;
+    float boundsMin[3];                     // Every position the tool passes through
+    float boundsMax[3];
+};
+
+class CompactToolpath {
+public:
+    CompactToolpath() = default;
+
+    CompactToolpath(const CompactToolpath&) = delete;
+    CompactToolpath& operator=(const CompactToolpath&) = delete;
+
+    // Encodes the toolpaths in memory; chunks are encoded in parallel
+    void build(const std::vector<Toolpath>& toolpaths, double quantum = 0.001);
+
+    // Writes the buffer unchanged, so that open() can map it back
+    bool save(const std::string& path) const;
+
+    // Maps a saved file read-only; nothing is decoded up front
+    bool open(const std::string& path);
+    void clear();
+
+    bool isEmpty() const { return bytes == nullptr; }
+    size_t moveCount() const { return bytes ? static_cast<size_t>(header().moveCount) : 0; }
+    size_t pathCount() const { return bytes ? static_cast<size_t>(header().pathCount) : 0; }
+    size_t chunkCount() const { return bytes ? static_cast<size_t>(header().chunkCount) : 0; }
+    size_t byteSize() const { return length; }
+    const unsigned char* data() const { return bytes; }
+
+    const CompactToolpathHeader& header() const { return *reinterpret_cast<const CompactToolpathHeader*>(bytes); }
+    const CompactToolpathChunk& chunk(size_t index) const;
+    const CompactToolpathPath& path(size_t index) const;
+    size_t pathOfMove(unsigned long long move) const;
+
+    // Moves of one chunk, with the position each move starts from
+    void decodeChunk(size_t index, std::vector<ToolpathMove>& moves, std::vector<glm::vec3>& from) const;
+
+    // Full decode back to the editable form
+    std::vector<Toolpath> toToolpaths() const;
+
+private:
+    bool validate() const;
+
+    std::vector<unsigned char> storage;     // Built in memory
+    MappedFile mapping;                     // Or opened from disk
+    const unsigned char* bytes = nullptr;
+    size_t length = 0;
+};
+
+#endif // COMPACTTOOLPATH_H
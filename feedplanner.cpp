@@ -0,0 +1,314 @@
+// feedplanner.cpp
+#include "feedplanner.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace {
+
+const uint32_t LINK_MOVE = 0xFFFFFFFFu;     // Segment that joins two toolpaths
+const size_t PLAN_CHUNK = 8192;             // Segments per parallel chunk
+
+// Moves flattened into one chain of non-degenerate segments, stored as separate arrays so the
+// per-segment loops stay simple and vectorize
+struct Segments {
+    std::vector<glm::vec3> points;          // Machine coordinates; segment i runs from point i to i + 1
+    std::vector<float> feed;                // Requested speed, units per second
+    std::vector<unsigned char> rapid;
+    std::vector<uint32_t> move;             // Originating move, or LINK_MOVE
+    std::vector<float> sweep;               // Signed arc sweep in radians; 0 for straight segments
+    std::vector<glm::vec2> center;          // Arc centre in machine XY
+
+    std::vector<float> length;
+    std::vector<float> dirX, dirY, dirZ;    // Direction at the start of the segment
+    std::vector<float> exitX, exitY, exitZ; // Direction at the end (differs from the start on arcs)
+    std::vector<float> nominal;             // Requested speed clamped to the axis limits
+    std::vector<float> accel;               // Acceleration limit along the segment
+    std::vector<float> cap;                 // Largest entry speed allowed by the corner
+
+    size_t size() const { return feed.size(); }
+};
+
+// Time for a speed change of dv: constant acceleration, or a jerk-limited ramp that starts and
+// ends with zero acceleration
+double rampTime(double dv, double accel, double jerk, bool sCurve) {
+    if (dv <= 0.0) return 0.0;
+    if (!sCurve) return dv / accel;
+    return dv * jerk > accel * accel ? dv / accel + accel / jerk : 2.0 * std::sqrt(dv / jerk);
+}
+
+// Distance covered while changing speed between v0 and v1. Both ramps are symmetric, so the
+// average speed is the mean of the two ends.
+double rampDistance(double v0, double v1, double accel, double jerk, bool sCurve) {
+    return 0.5 * (v0 + v1) * rampTime(std::fabs(v1 - v0), accel, jerk, sCurve);
+}
+
+// Highest speed reachable from v over a distance
+double reachableSpeed(double v, double distance, double accel, double jerk, bool sCurve) {
+    double upper = std::sqrt(v * v + 2.0 * accel * distance);
+    if (!sCurve) return upper;
+
+    // The jerk-limited ramp is never faster than the constant acceleration one
+    double lo = v, hi = upper;
+    for (int iteration = 0; iteration < 32; iteration++) {
+        double mid = 0.5 * (lo + hi);
+        if (rampDistance(v, mid, accel, jerk, sCurve) <= distance) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// Duration and peak speed of a segment entered at v0 and left at v1
+void segmentTiming(double v0, double v1, double cruise, double length, double accel, double jerk, bool sCurve,
+    double& duration, double& peak) {
+    double up = rampDistance(v0, cruise, accel, jerk, sCurve);
+    double down = rampDistance(cruise, v1, accel, jerk, sCurve);
+    if (up + down <= length) {
+        peak = cruise;
+        duration = rampTime(cruise - v0, accel, jerk, sCurve) + rampTime(cruise - v1, accel, jerk, sCurve) +
+            (length - up - down) / cruise;
+        return;
+    }
+
+    // Too short to reach the cruise speed: find the peak where the two ramps meet
+    double lo = std::max(v0, v1), hi = cruise;
+    if (!sCurve) {
+        lo = std::clamp(std::sqrt(accel * length + 0.5 * (v0 * v0 + v1 * v1)), lo, hi);
+    }
+    else {
+        for (int iteration = 0; iteration < 32; iteration++) {
+            double mid = 0.5 * (lo + hi);
+            if (rampDistance(v0, mid, accel, jerk, sCurve) + rampDistance(mid, v1, accel, jerk, sCurve) <= length) lo = mid;
+            else hi = mid;
+        }
+    }
+    peak = lo;
+    duration = rampTime(peak - v0, accel, jerk, sCurve) + rampTime(peak - v1, accel, jerk, sCurve);
+    if (duration <= 0.0 && peak > 0.0) duration = length / peak;
+}
+
+// Flattens the toolpaths; moveNode receives, for every move, the point where it starts
+Segments flattenToolpaths(const std::vector<Toolpath>& toolpaths, const MachineLimits& limits, std::vector<uint32_t>& moveNode) {
+    Segments segments;
+    size_t moveCount = countMoves(toolpaths);
+    segments.points.reserve(moveCount + toolpaths.size() + 1);
+    segments.feed.reserve(moveCount + toolpaths.size());
+    moveNode.resize(moveCount);
+
+    auto addSegment = [&](const glm::vec3& target, float feed, bool rapid, uint32_t move, float sweep, const glm::vec2& center) {
+        if (sweep == 0.0f && glm::length(target - segments.points.back()) < 1e-6f) return;
+        segments.points.push_back(target);
+        segments.feed.push_back(feed / 60.0f);
+        segments.rapid.push_back(rapid ? 1 : 0);
+        segments.move.push_back(move);
+        segments.sweep.push_back(sweep);
+        segments.center.push_back(center);
+    };
+
+    uint32_t moveIndex = 0;
+    for (const Toolpath& toolpath : toolpaths) {
+        glm::vec3 start = toMachine(toolpath.start);
+        if (segments.points.empty()) segments.points.push_back(start);
+        else addSegment(start, limits.rapidFeedrate, true, LINK_MOVE, 0.0f, glm::vec2(0.0f));
+
+        glm::vec3 from = toolpath.start;
+        for (const ToolpathMove& move : toolpath.moves) {
+            bool rapid = move.type == MoveType::Rapid || move.feedrate <= 0.0f;
+            float sweep = 0.0f;
+            glm::vec2 center(0.0f);
+            if (isArc(move.type)) {
+                sweep = arcSweep(from, move);
+                glm::vec3 machineCenter = toMachine(move.center);
+                center = glm::vec2(machineCenter.x, machineCenter.y);
+            }
+            moveNode[moveIndex] = static_cast<uint32_t>(segments.size());
+            addSegment(toMachine(move.target), rapid ? limits.rapidFeedrate : move.feedrate, move.type == MoveType::Rapid, moveIndex, sweep, center);
+            from = move.target;
+            moveIndex++;
+        }
+    }
+    return segments;
+}
+
+} // namespace
+
+FeedPlan planFeedrates(const std::vector<Toolpath>& toolpaths, const MachineLimits& limits) {
+    FeedPlan plan;
+    std::vector<uint32_t> moveNode;
+    Segments s = flattenToolpaths(toolpaths, limits, moveNode);
+    size_t n = s.size();
+    bool sCurve = limits.profile == VelocityProfile::SCurve;
+    double jerk = std::max(limits.maxJerk, 1e-3f);
+
+    // Lengths, directions and the axis-limited speed and acceleration of every segment
+    s.length.resize(n);
+    s.dirX.resize(n);
+    s.dirY.resize(n);
+    s.dirZ.resize(n);
+    s.exitX.resize(n);
+    s.exitY.resize(n);
+    s.exitZ.resize(n);
+    s.nominal.resize(n);
+    s.accel.resize(n);
+    parallelFor(n, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            glm::vec3 delta = s.points[i + 1] - s.points[i];
+            float length = glm::length(delta);
+            glm::vec3 dir = delta / length;
+            glm::vec3 exit = dir;
+            glm::vec3 extent = glm::vec3(std::fabs(dir.x), std::fabs(dir.y), std::fabs(dir.z));
+            float radius = 0.0f;
+
+            if (s.sweep[i] != 0.0f) {
+                // Helical length, with tangents at both ends; the tangent swings through the
+                // whole XY plane, so both axes are treated as fully involved
+                glm::vec2 fromCenter = glm::vec2(s.points[i].x, s.points[i].y) - s.center[i];
+                glm::vec2 toCenter = glm::vec2(s.points[i + 1].x, s.points[i + 1].y) - s.center[i];
+                radius = glm::length(fromCenter);
+                float planar = radius * std::fabs(s.sweep[i]);
+                length = std::sqrt(planar * planar + delta.z * delta.z);
+                float side = s.sweep[i] > 0.0f ? 1.0f : -1.0f;
+                glm::vec2 startTangent = glm::vec2(-fromCenter.y, fromCenter.x) * (side / std::max(radius, 1e-6f));
+                glm::vec2 endTangent = glm::vec2(-toCenter.y, toCenter.x) * (side / std::max(glm::length(toCenter), 1e-6f));
+                dir = glm::vec3(startTangent.x * planar, startTangent.y * planar, delta.z) / length;
+                exit = glm::vec3(endTangent.x * planar, endTangent.y * planar, delta.z) / length;
+                extent = glm::vec3(1.0f, 1.0f, std::fabs(delta.z) / length);
+            }
+            s.length[i] = length;
+            s.dirX[i] = dir.x;
+            s.dirY[i] = dir.y;
+            s.dirZ[i] = dir.z;
+            s.exitX[i] = exit.x;
+            s.exitY[i] = exit.y;
+            s.exitZ[i] = exit.z;
+
+            float speed = s.feed[i];
+            float accel = std::numeric_limits<float>::max();
+            for (int axis = 0; axis < 3; axis++) {
+                float component = extent[axis];
+                if (component < 1e-6f) continue;
+                speed = std::min(speed, limits.maxVelocity[axis] / 60.0f / component);
+                accel = std::min(accel, limits.maxAcceleration[axis] / component);
+            }
+            // Centripetal acceleration on arcs
+            if (radius > 0.0f) speed = std::min(speed, std::sqrt(accel * radius));
+            s.nominal[i] = std::max(speed, 1e-3f);
+            s.accel[i] = std::max(accel, 1e-3f);
+        }
+    });
+
+    // Corner speed limits from the junction deviation: the speed at which a circle of that
+    // deviation tangent to both segments could be followed at the acceleration limit
+    s.cap.resize(n);
+    parallelFor(n, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (i == 0) {
+                s.cap[i] = 0.0f;
+                continue;
+            }
+            float limit = std::min(s.nominal[i - 1], s.nominal[i]);
+            float cosTheta = -(s.exitX[i - 1] * s.dirX[i] + s.exitY[i - 1] * s.dirY[i] + s.exitZ[i - 1] * s.dirZ[i]);
+            if (cosTheta > 0.999999f) {
+                limit = 0.0f;   // Full reversal
+            }
+            else if (cosTheta > -0.999999f) {
+                float sinHalf = std::sqrt(0.5f * (1.0f - cosTheta));
+                float accel = std::min(s.accel[i - 1], s.accel[i]);
+                limit = std::min(limit, std::sqrt(accel * limits.junctionDeviation * sinHalf / (1.0f - sinHalf)));
+            }
+            s.cap[i] = limit;
+        }
+    });
+
+    // Distance needed to stop from the highest speed at the lowest acceleration. A chunk
+    // that starts its pass this far outside its own range is unaffected by where it started.
+    float fastest = 0.0f, slowestAccel = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < n; i++) {
+        fastest = std::max(fastest, s.nominal[i]);
+        slowestAccel = std::min(slowestAccel, s.accel[i]);
+    }
+    double brakingDistance = double(fastest) * fastest / (2.0 * slowestAccel);
+    if (sCurve) brakingDistance += 0.5 * fastest * slowestAccel / jerk;
+
+    std::vector<double> distance(n + 1, 0.0);
+    for (size_t i = 0; i < n; i++) distance[i + 1] = distance[i] + s.length[i];
+
+    size_t chunkCount = (n + PLAN_CHUNK - 1) / PLAN_CHUNK;
+
+    // Backward pass: node i is the start of segment i; the tool stops at the last node
+    std::vector<float> backward(n + 1, 0.0f);
+    parallelFor(chunkCount, [&](size_t chunkBegin, size_t chunkEnd) {
+        for (size_t c = chunkBegin; c < chunkEnd; c++) {
+            size_t first = c * PLAN_CHUNK;
+            size_t last = std::min(n, first + PLAN_CHUNK);
+            size_t from = std::lower_bound(distance.begin() + last, distance.end(), distance[last] + brakingDistance) - distance.begin();
+            from = std::min(from, n);
+
+            double v = 0.0;
+            for (size_t i = from; i-- > first;) {
+                v = std::min<double>(s.cap[i], reachableSpeed(v, s.length[i], s.accel[i], jerk, sCurve));
+                if (i < last) backward[i] = static_cast<float>(v);
+            }
+        }
+    }, 1);
+
+    // Forward pass into a separate array, since neighbouring chunks read the backward speeds
+    // inside this chunk's range
+    std::vector<float> speed(n + 1, 0.0f);
+    parallelFor(chunkCount, [&](size_t chunkBegin, size_t chunkEnd) {
+        for (size_t c = chunkBegin; c < chunkEnd; c++) {
+            size_t first = c * PLAN_CHUNK;
+            size_t last = std::min(n, first + PLAN_CHUNK);
+            size_t from = std::upper_bound(distance.begin(), distance.begin() + first + 1, distance[first] - brakingDistance) - distance.begin();
+            from = from > 0 ? from - 1 : 0;
+
+            double v = 0.0;
+            for (size_t i = from; i < last; i++) {
+                v = std::min<double>(backward[i], v);
+                if (i >= first) speed[i] = static_cast<float>(v);
+                v = reachableSpeed(v, s.length[i], s.accel[i], jerk, sCurve);
+            }
+        }
+    }, 1);
+
+    // Per-move results; moves too short to form a segment take the speed at their position
+    plan.entrySpeed.resize(moveNode.size());
+    plan.peakSpeed.resize(moveNode.size());
+    plan.duration.assign(moveNode.size(), 0.0f);
+    for (size_t m = 0; m < moveNode.size(); m++) {
+        plan.entrySpeed[m] = speed[moveNode[m]];
+        plan.peakSpeed[m] = speed[moveNode[m]];
+    }
+
+    std::vector<double> cuttingTimes(chunkCount, 0.0), rapidTimes(chunkCount, 0.0);
+    parallelFor(chunkCount, [&](size_t chunkBegin, size_t chunkEnd) {
+        for (size_t c = chunkBegin; c < chunkEnd; c++) {
+            size_t first = c * PLAN_CHUNK;
+            size_t last = std::min(n, first + PLAN_CHUNK);
+            for (size_t i = first; i < last; i++) {
+                double duration = 0.0, peak = 0.0;
+                segmentTiming(speed[i], speed[i + 1], s.nominal[i], s.length[i], s.accel[i], jerk, sCurve, duration, peak);
+                if (s.rapid[i] || s.move[i] == LINK_MOVE) rapidTimes[c] += duration;
+                else cuttingTimes[c] += duration;
+
+                if (s.move[i] != LINK_MOVE) {
+                    plan.peakSpeed[s.move[i]] = static_cast<float>(peak);
+                    plan.duration[s.move[i]] = static_cast<float>(duration);
+                }
+            }
+        }
+    }, 1);
+
+    for (size_t c = 0; c < chunkCount; c++) {
+        plan.cuttingTime += cuttingTimes[c];
+        plan.rapidTime += rapidTimes[c];
+    }
+    plan.totalTime = plan.cuttingTime + plan.rapidTime;
+    return plan;
+}
+
+double estimateCycleTime(const std::vector<Toolpath>& toolpaths, const MachineLimits& limits) {
+    return planFeedrates(toolpaths, limits).totalTime;
+}
@@ -0,0 +1,46 @@
+// feedplanner.h
+#ifndef FEEDPLANNER_H
+#define FEEDPLANNER_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "toolpath.h"
+
+enum class VelocityProfile {
+    Trapezoidal,    // Constant acceleration
+    SCurve          // Jerk-limited acceleration
+};
+
+// Machine kinematics, per machine axis (X, Y, Z; see toMachine)
+struct MachineLimits {
+    glm::vec3 maxVelocity = glm::vec3(6000.0f, 6000.0f, 3000.0f);  // Units per minute
+    glm::vec3 maxAcceleration = glm::vec3(500.0f, 500.0f, 250.0f);  // Units per second^2
+    float maxJerk = 5000.0f;                // Units per second^3; S-curve profile only
+    float rapidFeedrate = 6000.0f;          // Units per minute
+    float junctionDeviation = 0.01f;        // Cornering tolerance (Grbl style), in units
+    VelocityProfile profile = VelocityProfile::Trapezoidal;
+};
+
+// Result of planning a set of toolpaths. The per-move arrays have one entry per move, in
+// toolpath order; the moves that link the end of one toolpath to the start of the next are
+// timed as rapids and only counted in the totals.
+struct FeedPlan {
+    std::vector<float> entrySpeed;      // Units per second at the start of each move
+    std::vector<float> peakSpeed;       // Highest speed reached within each move
+    std::vector<float> duration;        // Seconds
+    double totalTime = 0.0;
+    double cuttingTime = 0.0;           // Feed moves
+    double rapidTime = 0.0;             // Rapids and links
+};
+
+// Look-ahead planning over every move: the nominal feed of each move is clamped to the axis
+// limits along its direction, corner speeds follow the junction deviation model, and a
+// backward then forward pass bounds every speed change by the acceleration available over
+// the move. Both passes run over chunks in parallel; each chunk starts a braking distance
+// outside its range so the result matches a sequential pass.
+FeedPlan planFeedrates(const std::vector<Toolpath>& toolpaths, const MachineLimits& limits);
+
+// Machining time in seconds, from the same plan
+double estimateCycleTime(const std::vector<Toolpath>& toolpaths, const MachineLimits& limits);
+
+#endif // FEEDPLANNER_H
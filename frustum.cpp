@@ -0,0 +1,28 @@
+// frustum.cpp
+#include "frustum.h"
+
+void extractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]) {
+    glm::vec4 row0(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+    glm::vec4 row1(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+    glm::vec4 row2(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+    glm::vec4 row3(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+    planes[0] = row3 + row0;
+    planes[1] = row3 - row0;
+    planes[2] = row3 + row1;
+    planes[3] = row3 - row1;
+    planes[4] = row3 + row2;
+    planes[5] = row3 - row2;
+}
+
+bool boxInFrustum(const glm::vec4 planes[6], const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    for (int i = 0; i < 6; i++) {
+        glm::vec3 positive(
+            planes[i].x >= 0.0f ? boundsMax.x : boundsMin.x,
+            planes[i].y >= 0.0f ? boundsMax.y : boundsMin.y,
+            planes[i].z >= 0.0f ? boundsMax.z : boundsMin.z);
+        if (glm::dot(glm::vec3(planes[i]), positive) + planes[i].w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,16 @@
+// frustum.h
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+// View frustum culling shared by the renderers that cull chunks against the camera
+
+// Frustum planes (Gribb/Hartmann) from the rows of the view-projection matrix; the normals
+// point inwards and are not normalized
+void extractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
+
+// Returns false if the box lies completely outside one of the frustum planes
+bool boxInFrustum(const glm::vec4 planes[6], const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+#endif // FRUSTUM_H
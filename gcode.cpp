@@ -0,0 +1,149 @@
+// gcode.cpp
+#include "gcode.h"
+#include "parallel.h"
+#include <algorithm>
+#include <fstream>
+#include <climits>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+// Appends " X12.345" from a value already scaled to integer decimals
+void appendWord(std::string& out, char letter, long long scaled, int decimals, long long scale) {
+    out += ' ';
+    out += letter;
+    if (scaled < 0) {
+        out += '-';
+        scaled = -scaled;
+    }
+    out += std::to_string(scaled / scale);
+    if (decimals > 0) {
+        std::string fraction = std::to_string(scaled % scale);
+        out += '.';
+        out.append(decimals - fraction.size(), '0');
+        out += fraction;
+    }
+}
+
+// Formats the moves of one chunk. Modal words (motion, axes, feed) are only written when
+// they change; every chunk restates them, so chunks can be formatted independently.
+void formatChunk(const CompactToolpath& toolpath, size_t index, const GCodeSettings& settings, std::string& out) {
+    std::vector<ToolpathMove> moves;
+    std::vector<glm::vec3> from;
+    toolpath.decodeChunk(index, moves, from);
+
+    long long scale = 1;
+    for (int i = 0; i < settings.decimals; i++) scale *= 10;
+    auto scaled = [scale](float value) { return std::llround(double(value) * scale); };
+
+    int motion = -1;
+    float feed = -1.0f;
+    long long axes[3] = { LLONG_MIN, LLONG_MIN, LLONG_MIN };
+    const char letters[3] = { 'X', 'Y', 'Z' };
+
+    // A chunk that opens a path links to its start with a rapid; otherwise the tool is
+    // already at the first position and only the modal state is seeded
+    const CompactToolpathChunk& chunk = toolpath.chunk(index);
+    bool linkFirst = toolpath.path(toolpath.pathOfMove(chunk.firstMove)).firstMove == chunk.firstMove;
+    if (!moves.empty() && !linkFirst) {
+        glm::vec3 start = toMachine(from[0]);
+        for (int axis = 0; axis < 3; axis++) axes[axis] = scaled(start[axis]);
+    }
+
+    for (size_t i = 0; i < moves.size(); i++) {
+        glm::vec3 start = toMachine(from[i]);
+        long long startAxes[3] = { scaled(start.x), scaled(start.y), scaled(start.z) };
+        if (startAxes[0] != axes[0] || startAxes[1] != axes[1] || startAxes[2] != axes[2]) {
+            // Rapid to the start of the next path
+            out += "G0";
+            motion = 0;
+            for (int axis = 0; axis < 3; axis++) {
+                appendWord(out, letters[axis], startAxes[axis], settings.decimals, scale);
+                axes[axis] = startAxes[axis];
+            }
+            out += '\n';
+        }
+
+        const ToolpathMove& move = moves[i];
+        int moveMotion = move.type == MoveType::Rapid ? 0 : move.type == MoveType::Linear ? 1 : move.type == MoveType::ArcCW ? 2 : 3;
+        glm::vec3 target = toMachine(move.target);
+        size_t lineStart = out.size();
+        if (moveMotion != motion || isArc(move.type)) {
+            out += 'G';
+            out += char('0' + moveMotion);
+        }
+        bool moved = false;
+        for (int axis = 0; axis < 3; axis++) {
+            long long value = scaled(target[axis]);
+            // Arcs always state both plane axes, full circles included
+            if (value != axes[axis] || (isArc(move.type) && axis < 2)) {
+                appendWord(out, letters[axis], value, settings.decimals, scale);
+                axes[axis] = value;
+                moved = true;
+            }
+        }
+        if (isArc(move.type)) {
+            glm::vec3 center = toMachine(move.center);
+            appendWord(out, 'I', scaled(center.x - start.x), settings.decimals, scale);
+            appendWord(out, 'J', scaled(center.y - start.y), settings.decimals, scale);
+            moved = true;
+        }
+        if (!moved) {
+            out.resize(lineStart);  // Too short to show at this precision
+            continue;
+        }
+        motion = moveMotion;        // Only once the line, and so its G word, is kept
+        if (moveMotion != 0 && move.feedrate != feed) {
+            appendWord(out, 'F', std::llround(double(move.feedrate)), 0, 1);
+            feed = move.feedrate;
+        }
+        if (out[lineStart] == ' ') out.erase(lineStart, 1);
+        out += '\n';
+    }
+}
+
+} // namespace
+
+bool writeGCode(const CompactToolpath& toolpath, const std::string& path, const GCodeSettings& settings) {
+    if (toolpath.isEmpty()) return false;
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Error: Could not write " << path << std::endl;
+        return false;
+    }
+
+    out << "(" << toolpath.moveCount() << " moves in " << toolpath.pathCount() << " paths)\n";
+    out << "G21 G90 G17 G94\n";
+    if (settings.spindleSpeed > 0) {
+        out << "S" << settings.spindleSpeed << " M3\n";
+    }
+
+    // Format a batch of chunks in parallel, then write the batch in order
+    size_t chunkCount = toolpath.chunkCount();
+    size_t batchSize = parallelThreadCount() * 4;
+    std::vector<std::string> texts(batchSize);
+    for (size_t batchStart = 0; batchStart < chunkCount; batchStart += batchSize) {
+        size_t batchCount = std::min(batchSize, chunkCount - batchStart);
+        parallelFor(batchCount, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                texts[i].clear();
+                formatChunk(toolpath, batchStart + i, settings, texts[i]);
+            }
+        }, 1);
+        for (size_t i = 0; i < batchCount; i++) {
+            out.write(texts[i].data(), texts[i].size());
+        }
+    }
+
+    if (settings.spindleSpeed > 0) {
+        out << "M5\n";
+    }
+    out << "M30\n";
+    if (!out) {
+        std::cerr << "Error: Failed while writing " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,18 @@
+// gcode.h
+#ifndef GCODE_H
+#define GCODE_H
+
+#include <string>
+#include "compacttoolpath.h"
+
+struct GCodeSettings {
+    int decimals = 3;               // Digits after the decimal point for coordinates
+    int spindleSpeed = 12000;       // RPM; 0 leaves the spindle off
+};
+
+// Writes G-code in machine coordinates (G17 XY plane, absolute positions, arc centres as
+// I/J offsets). Chunks are decoded straight from the compact buffer and formatted in
+// parallel batches, then written in order, so long jobs never exist as move structs.
+bool writeGCode(const CompactToolpath& toolpath, const std::string& path, const GCodeSettings& settings = GCodeSettings());
+
+#endif // GCODE_H
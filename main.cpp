@@ -7,11 +7,30 @@
 #include <imgui_impl_opengl3.h>
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
+#include <algorithm>
+#include <future>
+#include <cstdio>
 
 #include "shader.h"
 #include "model.h"
 #include "camera.h"
 #include "callbacks.h"
+#include "meshlet.h"
+#include "screenshot.h"
+#include "assembly.h"
+#include "slicer.h"
+#include "toolpath.h"
+#include "feedplanner.h"
+#include "arcfit.h"
+#include "compacttoolpath.h"
+#include "gcode.h"
+#include "benchmark.h"
+#include "workerfarm.h"
+#include "pipeline.h"
+#include "adaptive.h"
+#include "rest.h"
+#include "section.h"
+#include "collision.h"
 
 // Global variables for camera and model
 Camera camera(glm::vec3(5.0f, 5.0f, 5.0f), glm::vec3(0.0f, 0.0f, 0.0f));
@@ -37,6 +56,82 @@ float lightIntensity = 1.0f;
 glm::vec3 overallMin(std::numeric_limits<float>::max());
 glm::vec3 overallMax(-std::numeric_limits<float>::max());
 
+// Out-of-core large scan shown next to the CAM model
+MeshletStreamer largeScan;
+std::future<bool> largeScanBuild;
+std::atomic<float> largeScanProgress(0.0f);
+std::string largeScanPagePath;
+int largeScanBudgetMB = 1024;
+
+// Concurrent import of multi-file setups
+AssemblyImporter assemblyImporter;
+
+// Slicer settings and the most recent layers
+SliceSettings sliceSettings;
+std::vector<Layer> slicedLayers;
+unsigned int slicedLayersGeneration = 0;    // Bumped whenever slicedLayers is replaced
+double lastSliceMs = 0.0;
+
+// Profile toolpaths generated from the sliced layers, and their feed plan
+ProfileSettings profileSettings;
+std::vector<Toolpath> toolpaths;
+ToolpathPreview toolpathPreview;
+CompactToolpath compactToolpath;    // Shared by the preview and the G-code writer
+bool toolpathsDecoded = true;       // False while an opened file is only mapped into compactToolpath
+bool showToolpaths = true;
+ArcFitSettings arcFitSettings;
+ArcFitStats arcFitStats;
+MachineLimits machineLimits;
+FeedPlan feedPlan;
+double lastPlanMs = 0.0;
+
+// Worker processes for toolpath jobs; a crashing unit is retried without taking the viewer down
+WorkerFarm workerFarm;
+std::future<FarmResult> farmJob;
+FarmResult lastFarmResult;
+
+// Incremental slice/toolpath chain; with live updates on, parameter edits only recompute
+// the layers they affect
+ToolpathPipeline toolpathPipeline;
+bool livePipeline = false;
+bool pipelineFitArcs = false;
+
+// Generator of the current toolpaths; live updates only replace profile toolpaths
+enum class ToolpathSource { Profile, Adaptive, WorkerFarm, File };
+ToolpathSource toolpathSource = ToolpathSource::Profile;
+const char* toolpathSourceNames[] = { "profile", "adaptive", "worker process", "opened" };
+
+// Constant-engagement roughing of the material between stock and part
+AdaptiveSettings adaptiveSettings;
+AdaptiveStats adaptiveStats;
+double lastAdaptiveMs = 0.0;
+
+// Earlier operations for rest machining; with rest only on, new toolpaths skip what they cleared
+std::vector<RestOperation> restOperations;
+bool restOnly = false;
+RestStats restStats;
+
+// GPU section plane with capping; the slice contour at the plane is overlaid when sliced
+SectionView sectionView;
+bool snapSectionToLayers = false;
+
+// Tool assembly collision checks against every loaded mesh; conflicts are highlighted
+CollisionChecker collisionChecker;
+CollisionSettings collisionSettings;
+CollisionReport collisionReport;
+bool checkCollisions = true;
+std::future<CollisionReport> collisionJob;     // Check running on a worker thread
+std::atomic<bool> collisionCancel(false);
+
+// Shader variants with an on-disk program binary cache; edits in shaders/ are hot reloaded
+ShaderManager shaderManager;
+
+// Offscreen high-resolution screenshot
+ScreenshotCapture screenshot;
+int screenshotWidth = 4096;
+int screenshotHeight = 4096;
+int screenshotTileSize = 1024;
+
 float lastFrame = 0.0f;
 float calculateDeltaTime() {
     float currentFrame = glfwGetTime();
@@ -119,13 +214,98 @@ void createGrid(int gridSize) {
     glBindVertexArray(0);
 }
 
+// Put the loaded model on the grid and point the camera at it
+void focusCameraOnModel() {
+    positionModelOnGrid(meshes); // Center the model on the grid
+
+    // Bounds after positioning
+    overallMin = glm::vec3(std::numeric_limits<float>::max());
+    overallMax = glm::vec3(-std::numeric_limits<float>::max());
+    for (const auto& mesh : meshes) {
+        glm::vec3 min, max;
+        computeBoundingBox(mesh, min, max);
+        overallMin = glm::min(overallMin, min);
+        overallMax = glm::max(overallMax, max);
+    }
+
+    glm::vec3 center = (overallMin + overallMax) / 2.0f;
+    glm::vec3 size = overallMax - overallMin;
+    float distance = glm::length(size) * 1.5f;
+
+    camera.target = center;
+    camera.position = center + glm::vec3(distance, distance, distance);
+    camera.updateCameraVectors();
+}
+
+// Rest material for a tool of this radius, or nothing when rest machining is off
+std::vector<ClipperLib::Paths> restForTool(float toolRadius) {
+    if (!restOnly || restOperations.empty()) return {};
+    RestSettings settings;
+    settings.toolRadius = toolRadius;
+    return computeRestMaterial(slicedLayers, restOperations, settings, &restStats);
+}
+
+// Toolpaths in editable form. An opened file is previewed and exported straight from the
+// mapped compactToolpath and only decoded here, the first time an editing stage needs it.
+std::vector<Toolpath>& editableToolpaths() {
+    if (!toolpathsDecoded) {
+        toolpaths = compactToolpath.toToolpaths();
+        toolpathsDecoded = true;
+    }
+    return toolpaths;
+}
+
+bool hasToolpaths() {
+    return compactToolpath.pathCount() > 0;
+}
+
+// Stops a running collision check and drops its report; needed before the toolpaths it
+// checks or the checker's geometry change
+void cancelCollisionCheck() {
+    if (!collisionJob.valid()) return;
+    collisionCancel = true;
+    collisionJob.wait();
+    collisionJob = std::future<CollisionReport>();
+}
+
+// Rebuilds the toolpath preview and, when enabled, starts a collision check of the toolpaths
+// in the background; its highlights are shown once it finishes. Automatic checks skip an
+// opened file that has not been decoded yet.
+void rebuildToolpathPreview(bool forceCheck = false) {
+    cancelCollisionCheck();
+    collisionReport = CollisionReport();
+    toolpathPreview.build(compactToolpath);
+    if (((checkCollisions && toolpathsDecoded) || forceCheck) && hasToolpaths() && !meshes.empty()) {
+        collisionSettings.tool.toolRadius = profileSettings.toolRadius;
+        collisionCancel = false;
+        collisionJob = std::async(std::launch::async, [paths = editableToolpaths(), settings = collisionSettings]() {
+            return collisionChecker.check(paths, settings, &collisionCancel);
+        });
+    }
+}
+
 void renderGrid() {
     glBindVertexArray(gridVAO);
     glDrawArrays(GL_LINES, 0, gridSize * 4 * 2);
     glBindVertexArray(0);
 }
 
-int main() {
+int main(int argc, char** argv) {
+    // Headless render regression run: --bench [scene file] [--record]
+    if (argc > 1 && std::string(argv[1]) == "--bench") {
+        std::string scenePath = "bench/scenes.txt";
+        bool record = false;
+        for (int i = 2; i < argc; i++) {
+            if (std::string(argv[i]) == "--record") record = true;
+            else scenePath = argv[i];
+        }
+        return runBenchmark(scenePath, record);
+    }
+    // Toolpath worker started by the worker farm; talks over stdin/stdout
+    if (argc > 1 && std::string(argv[1]) == "--worker") {
+        return runToolpathWorker();
+    }
+
     if (!glfwInit()) {
         std::cerr << "Failed to initialize GLFW" << std::endl;
         return -1;
@@ -170,15 +350,13 @@ int main() {
     glEnable(GL_DEPTH_TEST);
     setupFramebuffer(640, 360);
 
-    GLuint shaderProgram = createShaderProgram(vertexShaderSource, fragmentShaderSource);
+    shaderManager.init("shader_cache", "shaders");
+    GLuint shaderProgram = shaderManager.program(SHADER_DEFAULT);
+    GLuint lineProgram = shaderManager.program(SHADER_TOOLPATH);
 
     GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
     GLint viewLoc = glGetUniformLocation(shaderProgram, "view");
     GLint projLoc = glGetUniformLocation(shaderProgram, "projection");
-    GLint lightPosLoc = glGetUniformLocation(shaderProgram, "lightPos");
-    GLint lightColorLoc = glGetUniformLocation(shaderProgram, "lightColor");
-    GLint objectColorLoc = glGetUniformLocation(shaderProgram, "objectColor");
-    GLint lightIntensityLoc = glGetUniformLocation(shaderProgram, "lightIntensity");
 
     createGrid(gridSize);
 
@@ -186,11 +364,18 @@ int main() {
         glfwPollEvents();
         float deltaTime = calculateDeltaTime();
 
+        // Pick up edited shaders and the variant for the current view mode
+        shaderManager.reloadIfChanged();
+        unsigned int sectionVariant = sectionView.isActive() ? unsigned(SHADER_SECTION) : 0u;
+        shaderProgram = shaderManager.program((wireframeMode ? SHADER_WIREFRAME : SHADER_DEFAULT) | sectionVariant);
+        lineProgram = shaderManager.program(SHADER_TOOLPATH | sectionVariant);
+
         ImGui_ImplOpenGL3_NewFrame();
         ImGui_ImplGlfw_NewFrame();
         ImGui::NewFrame();
 
         // Main menu bar
+        bool openScreenshotPopup = false;
         if (ImGui::BeginMainMenuBar()) {
             if (ImGui::BeginMenu("File")) {
                 if (ImGui::MenuItem("Open", "Ctrl+O")) {
@@ -198,20 +383,75 @@ int main() {
                     const char* newPath = tinyfd_openFileDialog("Open 3D Model", "", 2, filters, "3D Files", 0);
                     if (newPath) {
                         loadModel(newPath, meshes);
-
-                        positionModelOnGrid(meshes); // Center the model on the grid
-
-                        glm::vec3 center = (overallMin + overallMax) / 2.0f;
-                        glm::vec3 size = overallMax - overallMin;
-                        float distance = glm::length(size) * 1.5f;
-
-                        camera.target = center;
-                        camera.position = center + glm::vec3(distance, distance, distance);
-                        camera.updateCameraVectors();
+                        focusCameraOnModel();
+                        toolpathPipeline.setGeometry(meshes);
+                        cancelCollisionCheck();
+                        collisionChecker.setGeometry(meshes);
+                        applyMemoryPolicy(meshes);
+                    }
+                }
+                if (ImGui::MenuItem("Open Assembly...", NULL, false, !assemblyImporter.isBusy())) {
+                    const char* filters[] = { "*.obj", "*.stl" };
+                    const char* selection = tinyfd_openFileDialog("Open Assembly Files", "", 2, filters, "3D Files", 1);
+                    assemblyImporter.start(splitFileSelection(selection));
+                }
+                if (ImGui::MenuItem("Open Assembly Folder...", NULL, false, !assemblyImporter.isBusy())) {
+                    const char* folder = tinyfd_selectFolderDialog("Open Assembly Folder", "");
+                    if (folder) {
+                        assemblyImporter.start(listModelFiles(folder));
+                    }
+                }
+                if (ImGui::MenuItem("Open Large Scan...", NULL, false, !largeScanBuild.valid())) {
+                    const char* filters[] = { "*.stl", "*.obj", "*.mtpm" };
+                    const char* newPath = tinyfd_openFileDialog("Open Large Scan", "", 3, filters, "Scan Files", 0);
+                    if (newPath) {
+                        std::string modelPath = newPath;
+                        if (modelPath.size() > 5 && modelPath.substr(modelPath.size() - 5) == ".mtpm") {
+                            largeScan.open(modelPath);
+                        }
+                        else {
+                            // Preprocess into meshlet pages once; later opens reuse the page file
+                            largeScanPagePath = meshletPagePath(modelPath);
+                            if (isMeshletPageFileCurrent(modelPath, largeScanPagePath)) {
+                                largeScan.open(largeScanPagePath);
+                            }
+                            else {
+                                largeScanProgress = 0.0f;
+                                largeScanBuild = std::async(std::launch::async, buildMeshletPageFile, modelPath, largeScanPagePath, &largeScanProgress);
+                            }
+                        }
                     }
                 }
-                if (ImGui::MenuItem("Save Screenshot", "Ctrl+S")) {
-                    // Add screenshot functionality
+                if (ImGui::MenuItem("Close Large Scan", NULL, false, largeScan.isOpen())) {
+                    largeScan.close();
+                }
+                if (ImGui::MenuItem("Open Toolpath...")) {
+                    const char* filters[] = { "*.tpk" };
+                    const char* newPath = tinyfd_openFileDialog("Open Toolpath", "", 1, filters, "Toolpath Files", 0);
+                    if (newPath && compactToolpath.open(newPath)) {
+                        toolpaths = std::vector<Toolpath>();
+                        toolpathsDecoded = false;
+                        toolpathSource = ToolpathSource::File;
+                        rebuildToolpathPreview();
+                        feedPlan = FeedPlan();
+                    }
+                }
+                if (ImGui::MenuItem("Save Toolpath...", NULL, false, !compactToolpath.isEmpty())) {
+                    const char* filters[] = { "*.tpk" };
+                    const char* savePath = tinyfd_saveFileDialog("Save Toolpath", "toolpath.tpk", 1, filters, "Toolpath Files");
+                    if (savePath) {
+                        compactToolpath.save(savePath);
+                    }
+                }
+                if (ImGui::MenuItem("Export G-code...", NULL, false, !compactToolpath.isEmpty())) {
+                    const char* filters[] = { "*.nc", "*.gcode", "*.tap" };
+                    const char* savePath = tinyfd_saveFileDialog("Export G-code", "toolpath.nc", 3, filters, "G-code Files");
+                    if (savePath) {
+                        writeGCode(compactToolpath, savePath);
+                    }
+                }
+                if (ImGui::MenuItem("Save Screenshot", "Ctrl+S", false, !screenshot.isBusy())) {
+                    openScreenshotPopup = true;
                 }
                 if (ImGui::MenuItem("Exit", "Ctrl+Q")) {
                     glfwSetWindowShouldClose(window, true);
@@ -222,6 +462,7 @@ int main() {
             if (ImGui::BeginMenu("View")) {
                 ImGui::MenuItem("Show Grid", NULL, &showGrid);
                 ImGui::MenuItem("Wireframe Mode", NULL, &wireframeMode);
+                ImGui::MenuItem("Section View", NULL, &sectionView.enabled);
                 ImGui::EndMenu();
             }
 
@@ -234,6 +475,32 @@ int main() {
             ImGui::EndMainMenuBar();
         }
 
+        // Screenshot Popup
+        if (openScreenshotPopup) {
+            ImGui::OpenPopup("ScreenshotPopup");
+        }
+        if (ImGui::BeginPopupModal("ScreenshotPopup", NULL, ImGuiWindowFlags_AlwaysAutoResize)) {
+            ImGui::InputInt("Width", &screenshotWidth);
+            ImGui::InputInt("Height", &screenshotHeight);
+            ImGui::InputInt("Tile Size", &screenshotTileSize);
+            screenshotWidth = std::max(1, std::min(screenshotWidth, 32768));
+            screenshotHeight = std::max(1, std::min(screenshotHeight, 32768));
+            screenshotTileSize = std::max(64, std::min(screenshotTileSize, 4096));
+            if (ImGui::Button("Save...")) {
+                const char* filters[] = { "*.png" };
+                const char* savePath = tinyfd_saveFileDialog("Save Screenshot", "screenshot.png", 1, filters, "PNG Image");
+                if (savePath) {
+                    screenshot.begin(savePath, screenshotWidth, screenshotHeight, glm::radians(camera.fov), screenshotTileSize);
+                }
+                ImGui::CloseCurrentPopup();
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Cancel")) {
+                ImGui::CloseCurrentPopup();
+            }
+            ImGui::EndPopup();
+        }
+
         // About Popup
         if (ImGui::BeginPopupModal("AboutPopup", NULL, ImGuiWindowFlags_AlwaysAutoResize)) {
             ImGui::Text("3D Model Viewer\n");
@@ -248,6 +515,21 @@ int main() {
             ImGui::EndPopup();
         }
 
+        // Upload meshes that finished importing on the worker threads
+        if (assemblyImporter.pumpUploads(meshes)) {
+            focusCameraOnModel();
+            toolpathPipeline.setGeometry(meshes);
+            cancelCollisionCheck();
+            collisionChecker.setGeometry(meshes);
+            applyMemoryPolicy(meshes);
+        }
+
+        // Highlight the colliding moves once the background check is done
+        if (collisionJob.valid() && collisionJob.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            collisionReport = collisionJob.get();
+            toolpathPreview.build(compactToolpath, &collisionReport.moves);
+        }
+
         // Render to framebuffer
         glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
         glClearColor(clearColor.r, clearColor.g, clearColor.b, 1.0f);
@@ -260,13 +542,72 @@ int main() {
             lastPolygonMode = currentPolygonMode;
         }
 
+        renderStats = RenderStats();
+        glm::mat4 sceneModel = glm::translate(glm::mat4(1.0f), selectedObjectPosition);
+        sectionView.begin(shaderProgram, sceneModel);
         renderScene(window, shaderProgram, meshes, camera, lightIntensity, lightColor, lightPos, objectColor);
 
+        if (largeScanBuild.valid() && largeScanBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            if (largeScanBuild.get()) {
+                largeScan.open(largeScanPagePath);
+            }
+        }
+        if (largeScan.isOpen()) {
+            // Same view and projection as renderScene
+            glm::mat4 scanViewProjection = glm::perspective(glm::radians(camera.fov), 1280.0f / 720.0f, 0.1f, 100.0f) * camera.GetViewMatrix();
+            largeScan.setMemoryBudget(size_t(largeScanBudgetMB) * 1024 * 1024);
+            largeScan.update(scanViewProjection, camera.position, glm::radians(camera.fov), 360.0f);
+            largeScan.render(shaderProgram);
+        }
+        sectionView.end();
+
+        if (sectionView.isActive()) {
+            // Same view and projection as renderScene
+            glm::mat4 projection = glm::perspective(glm::radians(camera.fov), 1280.0f / 720.0f, 0.1f, 100.0f);
+            sectionView.renderCap(shaderProgram, shaderManager.program(SHADER_WIREFRAME), meshes, sceneModel, camera.GetViewMatrix(), projection);
+            sectionView.updateContour(slicedLayers, slicedLayersGeneration);
+            sectionView.renderContour(shaderManager.program(SHADER_TOOLPATH), sceneModel, camera.GetViewMatrix(), projection);
+            glUseProgram(shaderProgram);    // The grid draws with the scene program
+        }
+
         if (showGrid) {
             renderGrid();
         }
 
+        if (showToolpaths) {
+            // Toolpaths above the section plane are cut away with the model
+            glm::mat4 projection = glm::perspective(glm::radians(camera.fov), 1280.0f / 720.0f, 0.1f, 100.0f);
+            sectionView.begin(lineProgram, glm::mat4(1.0f));
+            toolpathPreview.render(lineProgram, camera.GetViewMatrix(), projection);
+            sectionView.end();
+        }
+
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // Render a few screenshot tiles per frame so the UI keeps running
+        screenshot.step([&](const glm::mat4& projection) {
+            sectionView.begin(shaderProgram, sceneModel);
+            renderScene(window, shaderProgram, meshes, camera, lightIntensity, lightColor, lightPos, objectColor, projection);
+            if (largeScan.isOpen()) {
+                // Tiles have the pixel density of the whole image, so refine for its height
+                largeScan.update(projection * camera.GetViewMatrix(), camera.position, glm::radians(camera.fov), float(screenshot.imageHeight()));
+                largeScan.render(shaderProgram);
+            }
+            sectionView.end();
+            if (sectionView.isActive()) {
+                sectionView.renderCap(shaderProgram, shaderManager.program(SHADER_WIREFRAME), meshes, sceneModel, camera.GetViewMatrix(), projection);
+                sectionView.renderContour(shaderManager.program(SHADER_TOOLPATH), sceneModel, camera.GetViewMatrix(), projection);
+                glUseProgram(shaderProgram);
+            }
+            if (showGrid) {
+                renderGrid();
+            }
+            if (showToolpaths) {
+                sectionView.begin(lineProgram, glm::mat4(1.0f));
+                toolpathPreview.render(lineProgram, camera.GetViewMatrix(), projection);
+                sectionView.end();
+            }
+        });
        
             ImGui::Begin("3D Model Viewer Controls");
 
@@ -343,18 +684,331 @@ int main() {
         ImGui::SliderFloat("Light Intensity", &lightIntensity, 0.0f, 2.0f);
 
         camera.updateCameraVectors();  // Update camera after changes
+        // Lighting uniforms are set by name in renderScene, on whichever program variant is current
 
-        glUseProgram(shaderProgram);
-        glUniform3fv(lightPosLoc, 1, glm::value_ptr(lightPos));
-        glUniform3fv(lightColorLoc, 1, glm::value_ptr(lightColor));
-        glUniform1f(lightIntensityLoc, lightIntensity);
-        glUniform3fv(objectColorLoc, 1, glm::value_ptr(objectColor)); // Add this line to update object color
+        if (assemblyImporter.isBusy()) {
+            char overlay[64];
+            snprintf(overlay, sizeof(overlay), "Importing %zu / %zu files", assemblyImporter.filesImported(), assemblyImporter.filesTotal());
+            ImGui::ProgressBar(float(assemblyImporter.filesImported()) / float(assemblyImporter.filesTotal()), ImVec2(-1.0f, 0.0f), overlay);
+        }
+        if (screenshot.isBusy()) {
+            ImGui::ProgressBar(screenshot.progress(), ImVec2(-1.0f, 0.0f), "Saving screenshot...");
+        }
+        else if (screenshot.hasFailed()) {
+            ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Screenshot failed: %s", screenshot.error().c_str());
+        }
+
+        ImGui::Text("Section View");
+        ImGui::Checkbox("Section Plane", &sectionView.enabled);
+        if (sectionView.enabled && !meshes.empty()) {
+            float sectionMin = meshes.front().boundsMin.y, sectionMax = meshes.front().boundsMax.y;
+            for (const Mesh& mesh : meshes) {
+                sectionMin = std::min(sectionMin, mesh.boundsMin.y);
+                sectionMax = std::max(sectionMax, mesh.boundsMax.y);
+            }
+            ImGui::SliderFloat("Section Height", &sectionView.height, sectionMin, sectionMax, "%.3f");
+            ImGui::Checkbox("Fill Cut Surface", &sectionView.cap);
+            ImGui::SameLine();
+            ImGui::Checkbox("Slice Contour", &sectionView.showContour);
+            ImGui::Checkbox("Snap to Layers", &snapSectionToLayers);
+            if (snapSectionToLayers && !slicedLayers.empty()) {
+                sectionView.height = sectionView.nearestLayerHeight(slicedLayers);
+            }
+            ImGui::ColorEdit3("Cap Color", glm::value_ptr(sectionView.capColor));
+        }
+
+        ImGui::Text("Import Settings");
+        ImGui::SliderFloat("Crease Angle", &importSettings.repair.creaseAngle, 0.0f, 180.0f);
+        static const char* weightingModes[] = { "Area Weighted", "Angle Weighted" };
+        int weighting = static_cast<int>(importSettings.repair.weighting);
+        if (ImGui::Combo("Normal Weighting", &weighting, weightingModes, 2)) {
+            importSettings.repair.weighting = static_cast<NormalWeighting>(weighting);
+        }
+        ImGui::Checkbox("Remove Degenerate Triangles", &importSettings.repair.removeDegenerate);
+        ImGui::Checkbox("Fix Winding", &importSettings.repair.fixWinding);
+        ImGui::Checkbox("Recompute Normals", &importSettings.recomputeNormals);
+
+        ImGui::Text("Slicing");
+        ImGui::Checkbox("Adaptive Layers", &sliceSettings.adaptive);
+        if (sliceSettings.adaptive) {
+            ImGui::DragFloatRange2("Layer Height Range", &sliceSettings.minLayerHeight, &sliceSettings.maxLayerHeight, 0.01f, 0.01f, 100.0f);
+            ImGui::InputFloat("Cusp Tolerance", &sliceSettings.cuspTolerance, 0.01f, 0.1f, "%.3f");
+        }
+        else {
+            ImGui::InputFloat("Layer Height", &sliceSettings.layerHeight, 0.1f, 1.0f, "%.3f");
+        }
+        if (ImGui::Button("Slice Model") && !meshes.empty()) {
+            double start = glfwGetTime();
+            ensureCpuCopies(meshes); // Released copies are read back for the slice
+            slicedLayers = sliceMeshes(meshes, layerHeights(meshes, sliceSettings));
+            slicedLayersGeneration++;
+            applyMemoryPolicy(meshes);
+            lastSliceMs = (glfwGetTime() - start) * 1000.0;
+        }
+        if (!slicedLayers.empty()) {
+            ImGui::SameLine();
+            ImGui::Text("%zu layers (%.1f ms)", slicedLayers.size(), lastSliceMs);
+        }
+
+        ImGui::Text("Toolpaths");
+        ImGui::InputFloat("Tool Radius", &profileSettings.toolRadius, 0.1f, 1.0f, "%.3f");
+        ImGui::InputFloat("Feedrate", &profileSettings.feedrate, 10.0f, 100.0f, "%.0f");
+        ImGui::InputFloat("Plunge Feedrate", &profileSettings.plungeFeedrate, 10.0f, 100.0f, "%.0f");
+        ImGui::Checkbox("Climb Milling", &profileSettings.climb);
+        ImGui::Checkbox("Show Toolpaths", &showToolpaths);
+        if (ImGui::Button("Generate Profile Toolpaths") && !slicedLayers.empty()) {
+            toolpaths = generateProfileToolpaths(slicedLayers, profileSettings);
+            std::vector<ClipperLib::Paths> rest = restForTool(profileSettings.toolRadius);
+            if (!rest.empty()) {
+                RestSettings restSettings;
+                restSettings.toolRadius = profileSettings.toolRadius;
+                toolpaths = restrictToRest(toolpaths, slicedLayers, rest, restSettings);
+            }
+            toolpathSource = ToolpathSource::Profile;
+            compactToolpath.build(toolpaths);
+            toolpathsDecoded = true;
+            rebuildToolpathPreview();
+            feedPlan = FeedPlan();
+            arcFitStats = ArcFitStats();
+        }
+        ImGui::Checkbox("Live Toolpath Updates", &livePipeline);
+        if (livePipeline) {
+            ImGui::SameLine();
+            ImGui::Checkbox("Fit Arcs Live", &pipelineFitArcs);
+        }
+        if (livePipeline && !meshes.empty()) {
+            PipelineSettings pipelineSettings;
+            pipelineSettings.slice = sliceSettings;
+            pipelineSettings.profile = profileSettings;
+            pipelineSettings.fitArcs = pipelineFitArcs;
+            pipelineSettings.arcFit = arcFitSettings;
+            if (restOnly) {
+                pipelineSettings.rest = restOperations;
+            }
+            bool updated = toolpathPipeline.update(pipelineSettings);
+            if (updated) {
+                slicedLayers = toolpathPipeline.layers();
+                slicedLayersGeneration++;
+                if (restOnly) {
+                    restStats = toolpathPipeline.restStats();
+                }
+            }
+            if (toolpathSource != ToolpathSource::Profile) {
+                // Keep adaptive, worker and opened toolpaths until asked to switch back
+                ImGui::Text("Keeping the %s toolpaths", toolpathSourceNames[static_cast<int>(toolpathSource)]);
+                ImGui::SameLine();
+                if (ImGui::Button("Use Live Toolpaths")) {
+                    toolpathSource = ToolpathSource::Profile;
+                    updated = true;
+                }
+            }
+            if (updated && toolpathSource == ToolpathSource::Profile) {
+                toolpaths = toolpathPipeline.toolpaths();
+                compactToolpath.build(toolpaths);
+                toolpathsDecoded = true;
+                rebuildToolpathPreview();
+                feedPlan = FeedPlan();
+                arcFitStats = ArcFitStats();
+            }
+            const PipelineStageStats& slices = toolpathPipeline.stats(STAGE_SLICES);
+            const PipelineStageStats& layerPaths = toolpathPipeline.stats(STAGE_TOOLPATHS);
+            ImGui::Text("Update %.1f ms: %zu layers sliced (%zu cached), %zu profiled (%zu cached)", toolpathPipeline.lastUpdateMs(),
+                slices.computed, slices.reused, layerPaths.computed, layerPaths.reused);
+            if (restOnly && !restOperations.empty()) {
+                const PipelineStageStats& restPaths = toolpathPipeline.stats(STAGE_REST);
+                ImGui::Text("Rest material: %zu layers restricted (%zu cached)", restPaths.computed, restPaths.reused);
+            }
+        }
+        bool farmBusy = farmJob.valid();
+        if (ImGui::Button("Generate in Worker Processes") && !slicedLayers.empty() && !farmBusy) {
+            if (!workerFarm.isRunning()) {
+                workerFarm.start();
+            }
+            FarmJob job;
+            job.layers = slicedLayers;
+            job.profile = profileSettings;
+            farmJob = workerFarm.submit(std::move(job));
+        }
+        if (farmBusy && farmJob.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            lastFarmResult = farmJob.get();
+            if (lastFarmResult.ok) {
+                toolpaths = std::move(lastFarmResult.toolpaths);
+                toolpathSource = ToolpathSource::WorkerFarm;
+                compactToolpath.build(toolpaths);
+                toolpathsDecoded = true;
+                rebuildToolpathPreview();
+                feedPlan = FeedPlan();
+                arcFitStats = ArcFitStats();
+            }
+        }
+        if (farmJob.valid()) {
+            ImGui::SameLine();
+            ImGui::Text("%zu units queued on %zu workers", workerFarm.queuedUnits(), workerFarm.workerCount());
+        }
+        else if (lastFarmResult.units > 0) {
+            ImGui::SameLine();
+            ImGui::Text("%zu units, %zu retried, %zu failed", lastFarmResult.units, lastFarmResult.retries, lastFarmResult.failedUnits);
+        }
+        if (hasToolpaths()) {
+            ImGui::SameLine();
+            ImGui::Text("%zu paths, %zu moves", compactToolpath.pathCount(), compactToolpath.moveCount());
+        }
+        if (!compactToolpath.isEmpty() && compactToolpath.moveCount() > 0) {
+            ImGui::Text("Compact toolpath: %.2f MB (%.2f bytes/move)", compactToolpath.byteSize() / (1024.0 * 1024.0),
+                double(compactToolpath.byteSize()) / compactToolpath.moveCount());
+        }
+        ImGui::InputFloat("Arc Tolerance", &arcFitSettings.tolerance, 0.001f, 0.01f, "%.4f");
+        if (ImGui::Button("Fit Arcs (G2/G3)") && hasToolpaths()) {
+            toolpaths = fitArcs(editableToolpaths(), arcFitSettings, &arcFitStats);
+            compactToolpath.build(toolpaths);
+            toolpathsDecoded = true;
+            rebuildToolpathPreview();
+            feedPlan = FeedPlan();
+        }
+        if (arcFitStats.arcs > 0) {
+            ImGui::SameLine();
+            ImGui::Text("%zu -> %zu moves (%zu arcs)", arcFitStats.movesIn, arcFitStats.movesOut, arcFitStats.arcs);
+        }
+
+        ImGui::Text("Rest Machining");
+        if (ImGui::Button("Add Tool as Previous Operation") && !slicedLayers.empty()) {
+            RestOperation operation;
+            operation.toolRadius = profileSettings.toolRadius;
+            for (const Layer& layer : slicedLayers) {
+                operation.heights.push_back(layer.height);
+            }
+            restOperations.push_back(operation);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Clear Operations")) {
+            restOperations.clear();
+            restStats = RestStats();
+        }
+        ImGui::Checkbox("Rest Material Only", &restOnly);
+        ImGui::SameLine();
+        ImGui::Text("%zu previous operations", restOperations.size());
+        for (const RestOperation& operation : restOperations) {
+            ImGui::BulletText("Tool radius %.3f, %zu depths", operation.toolRadius, operation.heights.size());
+        }
+        if (restOnly && restStats.layers > 0) {
+            ImGui::Text("Rest material on %zu layers (area %.1f)", restStats.layers, restStats.area);
+        }
+
+        ImGui::Text("Adaptive Clearing");
+        ImGui::InputFloat("Stepover (of diameter)", &adaptiveSettings.stepover, 0.01f, 0.05f, "%.2f");
+        ImGui::InputFloat("Engagement Tolerance", &adaptiveSettings.engagementTolerance, 0.05f, 0.1f, "%.2f");
+        ImGui::InputFloat("Stock Margin", &adaptiveSettings.stockMargin, 0.5f, 1.0f, "%.2f");
+        ImGui::InputFloat("Adaptive Feedrate", &adaptiveSettings.feedrate, 10.0f, 100.0f, "%.0f");
+        ImGui::Checkbox("Finishing Profile", &adaptiveSettings.finishPass);
+        if (ImGui::Button("Generate Adaptive Toolpaths") && !slicedLayers.empty()) {
+            double start = glfwGetTime();
+            adaptiveSettings.toolRadius = profileSettings.toolRadius;
+            adaptiveSettings.plungeFeedrate = profileSettings.plungeFeedrate;
+            adaptiveSettings.climb = profileSettings.climb;
+            std::vector<ClipperLib::Paths> rest = restForTool(adaptiveSettings.toolRadius);
+            toolpaths = generateAdaptiveToolpaths(slicedLayers, adaptiveSettings, &adaptiveStats, rest.empty() ? nullptr : &rest);
+            lastAdaptiveMs = (glfwGetTime() - start) * 1000.0;
+            toolpathSource = ToolpathSource::Adaptive;
+            compactToolpath.build(toolpaths);
+            toolpathsDecoded = true;
+            rebuildToolpathPreview();
+            feedPlan = FeedPlan();
+            arcFitStats = ArcFitStats();
+        }
+        if (adaptiveStats.regions > 0) {
+            ImGui::Text("%zu regions, %zu passes, engagement %.0f-%.0f%% of diameter (%.1f ms)", adaptiveStats.regions,
+                adaptiveStats.passes, adaptiveStats.minEngagement * 100.0f, adaptiveStats.maxEngagement * 100.0f, lastAdaptiveMs);
+        }
+
+        ImGui::Text("Collision Checking");
+        ImGui::InputFloat("Flute Length", &collisionSettings.tool.fluteLength, 1.0f, 5.0f, "%.1f");
+        ImGui::InputFloat("Shank Radius", &collisionSettings.tool.shankRadius, 0.1f, 1.0f, "%.2f");
+        ImGui::InputFloat("Stickout", &collisionSettings.tool.stickout, 1.0f, 5.0f, "%.1f");
+        ImGui::InputFloat("Holder Radius", &collisionSettings.tool.holderRadius, 1.0f, 5.0f, "%.1f");
+        ImGui::InputFloat("Holder Length", &collisionSettings.tool.holderLength, 1.0f, 5.0f, "%.1f");
+        ImGui::InputFloat("Holder Clearance", &collisionSettings.clearance, 0.1f, 1.0f, "%.2f");
+        ImGui::Checkbox("Check on Regeneration", &checkCollisions);
+        ImGui::SameLine();
+        ImGui::Checkbox("Stop at First", &collisionSettings.stopAtFirst);
+        if (ImGui::Button("Check Collisions") && hasToolpaths()) {
+            rebuildToolpathPreview(true);
+        }
+        if (collisionJob.valid()) {
+            ImGui::SameLine();
+            ImGui::Text("Checking...");
+        }
+        else if (collisionReport.moves.size() > 0) {
+            ImGui::SameLine();
+            if (collisionReport.collidingMoves > 0) {
+                ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "%zu colliding moves (tool %zu, shank %zu, holder %zu)%s", collisionReport.collidingMoves,
+                    collisionReport.toolHits, collisionReport.shankHits, collisionReport.holderHits, collisionReport.complete ? "" : ", stopped early");
+            }
+            else {
+                ImGui::Text("No collisions");
+            }
+            ImGui::Text("Checked %zu moves against %zu triangles in %.1f ms", collisionReport.moves.size(), collisionChecker.triangleCount(), collisionReport.ms);
+        }
+
+        ImGui::Text("Feed Planning");
+        ImGui::InputFloat3("Max Velocity (XYZ)", glm::value_ptr(machineLimits.maxVelocity), "%.0f");
+        ImGui::InputFloat3("Max Acceleration (XYZ)", glm::value_ptr(machineLimits.maxAcceleration), "%.0f");
+        ImGui::InputFloat("Rapid Feedrate", &machineLimits.rapidFeedrate, 100.0f, 1000.0f, "%.0f");
+        ImGui::InputFloat("Junction Deviation", &machineLimits.junctionDeviation, 0.001f, 0.01f, "%.4f");
+        bool sCurve = machineLimits.profile == VelocityProfile::SCurve;
+        if (ImGui::Checkbox("S-Curve Acceleration", &sCurve)) {
+            machineLimits.profile = sCurve ? VelocityProfile::SCurve : VelocityProfile::Trapezoidal;
+        }
+        if (sCurve) {
+            ImGui::InputFloat("Max Jerk", &machineLimits.maxJerk, 100.0f, 1000.0f, "%.0f");
+        }
+        if (ImGui::Button("Estimate Cycle Time") && hasToolpaths()) {
+            double start = glfwGetTime();
+            feedPlan = planFeedrates(editableToolpaths(), machineLimits);
+            lastPlanMs = (glfwGetTime() - start) * 1000.0;
+        }
+        if (feedPlan.totalTime > 0.0) {
+            int seconds = static_cast<int>(feedPlan.totalTime + 0.5);
+            ImGui::Text("Cycle time %d:%02d:%02d (cutting %.0f s, rapids %.0f s; planned in %.1f ms)", seconds / 3600, seconds / 60 % 60,
+                seconds % 60, feedPlan.cuttingTime, feedPlan.rapidTime, lastPlanMs);
+        }
+
+        ImGui::Text("Large Scan Streaming");
+        if (largeScanBuild.valid()) {
+            ImGui::ProgressBar(largeScanProgress, ImVec2(-1.0f, 0.0f), "Building meshlet pages...");
+        }
+        ImGui::SliderInt("Scan Memory Budget (MB)", &largeScanBudgetMB, 64, 8192);
+        if (largeScan.isOpen()) {
+            ImGui::Text("Pages resident: %zu / %zu (%.1f MB)", largeScan.residentPageCount(), largeScan.pageCount(), largeScan.residentBytes() / (1024.0 * 1024.0));
+            ImGui::Text("Triangles drawn: %llu / %llu", largeScan.drawnTriangles(), largeScan.totalTriangles());
+        }
+
+        ImGui::Text("Memory");
+        bool keepCpuCopies = memoryPolicy.cpuCopies == CpuCopyPolicy::Keep;
+        if (ImGui::Checkbox("Keep CPU Mesh Copies", &keepCpuCopies)) {
+            memoryPolicy.cpuCopies = keepCpuCopies ? CpuCopyPolicy::Keep : CpuCopyPolicy::Release;
+            applyMemoryPolicy(meshes);
+        }
+        MeshMemory meshTotal = totalMeshMemory(meshes);
+        double totalMB = (meshTotal.cpuBytes + meshTotal.gpuBytes + compactToolpath.byteSize()) / (1024.0 * 1024.0);
+        ImVec4 budgetColor = totalMB > double(memoryPolicy.budgetMB) ? ImVec4(1.0f, 0.3f, 0.3f, 1.0f) : ImVec4(1.0f, 1.0f, 1.0f, 1.0f);
+        ImGui::TextColored(budgetColor, "Meshes: %.1f MB CPU, %.1f MB GPU (%.0f / %zu MB budget)",
+            meshTotal.cpuBytes / (1024.0 * 1024.0), meshTotal.gpuBytes / (1024.0 * 1024.0), totalMB, memoryPolicy.budgetMB);
+        if (!meshes.empty() && ImGui::CollapsingHeader("Per-Mesh Memory")) {
+            for (size_t i = 0; i < meshes.size(); i++) {
+                MeshMemory memory = meshMemory(meshes[i]);
+                ImGui::Text("Mesh %zu: %u tris, %.2f MB CPU, %.2f MB GPU", i, unsigned(meshes[i].indexCount / 3),
+                    memory.cpuBytes / (1024.0 * 1024.0), memory.gpuBytes / (1024.0 * 1024.0));
+            }
+        }
 
         ImGui::Text("Scene Info");
         ImGui::Text("Camera Position: (%.2f, %.2f, %.2f)", camera.position.x, camera.position.y, camera.position.z);
         ImGui::Text("Camera Yaw: %.2f, Pitch: %.2f", camera.yaw, camera.pitch);
         ImGui::Text("FOV: %.2f, Zoom: %.2f", fov, camera.distance);
         ImGui::Text("Light Position: (%.2f, %.2f, %.2f)", lightPos.x, lightPos.y, lightPos.z);
+        ImGui::Text("Draw calls: %u, triangles: %llu", renderStats.drawCalls, renderStats.triangles);
+        ImGui::Text("Shaders: %d from cache, %d compiled%s", shaderManager.cacheHitCount(), shaderManager.compiledCount(),
+            shaderManager.isBinaryCacheSupported() ? "" : " (no binary cache)");
 
         ImGui::End();
 
@@ -370,6 +1024,17 @@ int main() {
         glfwSwapBuffers(window);
     }
 
+    if (largeScanBuild.valid()) {
+        largeScanBuild.wait();
+    }
+    cancelCollisionCheck();
+    largeScan.close();
+    toolpathPreview.release();
+    sectionView.release();
+    compactToolpath.clear();
+    shaderManager.release();
+    workerFarm.stop();
+
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -0,0 +1,85 @@
+// mappedfile.cpp
+#include "mappedfile.h"
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        std::cerr << "Error: Could not open " << path << std::endl;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        std::cerr << "Error: Could not map empty file " << path << std::endl;
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!view) {
+        std::cerr << "Error: Could not map " << path << std::endl;
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    fileHandle = file;
+    mappingHandle = mapping;
+    bytes = static_cast<const unsigned char*>(view);
+    length = static_cast<size_t>(fileSize.QuadPart);
+#else
+    int file = ::open(path.c_str(), O_RDONLY);
+    if (file < 0) {
+        std::cerr << "Error: Could not open " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(file, &info) != 0 || info.st_size == 0) {
+        std::cerr << "Error: Could not map empty file " << path << std::endl;
+        ::close(file);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);  // The mapping keeps the file referenced
+    if (view == MAP_FAILED) {
+        std::cerr << "Error: Could not map " << path << std::endl;
+        return false;
+    }
+    bytes = static_cast<const unsigned char*>(view);
+    length = static_cast<size_t>(info.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::close() {
+    if (!bytes) return;
+#ifdef _WIN32
+    UnmapViewOfFile(bytes);
+    CloseHandle(static_cast<HANDLE>(mappingHandle));
+    CloseHandle(static_cast<HANDLE>(fileHandle));
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+#else
+    munmap(const_cast<unsigned char*>(bytes), length);
+#endif
+    bytes = nullptr;
+    length = 0;
+}
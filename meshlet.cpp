@@ -0,0 +1,941 @@
+// meshlet.cpp
+#include "meshlet.h"
+#include "frustum.h"
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+#include <filesystem>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <iostream>
+
+namespace {
+
+// Triangles per temporary bucket during preprocessing. A bucket is sorted in memory,
+// so this bounds the peak memory of the preprocessor regardless of the scan size.
+const unsigned long long TRIANGLES_PER_BUCKET = 1ull << 21;
+const unsigned int MORTON_PREFIX_BITS = 15;
+const unsigned int MAX_UPLOADS_PER_FRAME = 8;
+
+struct RawTriangle {
+    float v[9];
+};
+
+typedef std::function<void(const RawTriangle&)> TriangleCallback;
+
+// Binary STL: 80 byte header, triangle count, then 50 bytes per triangle
+bool forEachBinaryStlTriangle(std::ifstream& file, unsigned int count, const TriangleCallback& callback) {
+    const size_t chunkTriangles = 65536;
+    std::vector<char> buffer(chunkTriangles * 50);
+    unsigned int remaining = count;
+
+    file.seekg(84, std::ios::beg);
+    while (remaining > 0) {
+        size_t n = std::min<size_t>(remaining, chunkTriangles);
+        file.read(buffer.data(), n * 50);
+        if (!file) return false;
+
+        for (size_t i = 0; i < n; i++) {
+            RawTriangle tri;
+            std::memcpy(tri.v, buffer.data() + i * 50 + 12, sizeof(tri.v)); // Skip the facet normal
+            callback(tri);
+        }
+        remaining -= static_cast<unsigned int>(n);
+    }
+    return true;
+}
+
+// ASCII STL: only the "vertex x y z" lines matter
+bool forEachAsciiStlTriangle(std::ifstream& file, const TriangleCallback& callback) {
+    file.seekg(0, std::ios::beg);
+    std::string token;
+    RawTriangle tri;
+    int corner = 0;
+    while (file >> token) {
+        if (token != "vertex") continue;
+        file >> tri.v[corner * 3] >> tri.v[corner * 3 + 1] >> tri.v[corner * 3 + 2];
+        if (!file) return false;
+        if (++corner == 3) {
+            callback(tri);
+            corner = 0;
+        }
+    }
+    return true;
+}
+
+// Calls back once per triangle of the model. STL is streamed from disk, everything else
+// is loaded through Assimp the same way loadModel does.
+bool forEachTriangle(const std::string& path, const TriangleCallback& callback) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Error: Cannot open " << path << std::endl;
+        return false;
+    }
+
+    std::string extension = std::filesystem::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == ".stl") {
+        file.seekg(0, std::ios::end);
+        unsigned long long fileSize = static_cast<unsigned long long>(file.tellg());
+        char header[84] = {};
+        file.seekg(0, std::ios::beg);
+        file.read(header, sizeof(header));
+        unsigned int count = 0;
+        std::memcpy(&count, header + 80, sizeof(count));
+
+        if (file && fileSize == 84ull + 50ull * count) {
+            return forEachBinaryStlTriangle(file, count, callback);
+        }
+        file.clear();
+        return forEachAsciiStlTriangle(file, callback);
+    }
+
+    Assimp::Importer importer;
+    const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate);
+    if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
+        std::cerr << "Error loading model: " << importer.GetErrorString() << std::endl;
+        return false;
+    }
+
+    for (unsigned int m = 0; m < scene->mNumMeshes; m++) {
+        const aiMesh* mesh = scene->mMeshes[m];
+        for (unsigned int f = 0; f < mesh->mNumFaces; f++) {
+            const aiFace& face = mesh->mFaces[f];
+            if (face.mNumIndices != 3) continue;
+            RawTriangle tri;
+            for (int c = 0; c < 3; c++) {
+                const aiVector3D& p = mesh->mVertices[face.mIndices[c]];
+                tri.v[c * 3] = p.x;
+                tri.v[c * 3 + 1] = p.y;
+                tri.v[c * 3 + 2] = p.z;
+            }
+            callback(tri);
+        }
+    }
+    return true;
+}
+
+// Spreads the lower 10 bits of v so that there are two zero bits between each bit
+unsigned int expandBits(unsigned int v) {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+// 30 bit Morton code of the triangle centroid inside the model bounds
+unsigned int mortonCode(const RawTriangle& tri, const glm::vec3& boundsMin, const glm::vec3& invExtent) {
+    glm::vec3 centroid(
+        (tri.v[0] + tri.v[3] + tri.v[6]) / 3.0f,
+        (tri.v[1] + tri.v[4] + tri.v[7]) / 3.0f,
+        (tri.v[2] + tri.v[5] + tri.v[8]) / 3.0f);
+    glm::vec3 t = glm::clamp((centroid - boundsMin) * invExtent, glm::vec3(0.0f), glm::vec3(1.0f));
+    unsigned int x = std::min(static_cast<unsigned int>(t.x * 1024.0f), 1023u);
+    unsigned int y = std::min(static_cast<unsigned int>(t.y * 1024.0f), 1023u);
+    unsigned int z = std::min(static_cast<unsigned int>(t.z * 1024.0f), 1023u);
+    return (expandBits(x) << 2) | (expandBits(y) << 1) | expandBits(z);
+}
+
+struct VertexKey {
+    float p[3];
+    bool operator==(const VertexKey& other) const {
+        return std::memcmp(p, other.p, sizeof(p)) == 0;
+    }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey& key) const {
+        unsigned int bits[3];
+        std::memcpy(bits, key.p, sizeof(bits));
+        return (static_cast<size_t>(bits[0]) * 73856093u) ^ (static_cast<size_t>(bits[1]) * 19349663u) ^ (static_cast<size_t>(bits[2]) * 83492791u);
+    }
+};
+
+// Builds one page from up to MESHLETS_PER_PAGE meshlets of Morton-sorted triangles and
+// appends its payload to the output file. Vertices are shared inside the page and get
+// area-weighted normals, since scans rarely carry usable normals.
+void writePage(std::ostream& out, const std::vector<RawTriangle>& triangles, const std::vector<unsigned int>& order,
+    size_t first, size_t count, std::vector<MeshletPageInfo>& pageTable) {
+    std::vector<Meshlet> meshlets;
+    std::vector<float> vertices;
+    std::vector<unsigned int> indices;
+    std::unordered_map<VertexKey, unsigned int, VertexKeyHash> vertexMap;
+    vertexMap.reserve(count * 2);
+    indices.reserve(count * 3);
+
+    glm::vec3 pageMin(std::numeric_limits<float>::max());
+    glm::vec3 pageMax(-std::numeric_limits<float>::max());
+
+    for (size_t start = first; start < first + count; start += MESHLET_MAX_TRIANGLES) {
+        size_t end = std::min(start + MESHLET_MAX_TRIANGLES, first + count);
+        Meshlet meshlet;
+        glm::vec3 meshletMin(std::numeric_limits<float>::max());
+        glm::vec3 meshletMax(-std::numeric_limits<float>::max());
+        meshlet.indexOffset = static_cast<unsigned int>(indices.size());
+
+        for (size_t t = start; t < end; t++) {
+            const RawTriangle& tri = triangles[order[t]];
+            glm::vec3 a(tri.v[0], tri.v[1], tri.v[2]);
+            glm::vec3 b(tri.v[3], tri.v[4], tri.v[5]);
+            glm::vec3 c(tri.v[6], tri.v[7], tri.v[8]);
+            glm::vec3 faceNormal = glm::cross(b - a, c - a); // Length is twice the area
+
+            for (int corner = 0; corner < 3; corner++) {
+                VertexKey key;
+                std::memcpy(key.p, tri.v + corner * 3, sizeof(key.p));
+                auto inserted = vertexMap.emplace(key, static_cast<unsigned int>(vertices.size() / 6));
+                if (inserted.second) {
+                    vertices.insert(vertices.end(), { key.p[0], key.p[1], key.p[2], 0.0f, 0.0f, 0.0f });
+                }
+                unsigned int index = inserted.first->second;
+                vertices[index * 6 + 3] += faceNormal.x;
+                vertices[index * 6 + 4] += faceNormal.y;
+                vertices[index * 6 + 5] += faceNormal.z;
+                indices.push_back(index);
+
+                glm::vec3 p(key.p[0], key.p[1], key.p[2]);
+                meshletMin = glm::min(meshletMin, p);
+                meshletMax = glm::max(meshletMax, p);
+            }
+        }
+
+        meshlet.indexCount = static_cast<unsigned int>(indices.size()) - meshlet.indexOffset;
+        std::memcpy(meshlet.boundsMin, glm::value_ptr(meshletMin), sizeof(meshlet.boundsMin));
+        std::memcpy(meshlet.boundsMax, glm::value_ptr(meshletMax), sizeof(meshlet.boundsMax));
+        meshlets.push_back(meshlet);
+        pageMin = glm::min(pageMin, meshletMin);
+        pageMax = glm::max(pageMax, meshletMax);
+    }
+
+    for (size_t i = 0; i < vertices.size(); i += 6) {
+        glm::vec3 n(vertices[i + 3], vertices[i + 4], vertices[i + 5]);
+        float length = glm::length(n);
+        n = length > 0.0f ? n / length : glm::vec3(0.0f, 0.0f, 1.0f);
+        vertices[i + 3] = n.x;
+        vertices[i + 4] = n.y;
+        vertices[i + 5] = n.z;
+    }
+
+    MeshletPageInfo info = {};
+    info.parent = MESHLET_NO_PAGE;
+    std::memcpy(info.boundsMin, glm::value_ptr(pageMin), sizeof(info.boundsMin));
+    std::memcpy(info.boundsMax, glm::value_ptr(pageMax), sizeof(info.boundsMax));
+    info.fileOffset = static_cast<unsigned long long>(out.tellp());
+    info.meshletCount = static_cast<unsigned int>(meshlets.size());
+    info.vertexCount = static_cast<unsigned int>(vertices.size() / 6);
+    info.indexCount = static_cast<unsigned int>(indices.size());
+    info.byteSize = static_cast<unsigned int>(meshlets.size() * sizeof(Meshlet) + vertices.size() * sizeof(float) + indices.size() * sizeof(unsigned int));
+
+    out.write(reinterpret_cast<const char*>(meshlets.data()), meshlets.size() * sizeof(Meshlet));
+    out.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(float));
+    out.write(reinterpret_cast<const char*>(indices.data()), indices.size() * sizeof(unsigned int));
+    pageTable.push_back(info);
+}
+
+// Triangles of consecutive pages read back from the page file being built
+bool readPageTriangles(std::fstream& file, const std::vector<MeshletPageInfo>& pageTable, size_t first, size_t count,
+    std::vector<RawTriangle>& triangles) {
+    std::vector<char> payload;
+    for (size_t p = first; p < first + count; p++) {
+        const MeshletPageInfo& info = pageTable[p];
+        payload.resize(info.byteSize);
+        file.seekg(static_cast<std::streamoff>(info.fileOffset), std::ios::beg);
+        file.read(payload.data(), payload.size());
+        if (!file) return false;
+
+        const float* vertices = reinterpret_cast<const float*>(payload.data() + info.meshletCount * sizeof(Meshlet));
+        const unsigned int* indices = reinterpret_cast<const unsigned int*>(vertices + size_t(info.vertexCount) * 6);
+        for (unsigned int i = 0; i + 2 < info.indexCount; i += 3) {
+            RawTriangle tri;
+            for (int c = 0; c < 3; c++) {
+                std::memcpy(tri.v + c * 3, vertices + size_t(indices[i + c]) * 6, 3 * sizeof(float));
+            }
+            triangles.push_back(tri);
+        }
+    }
+    return true;
+}
+
+struct CellKey {
+    int x, y, z;
+    bool operator==(const CellKey& other) const {
+        return x == other.x && y == other.y && z == other.z;
+    }
+};
+
+struct CellKeyHash {
+    size_t operator()(const CellKey& key) const {
+        return (static_cast<size_t>(key.x) * 73856093u) ^ (static_cast<size_t>(key.y) * 19349663u) ^ (static_cast<size_t>(key.z) * 83492791u);
+    }
+};
+
+// Vertex clustering on a grid anchored at the model bounds: every vertex moves to the mean of
+// the vertices in its cell, and triangles that collapse or repeat are dropped. No vertex moves
+// further than a cell diagonal. Neighbouring parents use the same grid, so the cracks between
+// them stay below that error, which the cut keeps under a pixel.
+std::vector<RawTriangle> clusterTriangles(const std::vector<RawTriangle>& triangles, const glm::vec3& origin, float cell) {
+    std::unordered_map<CellKey, unsigned int, CellKeyHash> cellIndex;
+    std::vector<glm::vec4> cellSums;
+    std::vector<unsigned int> corners(triangles.size() * 3);
+    cellIndex.reserve(triangles.size());
+
+    for (size_t t = 0; t < triangles.size(); t++) {
+        for (int c = 0; c < 3; c++) {
+            glm::vec3 p(triangles[t].v[c * 3], triangles[t].v[c * 3 + 1], triangles[t].v[c * 3 + 2]);
+            glm::vec3 q = glm::floor((p - origin) / cell);
+            CellKey key = { static_cast<int>(q.x), static_cast<int>(q.y), static_cast<int>(q.z) };
+            auto inserted = cellIndex.emplace(key, static_cast<unsigned int>(cellSums.size()));
+            if (inserted.second) cellSums.push_back(glm::vec4(0.0f));
+            cellSums[inserted.first->second] += glm::vec4(p, 1.0f);
+            corners[t * 3 + c] = inserted.first->second;
+        }
+    }
+
+    std::vector<RawTriangle> clustered;
+    std::unordered_map<unsigned long long, char> seen;
+    for (size_t t = 0; t < triangles.size(); t++) {
+        unsigned int a = corners[t * 3], b = corners[t * 3 + 1], c = corners[t * 3 + 2];
+        if (a == b || b == c || a == c) continue;
+
+        // The same cell triangle can come from several source triangles
+        unsigned int sorted[3] = { a, b, c };
+        std::sort(sorted, sorted + 3);
+        unsigned long long key = (static_cast<unsigned long long>(sorted[0]) << 42) ^ (static_cast<unsigned long long>(sorted[1]) << 21) ^ sorted[2];
+        if (!seen.emplace(key, 0).second) continue;
+
+        RawTriangle tri;
+        const unsigned int cells[3] = { a, b, c };
+        for (int k = 0; k < 3; k++) {
+            glm::vec3 mean = glm::vec3(cellSums[cells[k]]) / cellSums[cells[k]].w;
+            tri.v[k * 3] = mean.x;
+            tri.v[k * 3 + 1] = mean.y;
+            tri.v[k * 3 + 2] = mean.z;
+        }
+        clustered.push_back(tri);
+    }
+    return clustered;
+}
+
+// Reads and checks the header and page table, so that a truncated or foreign file is never
+// streamed from
+bool readPageTable(const std::string& pagePath, MeshletFileHeader& header, std::vector<MeshletPageInfo>& pageTable) {
+    std::ifstream file(pagePath, std::ios::binary | std::ios::ate);
+    if (!file) return false;
+    unsigned long long fileSize = static_cast<unsigned long long>(file.tellg());
+    file.seekg(0, std::ios::beg);
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, "MTPM", 4) != 0 || header.version != MESHLET_FILE_VERSION) return false;
+    if (header.pageCount == 0 || header.rootPage >= header.pageCount) return false;
+    if (header.pageTableOffset < sizeof(header) || header.pageTableOffset > fileSize
+        || (fileSize - header.pageTableOffset) != static_cast<unsigned long long>(header.pageCount) * sizeof(MeshletPageInfo)) return false;
+
+    pageTable.resize(header.pageCount);
+    file.seekg(static_cast<std::streamoff>(header.pageTableOffset), std::ios::beg);
+    file.read(reinterpret_cast<char*>(pageTable.data()), pageTable.size() * sizeof(MeshletPageInfo));
+    if (!file) return false;
+
+    for (const MeshletPageInfo& info : pageTable) {
+        unsigned long long payload = static_cast<unsigned long long>(info.meshletCount) * sizeof(Meshlet)
+            + static_cast<unsigned long long>(info.vertexCount) * 6 * sizeof(float) + static_cast<unsigned long long>(info.indexCount) * sizeof(unsigned int);
+        if (payload != info.byteSize || info.fileOffset < sizeof(header) || info.fileOffset > header.pageTableOffset
+            || info.byteSize > header.pageTableOffset - info.fileOffset) return false;
+        if (info.childCount > 0 && (info.firstChild >= header.pageCount || info.childCount > header.pageCount - info.firstChild)) return false;
+        if (info.parent != MESHLET_NO_PAGE && info.parent >= header.pageCount) return false;
+    }
+    return true;
+}
+
+// Writes the whole page file; bucketPaths lists every temporary file it creates so that the
+// caller can remove them whatever happens
+bool writePageFile(const std::string& modelPath, const std::string& pagePath, std::vector<std::string>& bucketPaths,
+    std::atomic<float>* progress) {
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+    unsigned long long triangleCount = 0;
+    double surfaceArea = 0.0;
+
+    // Pass 1: bounds and area, which sets the grid of the first simplified level
+    bool ok = forEachTriangle(modelPath, [&](const RawTriangle& tri) {
+        glm::vec3 p[3];
+        for (int c = 0; c < 3; c++) {
+            p[c] = glm::vec3(tri.v[c * 3], tri.v[c * 3 + 1], tri.v[c * 3 + 2]);
+            boundsMin = glm::min(boundsMin, p[c]);
+            boundsMax = glm::max(boundsMax, p[c]);
+        }
+        surfaceArea += 0.5 * glm::length(glm::cross(p[1] - p[0], p[2] - p[0]));
+        triangleCount++;
+    });
+    if (!ok || triangleCount == 0) {
+        std::cerr << "Error: No triangles read from " << modelPath << std::endl;
+        return false;
+    }
+    if (progress) *progress = 0.1f;
+
+    glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+    glm::vec3 invExtent = 1.0f / extent;
+
+    // Pass 2: histogram of Morton prefixes, grouped into contiguous buckets
+    std::vector<unsigned long long> histogram(size_t(1) << MORTON_PREFIX_BITS, 0);
+    ok = forEachTriangle(modelPath, [&](const RawTriangle& tri) {
+        histogram[mortonCode(tri, boundsMin, invExtent) >> (30 - MORTON_PREFIX_BITS)]++;
+    });
+    if (!ok) return false;
+    if (progress) *progress = 0.2f;
+
+    std::vector<unsigned short> prefixToBucket(histogram.size());
+    unsigned int bucketCount = 1;
+    unsigned long long bucketSize = 0;
+    for (size_t i = 0; i < histogram.size(); i++) {
+        if (bucketSize > 0 && bucketSize + histogram[i] > TRIANGLES_PER_BUCKET) {
+            bucketCount++;
+            bucketSize = 0;
+        }
+        prefixToBucket[i] = static_cast<unsigned short>(bucketCount - 1);
+        bucketSize += histogram[i];
+    }
+
+    // Pass 3: distribute triangles into bucket files
+    std::vector<std::ofstream> bucketFiles(bucketCount);
+    for (unsigned int b = 0; b < bucketCount; b++) {
+        bucketPaths.push_back(pagePath + ".bucket" + std::to_string(b) + ".tmp");
+        bucketFiles[b].open(bucketPaths[b], std::ios::binary | std::ios::trunc);
+        if (!bucketFiles[b]) {
+            std::cerr << "Error: Cannot create temporary file " << bucketPaths[b] << std::endl;
+            return false;
+        }
+    }
+    ok = forEachTriangle(modelPath, [&](const RawTriangle& tri) {
+        unsigned int bucket = prefixToBucket[mortonCode(tri, boundsMin, invExtent) >> (30 - MORTON_PREFIX_BITS)];
+        bucketFiles[bucket].write(reinterpret_cast<const char*>(&tri), sizeof(tri));
+    });
+    for (unsigned int b = 0; b < bucketCount; b++) {
+        bucketFiles[b].close();
+        if (!bucketFiles[b]) {
+            std::cerr << "Error: Failed writing temporary file " << bucketPaths[b] << std::endl;
+            return false;
+        }
+    }
+    if (!ok) return false;
+    if (progress) *progress = 0.4f;
+
+    // Write pages bucket by bucket; the header is rewritten once the table is known. The file
+    // is also read back while the coarser levels are built.
+    std::fstream out(pagePath, std::ios::binary | std::ios::in | std::ios::out | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Error: Cannot create page file " << pagePath << std::endl;
+        return false;
+    }
+    MeshletFileHeader header = {};
+    std::memcpy(header.magic, "MTPM", 4);
+    header.version = MESHLET_FILE_VERSION;
+    header.triangleCount = triangleCount;
+    std::memcpy(header.boundsMin, glm::value_ptr(boundsMin), sizeof(header.boundsMin));
+    std::memcpy(header.boundsMax, glm::value_ptr(boundsMax), sizeof(header.boundsMax));
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<MeshletPageInfo> pageTable;
+    const size_t trianglesPerPage = size_t(MESHLET_MAX_TRIANGLES) * MESHLETS_PER_PAGE;
+    for (unsigned int b = 0; b < bucketCount; b++) {
+        std::vector<RawTriangle> triangles;
+        {
+            std::ifstream in(bucketPaths[b], std::ios::binary | std::ios::ate);
+            size_t bytes = static_cast<size_t>(in.tellg());
+            triangles.resize(bytes / sizeof(RawTriangle));
+            in.seekg(0, std::ios::beg);
+            in.read(reinterpret_cast<char*>(triangles.data()), triangles.size() * sizeof(RawTriangle));
+            if (!in) {
+                std::cerr << "Error: Failed reading temporary file " << bucketPaths[b] << std::endl;
+                return false;
+            }
+        }
+        std::remove(bucketPaths[b].c_str());
+
+        std::vector<unsigned int> codes(triangles.size());
+        std::vector<unsigned int> order(triangles.size());
+        for (size_t i = 0; i < triangles.size(); i++) {
+            codes[i] = mortonCode(triangles[i], boundsMin, invExtent);
+            order[i] = static_cast<unsigned int>(i);
+        }
+        std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int c) { return codes[a] < codes[c]; });
+
+        for (size_t first = 0; first < order.size(); first += trianglesPerPage) {
+            writePage(out, triangles, order, first, std::min(trianglesPerPage, order.size() - first), pageTable);
+        }
+        if (!out) {
+            std::cerr << "Error: Failed writing page file " << pagePath << std::endl;
+            return false;
+        }
+        if (progress) *progress = 0.4f + 0.5f * float(b + 1) / float(bucketCount);
+    }
+
+    // Coarser levels: every MESHLET_PAGE_CHILDREN consecutive pages, which are neighbours in
+    // Morton order, get a simplified parent, until a single root remains. The grid doubles per
+    // level, roughly quartering the triangles of a surface like the page count.
+    float cell = 2.0f * static_cast<float>(std::sqrt(surfaceArea / double(triangleCount)));
+    if (!(cell > 0.0f)) cell = glm::length(extent) * 1e-3f;
+    size_t levelBegin = 0, levelEnd = pageTable.size();
+    unsigned int level = 0;
+    while (levelEnd - levelBegin > 1) {
+        level++;
+        for (size_t first = levelBegin; first < levelEnd; first += MESHLET_PAGE_CHILDREN) {
+            size_t count = std::min<size_t>(MESHLET_PAGE_CHILDREN, levelEnd - first);
+            std::vector<RawTriangle> triangles;
+            if (!readPageTriangles(out, pageTable, first, count, triangles)) {
+                std::cerr << "Error: Failed reading back page file " << pagePath << std::endl;
+                return false;
+            }
+
+            // A page that still does not fit gets a coarser grid of its own. The error adds up
+            // over the levels, so a parent is never more accurate than its children.
+            float childError = 0.0f;
+            for (size_t c = first; c < first + count; c++) childError = std::max(childError, pageTable[c].error);
+            float pageCell = cell;
+            std::vector<RawTriangle> simplified = clusterTriangles(triangles, boundsMin, pageCell);
+            while (simplified.size() > trianglesPerPage) {
+                pageCell *= 2.0f;
+                simplified = clusterTriangles(triangles, boundsMin, pageCell);
+            }
+
+            std::vector<unsigned int> codes(simplified.size());
+            std::vector<unsigned int> order(simplified.size());
+            for (size_t i = 0; i < simplified.size(); i++) {
+                codes[i] = mortonCode(simplified[i], boundsMin, invExtent);
+                order[i] = static_cast<unsigned int>(i);
+            }
+            std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int c) { return codes[a] < codes[c]; });
+
+            out.seekp(0, std::ios::end);
+            unsigned int parent = static_cast<unsigned int>(pageTable.size());
+            writePage(out, simplified, order, 0, simplified.size(), pageTable);
+            MeshletPageInfo& info = pageTable.back();
+            if (simplified.empty()) {
+                // Everything collapsed; keep the children's bounds so that the page is still culled sensibly
+                std::memcpy(info.boundsMin, pageTable[first].boundsMin, sizeof(info.boundsMin));
+                std::memcpy(info.boundsMax, pageTable[first].boundsMax, sizeof(info.boundsMax));
+            }
+            for (size_t c = first; c < first + count; c++) {
+                for (int axis = 0; axis < 3; axis++) {
+                    info.boundsMin[axis] = std::min(info.boundsMin[axis], pageTable[c].boundsMin[axis]);
+                    info.boundsMax[axis] = std::max(info.boundsMax[axis], pageTable[c].boundsMax[axis]);
+                }
+                pageTable[c].parent = parent;
+            }
+            info.error = childError + pageCell * 1.7320508f;
+            info.level = level;
+            info.firstChild = static_cast<unsigned int>(first);
+            info.childCount = static_cast<unsigned int>(count);
+            if (!out) {
+                std::cerr << "Error: Failed writing page file " << pagePath << std::endl;
+                return false;
+            }
+        }
+        levelBegin = levelEnd;
+        levelEnd = pageTable.size();
+        cell *= 2.0f;
+    }
+    if (progress) *progress = 1.0f;
+
+    header.pageCount = static_cast<unsigned int>(pageTable.size());
+    header.rootPage = static_cast<unsigned int>(levelBegin);
+    out.seekp(0, std::ios::end);
+    header.pageTableOffset = static_cast<unsigned long long>(out.tellp());
+    out.write(reinterpret_cast<const char*>(pageTable.data()), pageTable.size() * sizeof(MeshletPageInfo));
+    out.seekp(0, std::ios::beg);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+    if (!out) {
+        std::cerr << "Error: Failed writing page file " << pagePath << std::endl;
+        return false;
+    }
+
+    std::cout << "Built " << pageTable.size() << " pages in " << level + 1 << " levels for " << triangleCount << " triangles of "
+        << modelPath << std::endl;
+    return true;
+}
+
+} // namespace
+
+std::string meshletPagePath(const std::string& modelPath) {
+    return modelPath + ".mtpm";
+}
+
+bool isMeshletPageFileCurrent(const std::string& modelPath, const std::string& pagePath) {
+    std::error_code ec;
+    if (!std::filesystem::exists(pagePath, ec)) return false;
+    if (std::filesystem::last_write_time(pagePath, ec) < std::filesystem::last_write_time(modelPath, ec)) return false;
+    MeshletFileHeader header;
+    std::vector<MeshletPageInfo> pageTable;
+    return readPageTable(pagePath, header, pageTable);
+}
+
+// Preprocess a model into spatially clustered meshlet pages. Three streaming passes keep
+// the memory use bounded: bounds, a histogram of coarse Morton prefixes used to cut the
+// model into buckets of similar size, and the distribution of triangles into bucket files.
+// Each bucket is then sorted in memory and written out as pages, and the coarser levels are
+// built from the pages below them. The file is written under a temporary name and only
+// renamed into place once complete, so a failed build never leaves a page file behind.
+bool buildMeshletPageFile(const std::string& modelPath, const std::string& pagePath, std::atomic<float>* progress) {
+    std::string tempPath = pagePath + ".tmp";
+    std::vector<std::string> bucketPaths;
+    bool ok = writePageFile(modelPath, tempPath, bucketPaths, progress);
+    for (const std::string& bucketPath : bucketPaths) {
+        std::remove(bucketPath.c_str());
+    }
+
+    if (ok) {
+        std::error_code ec;
+        std::filesystem::rename(tempPath, pagePath, ec);
+        if (ec) {
+            std::cerr << "Error: Cannot replace page file " << pagePath << ": " << ec.message() << std::endl;
+            ok = false;
+        }
+    }
+    if (!ok) {
+        std::remove(tempPath.c_str());
+    }
+    return ok;
+}
+
+MeshletStreamer::MeshletStreamer() {
+}
+
+MeshletStreamer::~MeshletStreamer() {
+    close();
+}
+
+// Open a page file and start the disk reader thread
+bool MeshletStreamer::open(const std::string& pagePath) {
+    close();
+
+    std::vector<MeshletPageInfo> pageTable;
+    if (!readPageTable(pagePath, header, pageTable)) {
+        std::cerr << "Error: " << pagePath << " is not a valid page file" << std::endl;
+        header = {};
+        return false;
+    }
+
+    pages.resize(pageTable.size());
+    for (size_t i = 0; i < pageTable.size(); i++) {
+        pages[i].info = pageTable[i];
+    }
+
+    path = pagePath;
+    ioStop = false;
+    ioThread = std::thread(&MeshletStreamer::ioThreadMain, this);
+    return true;
+}
+
+// Stop the reader thread and free every resident page
+void MeshletStreamer::close() {
+    if (ioThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(ioMutex);
+            ioStop = true;
+        }
+        ioCondition.notify_all();
+        ioThread.join();
+    }
+    ioRequests.clear();
+    ioCompleted.clear();
+
+    for (unsigned int i = 0; i < pages.size(); i++) {
+        if (pages[i].resident) evictPage(i);
+    }
+    pages.clear();
+    drawList.clear();
+    usedBytes = 0;
+    residentPages = 0;
+    lastDrawnTriangles = 0;
+    header = {};
+}
+
+void MeshletStreamer::ioThreadMain() {
+    std::ifstream file(path, std::ios::binary);
+
+    while (true) {
+        unsigned int page;
+        {
+            std::unique_lock<std::mutex> lock(ioMutex);
+            ioCondition.wait(lock, [this] { return ioStop || !ioRequests.empty(); });
+            if (ioStop) return;
+            page = ioRequests.front();
+            ioRequests.pop_front();
+        }
+
+        LoadedPage loaded;
+        loaded.page = page;
+        loaded.payload.resize(pages[page].info.byteSize);
+        file.seekg(static_cast<std::streamoff>(pages[page].info.fileOffset), std::ios::beg);
+        file.read(loaded.payload.data(), loaded.payload.size());
+        if (!file) {
+            std::cerr << "Error: Failed reading page " << page << " from " << path << std::endl;
+            file.clear();
+            loaded.payload.clear();
+        }
+
+        std::lock_guard<std::mutex> lock(ioMutex);
+        ioCompleted.push_back(std::move(loaded));
+    }
+}
+
+// Create the GL buffers for a page; the payload is released afterwards so no CPU copy of
+// the geometry stays behind. Returns false for a payload whose ranges do not add up.
+bool MeshletStreamer::uploadPage(LoadedPage& loaded) {
+    MeshletPage& page = pages[loaded.page];
+    const MeshletPageInfo& info = page.info;
+
+    const char* data = loaded.payload.data();
+    const Meshlet* meshlets = reinterpret_cast<const Meshlet*>(data);
+    const char* vertices = data + info.meshletCount * sizeof(Meshlet);
+    const char* indices = vertices + info.vertexCount * 6 * sizeof(float);
+    for (unsigned int m = 0; m < info.meshletCount; m++) {
+        if (meshlets[m].indexOffset > info.indexCount || meshlets[m].indexCount > info.indexCount - meshlets[m].indexOffset) return false;
+    }
+    for (unsigned int i = 0; i < info.indexCount; i++) {
+        unsigned int index;
+        std::memcpy(&index, indices + i * sizeof(unsigned int), sizeof(index));
+        if (index >= info.vertexCount) return false;
+    }
+    page.meshlets.assign(meshlets, meshlets + info.meshletCount);
+
+    glGenVertexArrays(1, &page.VAO);
+    glGenBuffers(1, &page.VBO);
+    glGenBuffers(1, &page.EBO);
+
+    glBindVertexArray(page.VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, page.VBO);
+    glBufferData(GL_ARRAY_BUFFER, info.vertexCount * 6 * sizeof(float), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, page.EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, info.indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+
+    page.resident = true;
+    page.requested = false;
+    page.lastUsedFrame = frame;
+    residentPages++;
+    return true;
+}
+
+void MeshletStreamer::evictPage(unsigned int index) {
+    MeshletPage& page = pages[index];
+    glDeleteVertexArrays(1, &page.VAO);
+    glDeleteBuffers(1, &page.VBO);
+    glDeleteBuffers(1, &page.EBO);
+    page.VAO = page.VBO = page.EBO = 0;
+    page.meshlets.clear();
+    page.meshlets.shrink_to_fit();
+    page.resident = false;
+    usedBytes -= page.info.byteSize;
+    residentPages--;
+}
+
+// Decide which pages should be resident for this view. The cut starts at the root and the
+// page with the largest projected error is refined first, for as long as its error is
+// visible and its children fit in the budget. A parent stays wanted until all its visible
+// children are resident, so refining never opens holes. Unwanted pages are evicted least
+// recently used first.
+void MeshletStreamer::update(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, float fovY, float viewportHeight) {
+    if (pages.empty()) return;
+    frame++;
+
+    extractFrustumPlanes(viewProjection, frustumPlanes);
+
+    // Upload a bounded number of finished reads per frame to avoid hitches
+    std::deque<LoadedPage> completed;
+    {
+        std::lock_guard<std::mutex> lock(ioMutex);
+        while (!ioCompleted.empty() && completed.size() < MAX_UPLOADS_PER_FRAME) {
+            completed.push_back(std::move(ioCompleted.front()));
+            ioCompleted.pop_front();
+        }
+    }
+    for (LoadedPage& loaded : completed) {
+        MeshletPage& page = pages[loaded.page];
+        if (page.requested && !loaded.payload.empty() && uploadPage(loaded)) continue;
+        if (page.requested && !loaded.payload.empty()) {
+            std::cerr << "Error: Page " << loaded.page << " of " << path << " is corrupt" << std::endl;
+        }
+        // Cancelled while in flight, or the read failed
+        if (page.requested) usedBytes -= page.info.byteSize;
+        page.requested = false;
+    }
+
+    float pixelsPerUnit = viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+    for (MeshletPage& page : pages) {
+        page.priority = 0.0f;
+        page.refined = false;
+        page.visible = boxInFrustum(frustumPlanes, glm::make_vec3(page.info.boundsMin), glm::make_vec3(page.info.boundsMax));
+        if (!page.visible || page.info.error <= 0.0f) continue;
+
+        glm::vec3 pMin = glm::make_vec3(page.info.boundsMin);
+        glm::vec3 pMax = glm::make_vec3(page.info.boundsMax);
+        float distance = glm::length(glm::clamp(cameraPosition, pMin, pMax) - cameraPosition);
+        page.priority = distance > 1e-6f ? page.info.error / distance * pixelsPerUnit : std::numeric_limits<float>::max();
+    }
+
+    std::vector<char> wanted(pages.size(), 0);
+    size_t wantedBytes = 0;
+    unsigned int root = header.rootPage;
+    auto byPriority = [this](unsigned int a, unsigned int b) { return pages[a].priority < pages[b].priority; };
+    std::priority_queue<unsigned int, std::vector<unsigned int>, decltype(byPriority)> refine(byPriority);
+    if (pages[root].visible) {
+        wanted[root] = 1;
+        wantedBytes = pages[root].info.byteSize;
+        refine.push(root);
+    }
+    while (!refine.empty()) {
+        unsigned int i = refine.top();
+        refine.pop();
+        MeshletPage& page = pages[i];
+        if (page.info.childCount == 0 || page.priority <= maxPixelError) continue;
+
+        size_t childBytes = 0;
+        bool childrenResident = true;
+        for (unsigned int c = page.info.firstChild; c < page.info.firstChild + page.info.childCount; c++) {
+            if (!pages[c].visible) continue;
+            childBytes += pages[c].info.byteSize;
+            if (!pages[c].resident) childrenResident = false;
+        }
+        size_t releasedBytes = childrenResident ? page.info.byteSize : 0;
+        if (wantedBytes + childBytes - releasedBytes > memoryBudget) continue;
+
+        page.refined = true;
+        if (childrenResident) {
+            wanted[i] = 0;
+            wantedBytes -= page.info.byteSize;
+        }
+        for (unsigned int c = page.info.firstChild; c < page.info.firstChild + page.info.childCount; c++) {
+            if (!pages[c].visible) continue;
+            wanted[c] = 1;
+            wantedBytes += pages[c].info.byteSize;
+            refine.push(c);
+        }
+    }
+
+    // Cancel queued reads that are no longer wanted
+    {
+        std::lock_guard<std::mutex> lock(ioMutex);
+        for (auto it = ioRequests.begin(); it != ioRequests.end();) {
+            if (!wanted[*it]) {
+                pages[*it].requested = false;
+                usedBytes -= pages[*it].info.byteSize;
+                it = ioRequests.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    // Coarse pages first: they complete the cut soonest
+    std::vector<unsigned int> missing;
+    size_t missingBytes = 0;
+    for (unsigned int i = 0; i < pages.size(); i++) {
+        if (!wanted[i] || pages[i].resident || pages[i].requested) continue;
+        missing.push_back(i);
+        missingBytes += pages[i].info.byteSize;
+    }
+    std::sort(missing.begin(), missing.end(), [this](unsigned int a, unsigned int b) {
+        if (pages[a].info.level != pages[b].info.level) return pages[a].info.level > pages[b].info.level;
+        return pages[a].priority > pages[b].priority;
+    });
+
+    // Make room by evicting unwanted resident pages, least recently used first
+    if (usedBytes + missingBytes > memoryBudget) {
+        std::vector<unsigned int> evictable;
+        for (unsigned int i = 0; i < pages.size(); i++) {
+            if (pages[i].resident && !wanted[i]) evictable.push_back(i);
+        }
+        std::sort(evictable.begin(), evictable.end(), [this](unsigned int a, unsigned int b) {
+            return pages[a].lastUsedFrame < pages[b].lastUsedFrame;
+        });
+        for (unsigned int i : evictable) {
+            if (usedBytes + missingBytes <= memoryBudget) break;
+            evictPage(i);
+        }
+    }
+
+    // Request missing pages while they fit
+    bool requestedAny = false;
+    {
+        std::lock_guard<std::mutex> lock(ioMutex);
+        for (unsigned int i : missing) {
+            MeshletPage& page = pages[i];
+            if (usedBytes + page.info.byteSize > memoryBudget) break;
+            page.requested = true;
+            usedBytes += page.info.byteSize;
+            ioRequests.push_back(i);
+            requestedAny = true;
+        }
+    }
+    if (requestedAny) ioCondition.notify_one();
+
+    // Pages to draw: refined pages whose children are not all there yet draw themselves
+    drawList.clear();
+    if (pages[root].visible) gatherDraw(root);
+}
+
+// Appends the pages that cover a page's visible part in this frame's cut; false when
+// neither the page nor its children are resident yet
+bool MeshletStreamer::gatherDraw(unsigned int index) {
+    const MeshletPage& page = pages[index];
+    if (page.refined) {
+        size_t mark = drawList.size();
+        bool complete = true;
+        for (unsigned int c = page.info.firstChild; c < page.info.firstChild + page.info.childCount && complete; c++) {
+            if (pages[c].visible) complete = gatherDraw(c);
+        }
+        if (complete) return true;
+        drawList.resize(mark);
+    }
+    if (!page.resident) return false;
+    drawList.push_back(index);
+    return true;
+}
+
+// Draw the pages of the current cut; meshlets outside the frustum are skipped and the rest
+// of a page is submitted with a single multi-draw call
+void MeshletStreamer::render(GLuint shaderProgram) {
+    lastDrawnTriangles = 0;
+    if (drawList.empty()) return;
+
+    glUseProgram(shaderProgram);
+    glm::mat4 model(1.0f);
+    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+    for (unsigned int index : drawList) {
+        MeshletPage& page = pages[index];
+        page.lastUsedFrame = frame;
+
+        counts.clear();
+        offsets.clear();
+        for (const Meshlet& meshlet : page.meshlets) {
+            if (!boxInFrustum(frustumPlanes, glm::make_vec3(meshlet.boundsMin), glm::make_vec3(meshlet.boundsMax))) continue;
+            counts.push_back(static_cast<GLsizei>(meshlet.indexCount));
+            offsets.push_back(reinterpret_cast<const void*>(static_cast<uintptr_t>(meshlet.indexOffset) * sizeof(unsigned int)));
+            lastDrawnTriangles += meshlet.indexCount / 3;
+        }
+        if (counts.empty()) continue;
+
+        glBindVertexArray(page.VAO);
+        glMultiDrawElements(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(), static_cast<GLsizei>(counts.size()));
+    }
+    glBindVertexArray(0);
+}
@@ -0,0 +1,156 @@
+// meshlet.h
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <vector>
+#include <string>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <glm/glm.hpp>
+#include <GL/glew.h>      // Must be included before other OpenGL headers
+#include <GLFW/glfw3.h>   // GLFW should come after GLEW
+
+// Out-of-core rendering for very large scans. A model is preprocessed once into a
+// page file (*.mtpm): triangles are clustered spatially (Morton order) into meshlets,
+// meshlets are grouped into pages, and neighbouring pages are merged and simplified into
+// coarser parent pages up to a single root. At runtime a cut through that hierarchy is
+// chosen for the view: pages are refined while their simplification error is visible on
+// screen and their children fit in a fixed memory budget, so a distant or over-budget
+// view shows coarse geometry instead of holes.
+
+const unsigned int MESHLET_MAX_TRIANGLES = 128;    // Triangles per meshlet
+const unsigned int MESHLETS_PER_PAGE = 256;        // Meshlets per streamable page
+const unsigned int MESHLET_PAGE_CHILDREN = 4;      // Pages merged into one parent page
+const unsigned int MESHLET_NO_PAGE = 0xFFFFFFFFu;
+const unsigned int MESHLET_FILE_VERSION = 2;
+
+// Meshlet record as stored at the start of every page payload
+struct Meshlet {
+    float boundsMin[3];
+    float boundsMax[3];
+    unsigned int indexOffset;   // First index of this meshlet inside the page
+    unsigned int indexCount;
+};
+
+// Page table entry as stored at the end of the page file
+struct MeshletPageInfo {
+    float boundsMin[3];
+    float boundsMax[3];
+    unsigned long long fileOffset;  // Offset of the page payload in the file
+    unsigned int byteSize;          // Size of the payload (meshlets + vertices + indices)
+    unsigned int meshletCount;
+    unsigned int vertexCount;       // 6 floats per vertex (position + normal), like Mesh
+    unsigned int indexCount;
+    float error;                    // How far the simplified surface may be off, in model units (0 = full detail)
+    unsigned int level;             // 0 for full detail, parents one above their children
+    unsigned int parent;            // MESHLET_NO_PAGE for the root
+    unsigned int firstChild;        // Children are consecutive in the page table
+    unsigned int childCount;
+    unsigned int reserved;
+};
+
+// Header at the start of the page file
+struct MeshletFileHeader {
+    char magic[4];                  // "MTPM"
+    unsigned int version;
+    unsigned long long triangleCount;
+    unsigned long long pageTableOffset;
+    unsigned int pageCount;
+    unsigned int rootPage;
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+// Runtime state of one page
+struct MeshletPage {
+    MeshletPageInfo info;
+    std::vector<Meshlet> meshlets;  // Kept while resident for per-meshlet culling
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+    GLuint EBO = 0;
+    bool resident = false;
+    bool requested = false;
+    bool visible = false;
+    bool refined = false;           // Children are in this frame's cut instead of the page
+    unsigned long long lastUsedFrame = 0;
+    float priority = 0.0f;          // Projected error in pixels, 0 when culled or full detail
+};
+
+// Preprocess a model into a page file. STL files are streamed so that the whole scan
+// never has to fit in memory; other formats are read through Assimp.
+bool buildMeshletPageFile(const std::string& modelPath, const std::string& pagePath, std::atomic<float>* progress = nullptr);
+
+// Returns the page file path used for a model and whether it is up to date: complete,
+// readable and newer than the model
+std::string meshletPagePath(const std::string& modelPath);
+bool isMeshletPageFileCurrent(const std::string& modelPath, const std::string& pagePath);
+
+class MeshletStreamer {
+public:
+    MeshletStreamer();
+    ~MeshletStreamer();
+
+    bool open(const std::string& pagePath);
+    void close();
+    bool isOpen() const { return !pages.empty(); }
+
+    // Budget for resident page data (GPU buffers plus pages waiting for upload)
+    void setMemoryBudget(size_t bytes) { memoryBudget = bytes; }
+    size_t getMemoryBudget() const { return memoryBudget; }
+
+    // Pages are replaced by their children while their error is larger than this on screen
+    void setMaxPixelError(float pixels) { maxPixelError = pixels; }
+
+    // Recompute page priorities for the current view, evict and request pages, and
+    // upload pages that finished loading. Must be called on the GL thread.
+    void update(const glm::mat4& viewProjection, const glm::vec3& cameraPosition, float fovY, float viewportHeight);
+
+    // Draw all resident, visible meshlets with the currently bound shader program
+    void render(GLuint shaderProgram);
+
+    glm::vec3 boundsMin() const { return glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]); }
+    glm::vec3 boundsMax() const { return glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]); }
+
+    size_t pageCount() const { return pages.size(); }
+    size_t residentPageCount() const { return residentPages; }
+    size_t residentBytes() const { return usedBytes; }
+    unsigned long long totalTriangles() const { return header.triangleCount; }
+    unsigned long long drawnTriangles() const { return lastDrawnTriangles; }
+
+private:
+    struct LoadedPage {
+        unsigned int page;
+        std::vector<char> payload;
+    };
+
+    void ioThreadMain();
+    bool uploadPage(LoadedPage& loaded);
+    void evictPage(unsigned int page);
+    bool gatherDraw(unsigned int page);
+
+    std::string path;
+    MeshletFileHeader header = {};
+    std::vector<MeshletPage> pages;
+    glm::vec4 frustumPlanes[6];
+
+    size_t memoryBudget = size_t(1024) * 1024 * 1024;
+    size_t usedBytes = 0;          // Resident plus in-flight page bytes
+    size_t residentPages = 0;
+    float maxPixelError = 1.0f;
+    std::vector<unsigned int> drawList;     // Pages drawn this frame
+    unsigned long long frame = 0;
+    unsigned long long lastDrawnTriangles = 0;
+
+    // Disk reads run on a worker thread; GL uploads stay on the render thread
+    std::thread ioThread;
+    std::mutex ioMutex;
+    std::condition_variable ioCondition;
+    std::deque<unsigned int> ioRequests;
+    std::deque<LoadedPage> ioCompleted;
+    bool ioStop = false;
+};
+
+#endif // MESHLET_H
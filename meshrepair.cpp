@@ -0,0 +1,335 @@
+// meshrepair.cpp
+#include "meshrepair.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+struct EdgeRecord {
+    uint64_t key;           // Undirected edge (smaller vertex in the high bits)
+    unsigned int corner;    // Triangle * 3 + edge index, the edge starting at that corner
+};
+
+uint64_t edgeKey(unsigned int a, unsigned int b) {
+    return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+// Points every index at one representative of the vertices whose positions round to the same
+// grid point, ignoring any other attribute. The grid step is relative to the mesh size so
+// that float noise in exported coordinates does not keep seams open. Returns how many
+// vertices were merged away.
+size_t weldVertices(const std::vector<glm::vec3>& positions, std::vector<unsigned int>& indices) {
+    size_t vertexCount = positions.size();
+    if (vertexCount == 0) return 0;
+
+    glm::vec3 boundsMin = positions[0], boundsMax = positions[0];
+    for (const glm::vec3& p : positions) {
+        boundsMin = glm::min(boundsMin, p);
+        boundsMax = glm::max(boundsMax, p);
+    }
+    float extent = std::max(boundsMax.x - boundsMin.x, std::max(boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z));
+    float step = extent > 0.0f ? extent * 1e-6f : 1.0f;
+
+    struct WeldKey {
+        int64_t x, y, z;
+        unsigned int vertex;
+    };
+    std::vector<WeldKey> keys(vertexCount);
+    parallelFor(vertexCount, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; v++) {
+            glm::vec3 q = (positions[v] - boundsMin) / step;
+            keys[v] = { std::llround(q.x), std::llround(q.y), std::llround(q.z), static_cast<unsigned int>(v) };
+        }
+    });
+    parallelSort(keys.begin(), keys.end(), [](const WeldKey& a, const WeldKey& b) {
+        if (a.x != b.x) return a.x < b.x;
+        if (a.y != b.y) return a.y < b.y;
+        if (a.z != b.z) return a.z < b.z;
+        return a.vertex < b.vertex;
+    });
+
+    std::vector<unsigned int> representative(vertexCount);
+    size_t merged = 0;
+    for (size_t i = 0; i < vertexCount; i++) {
+        bool same = i > 0 && keys[i].x == keys[i - 1].x && keys[i].y == keys[i - 1].y && keys[i].z == keys[i - 1].z;
+        representative[keys[i].vertex] = same ? representative[keys[i - 1].vertex] : keys[i].vertex;
+        if (same) merged++;
+    }
+    if (merged == 0) return 0;
+
+    parallelFor(indices.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (indices[i] < vertexCount) indices[i] = representative[indices[i]];
+        }
+    });
+    return merged;
+}
+
+// Removes collapsed, out-of-range and zero-area triangles; returns how many were removed
+size_t removeDegenerateTriangles(const std::vector<glm::vec3>& positions, std::vector<unsigned int>& indices) {
+    size_t triangleCount = indices.size() / 3;
+    std::vector<char> keep(triangleCount);
+
+    parallelFor(triangleCount, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            unsigned int a = indices[t * 3], b = indices[t * 3 + 1], c = indices[t * 3 + 2];
+            if (a == b || b == c || a == c || a >= positions.size() || b >= positions.size() || c >= positions.size()) {
+                keep[t] = 0;
+                continue;
+            }
+            glm::vec3 ab = positions[b] - positions[a];
+            glm::vec3 ac = positions[c] - positions[a];
+            glm::vec3 bc = positions[c] - positions[b];
+            float longest = std::max(glm::dot(ab, ab), std::max(glm::dot(ac, ac), glm::dot(bc, bc)));
+            // Relative test so that the result does not depend on the model units
+            keep[t] = glm::length(glm::cross(ab, ac)) > 1e-6f * longest ? 1 : 0;
+        }
+    });
+
+    size_t kept = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+        if (!keep[t]) continue;
+        if (kept != t) {
+            indices[kept * 3] = indices[t * 3];
+            indices[kept * 3 + 1] = indices[t * 3 + 1];
+            indices[kept * 3 + 2] = indices[t * 3 + 2];
+        }
+        kept++;
+    }
+    indices.resize(kept * 3);
+    return triangleCount - kept;
+}
+
+// Makes the winding of faces that share a manifold edge consistent by walking each connected
+// component from a seed face. Closed components with negative volume are then turned inside
+// out so that their normals face outward; open ones keep the majority orientation.
+// Returns the number of flipped faces.
+size_t fixWinding(const std::vector<glm::vec3>& positions, std::vector<unsigned int>& indices) {
+    size_t triangleCount = indices.size() / 3;
+    std::vector<EdgeRecord> edges(triangleCount * 3);
+    parallelFor(triangleCount, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            for (unsigned int e = 0; e < 3; e++) {
+                unsigned int a = indices[t * 3 + e];
+                unsigned int b = indices[t * 3 + (e + 1) % 3];
+                edges[t * 3 + e] = { edgeKey(a, b), static_cast<unsigned int>(t * 3 + e) };
+            }
+        }
+    });
+    parallelSort(edges.begin(), edges.end(), [](const EdgeRecord& x, const EdgeRecord& y) {
+        return x.key < y.key || (x.key == y.key && x.corner < y.corner);
+    });
+
+    // Neighbour across each edge, only for edges shared by exactly two faces
+    const unsigned int none = 0xFFFFFFFFu;
+    std::vector<unsigned int> neighbour(triangleCount * 3, none);
+    std::vector<char> boundary(triangleCount, 0);
+    for (size_t i = 0; i < edges.size();) {
+        size_t j = i + 1;
+        while (j < edges.size() && edges[j].key == edges[i].key) j++;
+        if (j - i == 2) {
+            neighbour[edges[i].corner] = edges[i + 1].corner;
+            neighbour[edges[i + 1].corner] = edges[i].corner;
+        }
+        else {
+            for (size_t k = i; k < j; k++) boundary[edges[k].corner / 3] = 1;
+        }
+        i = j;
+    }
+
+    std::vector<char> flip(triangleCount, 0);
+    std::vector<char> visited(triangleCount, 0);
+    std::vector<unsigned int> stack;
+    std::vector<unsigned int> component;
+    size_t flipped = 0;
+
+    for (size_t seed = 0; seed < triangleCount; seed++) {
+        if (visited[seed]) continue;
+        visited[seed] = 1;
+        stack.push_back(static_cast<unsigned int>(seed));
+        component.clear();
+        bool closed = true;
+
+        while (!stack.empty()) {
+            unsigned int t = stack.back();
+            stack.pop_back();
+            component.push_back(t);
+            if (boundary[t]) closed = false;
+
+            for (unsigned int e = 0; e < 3; e++) {
+                unsigned int other = neighbour[t * 3 + e];
+                if (other == none) {
+                    closed = false;
+                    continue;
+                }
+                unsigned int n = other / 3;
+                if (visited[n]) continue;
+
+                // Consistent neighbours traverse the shared edge in opposite directions
+                unsigned int a = indices[t * 3 + e];
+                unsigned int b = indices[other];
+                bool sameDirection = a == b;
+                flip[n] = flip[t] ^ (sameDirection ? 1 : 0);
+                visited[n] = 1;
+                stack.push_back(n);
+            }
+        }
+
+        size_t componentFlips = 0;
+        for (unsigned int t : component) componentFlips += flip[t];
+
+        if (!closed) {
+            // No inside for open surfaces; keep the orientation most faces already had
+            if (componentFlips * 2 > component.size()) {
+                for (unsigned int t : component) flip[t] ^= 1;
+            }
+        }
+        else {
+            double volume = 0.0;
+            for (unsigned int t : component) {
+                glm::vec3 a = positions[indices[t * 3]];
+                glm::vec3 b = positions[indices[t * 3 + 1]];
+                glm::vec3 c = positions[indices[t * 3 + 2]];
+                double v = glm::dot(a, glm::cross(b, c));
+                volume += flip[t] ? -v : v;
+            }
+            if (volume < 0.0) {
+                for (unsigned int t : component) flip[t] ^= 1;
+            }
+        }
+    }
+
+    for (size_t t = 0; t < triangleCount; t++) {
+        if (flip[t]) {
+            std::swap(indices[t * 3 + 1], indices[t * 3 + 2]);
+            flipped++;
+        }
+    }
+    return flipped;
+}
+
+} // namespace
+
+MeshRepairStats repairMeshAndComputeNormals(const std::vector<glm::vec3>& positions, std::vector<unsigned int>& indices,
+    std::vector<float>& vertices, const MeshRepairSettings& settings) {
+    MeshRepairStats stats;
+    indices.resize(indices.size() / 3 * 3);
+
+    if (settings.weldVertices) {
+        stats.verticesWelded = weldVertices(positions, indices);
+    }
+    if (settings.removeDegenerate) {
+        stats.degenerateRemoved = removeDegenerateTriangles(positions, indices);
+    }
+    if (settings.fixWinding) {
+        stats.facesFlipped = fixWinding(positions, indices);
+    }
+
+    size_t triangleCount = indices.size() / 3;
+    size_t vertexCount = positions.size();
+
+    // Unit face normals and per-corner weights
+    std::vector<glm::vec3> faceNormals(triangleCount);
+    std::vector<float> cornerWeights(triangleCount * 3);
+    parallelFor(triangleCount, [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            glm::vec3 p[3] = { positions[indices[t * 3]], positions[indices[t * 3 + 1]], positions[indices[t * 3 + 2]] };
+            glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+            float doubleArea = glm::length(n);
+            faceNormals[t] = doubleArea > 0.0f ? n / doubleArea : glm::vec3(0.0f);
+
+            for (int c = 0; c < 3; c++) {
+                if (settings.weighting == NormalWeighting::Area) {
+                    cornerWeights[t * 3 + c] = doubleArea;
+                    continue;
+                }
+                glm::vec3 e0 = p[(c + 1) % 3] - p[c];
+                glm::vec3 e1 = p[(c + 2) % 3] - p[c];
+                float lengths = glm::length(e0) * glm::length(e1);
+                cornerWeights[t * 3 + c] = lengths > 0.0f ? std::acos(glm::clamp(glm::dot(e0, e1) / lengths, -1.0f, 1.0f)) : 0.0f;
+            }
+        }
+    });
+
+    // Corners grouped by vertex (counting sort), so each vertex can gather its faces
+    std::vector<unsigned int> cornerStart(vertexCount + 1, 0);
+    for (unsigned int v : indices) cornerStart[v]++;
+    exclusiveScan(cornerStart);
+    std::vector<unsigned int> vertexCorners(indices.size());
+    {
+        std::vector<unsigned int> fill(cornerStart.begin(), cornerStart.end() - 1);
+        for (size_t c = 0; c < indices.size(); c++) {
+            vertexCorners[fill[indices[c]]++] = static_cast<unsigned int>(c);
+        }
+    }
+
+    // Each corner averages the faces around its vertex that lie within the crease angle of
+    // its own face. Corners that end up with the same normal share an output vertex.
+    float cosCrease = std::cos(glm::radians(glm::clamp(settings.creaseAngle, 0.0f, 180.0f)));
+    std::vector<glm::vec3> cornerNormals(indices.size());
+    std::vector<unsigned char> cornerGroup(indices.size());
+    std::vector<unsigned int> groupCount(vertexCount + 1, 0);
+
+    parallelFor(vertexCount, [&](size_t begin, size_t end) {
+        std::vector<glm::vec3> groups;
+        for (size_t v = begin; v < end; v++) {
+            groups.clear();
+            for (unsigned int i = cornerStart[v]; i < cornerStart[v + 1]; i++) {
+                unsigned int corner = vertexCorners[i];
+                const glm::vec3& own = faceNormals[corner / 3];
+
+                glm::vec3 sum(0.0f);
+                for (unsigned int j = cornerStart[v]; j < cornerStart[v + 1]; j++) {
+                    unsigned int other = vertexCorners[j];
+                    const glm::vec3& n = faceNormals[other / 3];
+                    if (glm::dot(own, n) >= cosCrease) {
+                        sum += n * cornerWeights[other];
+                    }
+                }
+                float length = glm::length(sum);
+                glm::vec3 normal = length > 0.0f ? sum / length : (glm::length(own) > 0.0f ? own : glm::vec3(0.0f, 0.0f, 1.0f));
+
+                size_t g = 0;
+                while (g < groups.size() && glm::dot(groups[g], normal) < 0.9999f) g++;
+                if (g == groups.size()) {
+                    if (groups.size() == 255) g = 0; // Pathological fan; reuse the first normal
+                    else groups.push_back(normal);
+                }
+                cornerNormals[corner] = groups[g];
+                cornerGroup[corner] = static_cast<unsigned char>(g);
+            }
+            groupCount[v] = static_cast<unsigned int>(groups.size());
+        }
+    }, 1024);
+
+    std::vector<unsigned int>& groupBase = groupCount;
+    unsigned int outputCount = exclusiveScan(groupBase);
+    size_t usedVertices = 0;
+    for (size_t v = 0; v < vertexCount; v++) {
+        if (cornerStart[v + 1] > cornerStart[v]) usedVertices++;
+    }
+    stats.verticesSplit = outputCount - usedVertices;
+
+    // Every vertex writes only its own output slots and its own corners
+    vertices.assign(size_t(outputCount) * 6, 0.0f);
+    parallelFor(vertexCount, [&](size_t begin, size_t end) {
+        for (size_t v = begin; v < end; v++) {
+            for (unsigned int i = cornerStart[v]; i < cornerStart[v + 1]; i++) {
+                unsigned int corner = vertexCorners[i];
+                unsigned int out = groupBase[v] + cornerGroup[corner];
+                float* dst = &vertices[size_t(out) * 6];
+                dst[0] = positions[v].x;
+                dst[1] = positions[v].y;
+                dst[2] = positions[v].z;
+                dst[3] = cornerNormals[corner].x;
+                dst[4] = cornerNormals[corner].y;
+                dst[5] = cornerNormals[corner].z;
+                indices[corner] = out;
+            }
+        }
+    }, 1024);
+
+    return stats;
+}
@@ -0,0 +1,38 @@
+// meshrepair.h
+#ifndef MESHREPAIR_H
+#define MESHREPAIR_H
+
+#include <vector>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+// How face normals are weighted when they are averaged into a vertex normal
+enum class NormalWeighting {
+    Area,   // Larger faces count more
+    Angle   // Weighted by the corner angle; independent of how the surface is tessellated
+};
+
+struct MeshRepairSettings {
+    float creaseAngle = 30.0f;      // Degrees; sharper edges keep separate normals
+    NormalWeighting weighting = NormalWeighting::Angle;
+    bool weldVertices = true;       // Merge vertices at the same position first (STL stores every triangle on its own)
+    bool removeDegenerate = true;   // Drop zero-area and collapsed triangles
+    bool fixWinding = true;         // Make neighbouring faces agree and closed shells face outward
+};
+
+struct MeshRepairStats {
+    size_t verticesWelded = 0;      // Vertices merged into another at the same position
+    size_t degenerateRemoved = 0;
+    size_t facesFlipped = 0;
+    size_t verticesSplit = 0;       // Extra vertices created along creases
+};
+
+// Repairs a triangle list and computes smooth vertex normals in one pass. positions holds one
+// entry per input vertex and indices the triangles. On return vertices holds interleaved
+// position + normal data (6 floats per vertex, the Mesh layout) and indices refers to it.
+// Normals are gathered per vertex from its incident faces rather than scattered from faces,
+// so every stage runs in parallel without atomics.
+MeshRepairStats repairMeshAndComputeNormals(const std::vector<glm::vec3>& positions, std::vector<unsigned int>& indices,
+    std::vector<float>& vertices, const MeshRepairSettings& settings);
+
+#endif // MESHREPAIR_H
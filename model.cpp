@@ -4,8 +4,49 @@
 #include <assimp/postprocess.h>
 #include <iostream>
 
+ImportSettings importSettings;
+MemoryPolicy memoryPolicy;
+
 // Load a 3D model from a file
 void loadModel(const std::string& path, std::vector<Mesh>& meshes) {
+    std::vector<MeshData> meshData;
+    if (!importModelData(path, meshData)) {
+        return;
+    }
+
+    for (MeshData& data : meshData) {
+        meshes.push_back(uploadMesh(std::move(data)));
+    }
+}
+
+// Collect the CPU-side data of every mesh below a node
+static void processNodeData(aiNode* node, const aiScene* scene, std::vector<MeshData>& meshData, const ImportSettings& settings) {
+    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+        meshData.push_back(processMeshData(scene->mMeshes[node->mMeshes[i]], settings));
+    }
+    for (unsigned int i = 0; i < node->mNumChildren; i++) {
+        processNodeData(node->mChildren[i], scene, meshData, settings);
+    }
+}
+
+// True when every triangle carries its own face normal on all three corners, as Assimp
+// fills them in for STL. Such normals hold no smoothing information, so they are treated
+// as missing and the mesh goes through repair instead.
+static bool hasOnlyFacetNormals(const aiMesh* mesh) {
+    for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
+        const aiFace& face = mesh->mFaces[i];
+        for (unsigned int j = 1; j < face.mNumIndices; j++) {
+            const aiVector3D& a = mesh->mNormals[face.mIndices[0]];
+            const aiVector3D& b = mesh->mNormals[face.mIndices[j]];
+            if (a.x * b.x + a.y * b.y + a.z * b.z < 0.9999f) return false;
+        }
+    }
+    return true;
+}
+
+// Read a model file into CPU-side mesh data. Every call uses its own Assimp importer and
+// makes no GL calls, so several files can be imported on worker threads at once.
+bool importModelData(const std::string& path, std::vector<MeshData>& meshData, const ImportSettings& settings) {
     // Create an Assimp Importer object
     Assimp::Importer importer;
 
@@ -15,11 +56,12 @@ void loadModel(const std::string& path, std::vector<Mesh>& meshes) {
     // Check for errors during the import process
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         std::cerr << "Error loading model: " << importer.GetErrorString() << std::endl;
-        return;
+        return false;
     }
 
     // Process the root node recursively
-    processNode(scene->mRootNode, scene, meshes);
+    processNodeData(scene->mRootNode, scene, meshData, settings);
+    return true;
 }
 
 // Process a node in the Assimp scene graph recursively
@@ -36,31 +78,17 @@ void processNode(aiNode* node, const aiScene* scene, std::vector<Mesh>& meshes)
     }
 }
 
-// Process an individual mesh to extract vertex data and indices
+// Process an individual mesh and create its OpenGL buffers
 Mesh processMesh(aiMesh* mesh, const aiScene* scene) {
-    Mesh resultMesh; // Mesh object to hold vertex data and OpenGL buffers
-    std::vector<float> vertices;
-    std::vector<unsigned int> indices;
-
-    // Iterate through each vertex in the mesh
-    for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-        // Store the position of the vertex
-        vertices.push_back(mesh->mVertices[i].x);
-        vertices.push_back(mesh->mVertices[i].y);
-        vertices.push_back(mesh->mVertices[i].z);
-
-        // Store the normal of the vertex if it exists, otherwise use a default value
-        if (mesh->mNormals) {
-            vertices.push_back(mesh->mNormals[i].x);
-            vertices.push_back(mesh->mNormals[i].y);
-            vertices.push_back(mesh->mNormals[i].z);
-        }
-        else {
-            vertices.push_back(0.0f);
-            vertices.push_back(0.0f);
-            vertices.push_back(1.0f);
-        }
-    }
+    return uploadMesh(processMeshData(mesh));
+}
+
+// Process an individual mesh to extract vertex data and indices
+MeshData processMeshData(aiMesh* mesh, const ImportSettings& settings) {
+    MeshData data;
+    std::vector<float>& vertices = data.vertices;
+    std::vector<unsigned int>& indices = data.indices;
+    indices.reserve(size_t(mesh->mNumFaces) * 3);
 
     // Iterate through each face in the mesh and store the indices
     for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
@@ -70,6 +98,48 @@ Mesh processMesh(aiMesh* mesh, const aiScene* scene) {
         }
     }
 
+    if (mesh->mNormals && !settings.recomputeNormals && !hasOnlyFacetNormals(mesh)) {
+        // Iterate through each vertex in the mesh and store its position and normal
+        vertices.reserve(size_t(mesh->mNumVertices) * 6);
+        for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+            vertices.push_back(mesh->mVertices[i].x);
+            vertices.push_back(mesh->mVertices[i].y);
+            vertices.push_back(mesh->mVertices[i].z);
+            vertices.push_back(mesh->mNormals[i].x);
+            vertices.push_back(mesh->mNormals[i].y);
+            vertices.push_back(mesh->mNormals[i].z);
+        }
+    }
+    else {
+        // No usable normals (none, facet normals only as from STL, or recompute requested):
+        // weld the unshared corners, repair the triangles and compute smooth normals
+        std::vector<glm::vec3> positions(mesh->mNumVertices);
+        for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
+            positions[i] = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+        }
+
+        MeshRepairStats stats = repairMeshAndComputeNormals(positions, indices, vertices, settings.repair);
+        if (stats.degenerateRemoved || stats.facesFlipped) {
+            std::cout << "Mesh repair: welded " << stats.verticesWelded << " vertices, removed " << stats.degenerateRemoved
+                << " degenerate triangles, flipped " << stats.facesFlipped << " faces" << std::endl;
+        }
+    }
+
+    if (vertices.empty() || indices.empty()) {
+        std::cerr << "Warning: Mesh has no triangles after import" << std::endl;
+    }
+    return data;
+}
+
+// Create the OpenGL buffers for imported mesh data
+Mesh uploadMesh(MeshData&& data) {
+    Mesh resultMesh; // Mesh object to hold vertex data and OpenGL buffers
+    std::vector<float>& vertices = data.vertices;
+    std::vector<unsigned int>& indices = data.indices;
+    if (vertices.empty() || indices.empty()) {
+        return resultMesh;
+    }
+
     // Generate OpenGL buffers and arrays for the mesh
     glGenVertexArrays(1, &resultMesh.VAO);
     glGenBuffers(1, &resultMesh.VBO);
@@ -95,14 +165,28 @@ Mesh processMesh(aiMesh* mesh, const aiScene* scene) {
     // Unbind the VAO for now
     glBindVertexArray(0);
 
-    // Store the vertex and index data in the Mesh object
-    resultMesh.vertices = vertices;
-    resultMesh.indices = indices;
+    resultMesh.indexCount = static_cast<GLsizei>(indices.size());
+    resultMesh.vertexBytes = vertices.size() * sizeof(float);
+    resultMesh.indexBytes = indices.size() * sizeof(unsigned int);
+
+    // Hand the vertex and index data over to the Mesh object. Import grows the vectors with
+    // push_back, so drop the unused capacity before keeping them.
+    vertices.shrink_to_fit();
+    indices.shrink_to_fit();
+    resultMesh.vertices = std::move(vertices);
+    resultMesh.indices = std::move(indices);
+    computeBoundingBox(resultMesh, resultMesh.boundsMin, resultMesh.boundsMax);
 
     return resultMesh;
 }
 void computeBoundingBox(const Mesh& mesh, glm::vec3& min, glm::vec3& max) {
     const auto& vertices = mesh.vertices;
+    if (vertices.empty() && mesh.VBO) {
+        // CPU copy released; use the bounds cached at upload
+        min = mesh.boundsMin;
+        max = mesh.boundsMax;
+        return;
+    }
     min = glm::vec3(std::numeric_limits<float>::max());
     max = glm::vec3(-std::numeric_limits<float>::max());
 
@@ -133,15 +217,92 @@ void positionModelOnGrid(std::vector<Mesh>& meshes) {
     std::cout << "Translate Y: " << translateY << std::endl;
     std::cout << "Overall Min Y: " << overallMin.y << std::endl;
 
+    if (translateY == 0.0f) {
+        return;
+    }
+
     // Adjust each mesh so that the model's lowest point is on the grid
     for (auto& mesh : meshes) {
+        if (!mesh.VBO) continue;
+
+        // A released mesh is read back for the update and released again afterwards
+        bool released = mesh.vertices.empty();
+        if (released && !restoreCpuCopy(mesh)) {
+            continue;
+        }
         for (size_t i = 0; i < mesh.vertices.size(); i += 6) {
             mesh.vertices[i + 1] += translateY; // Move the y-coordinate of each vertex
         }
+        mesh.boundsMin.y += translateY;
+        mesh.boundsMax.y += translateY;
 
         // Update the mesh's vertex buffer
         glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
-        glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float), mesh.vertices.data(), GL_STATIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, mesh.vertices.size() * sizeof(float), mesh.vertices.data());
+        if (released) {
+            releaseCpuCopy(mesh);
+        }
+    }
+}
+
+MeshMemory meshMemory(const Mesh& mesh) {
+    MeshMemory memory;
+    memory.cpuBytes = mesh.vertices.capacity() * sizeof(float) + mesh.indices.capacity() * sizeof(unsigned int);
+    memory.gpuBytes = mesh.vertexBytes + mesh.indexBytes;
+    return memory;
+}
+
+MeshMemory totalMeshMemory(const std::vector<Mesh>& meshes) {
+    MeshMemory total;
+    for (const Mesh& mesh : meshes) {
+        MeshMemory memory = meshMemory(mesh);
+        total.cpuBytes += memory.cpuBytes;
+        total.gpuBytes += memory.gpuBytes;
+    }
+    return total;
+}
+
+void releaseCpuCopy(Mesh& mesh) {
+    if (!mesh.VBO) return; // Never uploaded; the CPU copy is the only one
+    std::vector<float>().swap(mesh.vertices);
+    std::vector<unsigned int>().swap(mesh.indices);
+}
+
+bool restoreCpuCopy(Mesh& mesh) {
+    if (!mesh.vertices.empty() || !mesh.VBO) return true;
+
+    while (glGetError() != GL_NO_ERROR) {}  // Only report errors from the read back
+    mesh.vertices.resize(mesh.vertexBytes / sizeof(float));
+    mesh.indices.resize(mesh.indexBytes / sizeof(unsigned int));
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, mesh.vertexBytes, mesh.vertices.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // The EBO binding is VAO state, so read it back through the VAO
+    glBindVertexArray(mesh.VAO);
+    glGetBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, mesh.indexBytes, mesh.indices.data());
+    glBindVertexArray(0);
+
+    if (glGetError() != GL_NO_ERROR) {
+        std::cerr << "Error: Could not read mesh buffers back from the GPU" << std::endl;
+        releaseCpuCopy(mesh);
+        return false;
+    }
+    return true;
+}
+
+bool ensureCpuCopies(std::vector<Mesh>& meshes) {
+    bool ok = true;
+    for (Mesh& mesh : meshes) {
+        ok = restoreCpuCopy(mesh) && ok;
+    }
+    return ok;
+}
+
+void applyMemoryPolicy(std::vector<Mesh>& meshes) {
+    if (memoryPolicy.cpuCopies != CpuCopyPolicy::Release) return;
+    for (Mesh& mesh : meshes) {
+        releaseCpuCopy(mesh);
     }
 }
 
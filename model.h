@@ -10,21 +10,72 @@
 #include <GLFW/glfw3.h>   // GLFW should come after GLEW
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
+#include "meshrepair.h"
 
 
 struct Mesh {
-    std::vector<float> vertices;      // Vertex positions and normals
-    std::vector<unsigned int> indices; // Indices for vertex elements
+    std::vector<float> vertices;      // Vertex positions and normals (empty once the CPU copy is released)
+    std::vector<unsigned int> indices; // Indices for vertex elements (empty once the CPU copy is released)
     GLuint VAO = 0;                   // Initialize to 0 to avoid uninitialized variable warnings
     GLuint VBO = 0;                   // Initialize to 0 to avoid uninitialized variable warnings
     GLuint EBO = 0;                   // Initialize to 0 to avoid uninitialized variable warnings
+    GLsizei indexCount = 0;           // Number of indices in the EBO
+    size_t vertexBytes = 0;           // Size of the VBO
+    size_t indexBytes = 0;            // Size of the EBO
+    glm::vec3 boundsMin = glm::vec3(0.0f); // Bounds of the uploaded vertices, valid without the CPU copy
+    glm::vec3 boundsMax = glm::vec3(0.0f);
 };
 
 
 
+// CPU-side mesh data produced by the import stage, before any OpenGL objects exist
+struct MeshData {
+    std::vector<float> vertices;        // Vertex positions and normals
+    std::vector<unsigned int> indices;
+};
+
+// Settings for the import stage that repairs meshes and generates missing normals
+struct ImportSettings {
+    MeshRepairSettings repair;
+    bool recomputeNormals = false;    // Also replace normals that came with the file
+};
+
+extern ImportSettings importSettings;
+
+// What happens to the CPU copy of a mesh once its buffers are on the GPU
+enum class CpuCopyPolicy {
+    Keep,       // Keep vertices/indices for slicing; the vectors are shrunk to their size
+    Release     // Free them; slicing reads them back from the GPU when it needs them
+};
+
+struct MemoryPolicy {
+    CpuCopyPolicy cpuCopies = CpuCopyPolicy::Keep;
+    size_t budgetMB = 16384;          // Shown against the total; nothing is evicted automatically
+};
+
+extern MemoryPolicy memoryPolicy;
+
+// Bytes held by one mesh on each side
+struct MeshMemory {
+    size_t cpuBytes = 0;              // Capacity of the vertex and index vectors
+    size_t gpuBytes = 0;              // VBO + EBO
+};
+
 // Load a model from file
 void loadModel(const std::string& path, std::vector<Mesh>& meshes);
 
+// Import a model file into CPU-side mesh data (no OpenGL calls, safe on worker threads).
+// Worker threads pass a copy of the settings taken when the import was queued, since the UI
+// edits importSettings while they run.
+bool importModelData(const std::string& path, std::vector<MeshData>& meshData, const ImportSettings& settings = importSettings);
+
+// Extract vertex data and indices from an Assimp mesh
+MeshData processMeshData(aiMesh* mesh, const ImportSettings& settings = importSettings);
+
+// Create the OpenGL buffers for imported mesh data (GL thread only). The vectors are moved
+// into the mesh, not copied, so the caller's MeshData is left empty.
+Mesh uploadMesh(MeshData&& data);
+
 // Process a node in the Assimp scene graph
 void processNode(aiNode* node, const aiScene* scene, std::vector<Mesh>& meshes);
 
@@ -35,4 +86,20 @@ Mesh processMesh(aiMesh* mesh, const aiScene* scene);
 void computeBoundingBox(const Mesh& mesh, glm::vec3& min, glm::vec3& max);
 void positionModelOnGrid(std::vector<Mesh>& meshes);
 
+// Memory accounting
+MeshMemory meshMemory(const Mesh& mesh);
+MeshMemory totalMeshMemory(const std::vector<Mesh>& meshes);
+
+// Free the CPU copy of an uploaded mesh; drawing only needs the GL buffers
+void releaseCpuCopy(Mesh& mesh);
+
+// Read a released CPU copy back from the GL buffers (GL thread only)
+bool restoreCpuCopy(Mesh& mesh);
+
+// Make sure every mesh has its CPU copy, e.g. before slicing
+bool ensureCpuCopies(std::vector<Mesh>& meshes);
+
+// Apply memoryPolicy to meshes that have just been uploaded and positioned
+void applyMemoryPolicy(std::vector<Mesh>& meshes);
+
 #endif //MODEL_H
\ No newline at end of file
@@ -0,0 +1,188 @@
+// parallel.h
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <cstddef>
+
+// Upper bound on the threads of the parallel helpers (0 = one per hardware thread). Worker
+// processes that share the machine with many siblings set it to 1.
+inline unsigned int& parallelThreadLimit() {
+    static unsigned int limit = 0;
+    return limit;
+}
+
+// Further bound for calls made on the current thread (0 = none). ThreadPool workers set it to
+// their share of the machine, so parallel helpers used inside pool tasks do not oversubscribe
+// it; threads started by parallelFor inherit it from their caller.
+inline unsigned int& parallelThreadLimitForThread() {
+    thread_local unsigned int limit = 0;
+    return limit;
+}
+
+// Number of worker threads used by the parallel helpers
+inline unsigned int parallelThreadCount() {
+    unsigned int count = std::thread::hardware_concurrency();
+    if (count == 0) count = 4;
+    if (parallelThreadLimit() > 0) count = std::min(count, parallelThreadLimit());
+    if (parallelThreadLimitForThread() > 0) count = std::min(count, parallelThreadLimitForThread());
+    return count;
+}
+
+// Splits [0, count) into contiguous chunks and calls body(begin, end) for each chunk on its
+// own thread. Small ranges run inline on the calling thread.
+template <typename Body>
+void parallelFor(size_t count, Body body, size_t minChunk = 4096) {
+    if (count == 0) return;
+
+    size_t threads = std::min<size_t>(parallelThreadCount(), (count + minChunk - 1) / minChunk);
+    if (threads <= 1) {
+        body(size_t(0), count);
+        return;
+    }
+
+    size_t chunk = (count + threads - 1) / threads;
+    unsigned int limit = parallelThreadLimitForThread();
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t t = 1; t < threads; t++) {
+        size_t begin = t * chunk;
+        size_t end = std::min(count, begin + chunk);
+        if (begin >= end) break;
+        workers.emplace_back([&body, begin, end, limit]() {
+            parallelThreadLimitForThread() = limit;
+            body(begin, end);
+        });
+    }
+    body(size_t(0), std::min(count, chunk));
+    for (auto& worker : workers) worker.join();
+}
+
+// Sorts [first, last) by sorting one chunk per thread and merging the chunks pairwise
+template <typename Iterator, typename Compare>
+void parallelSort(Iterator first, Iterator last, Compare compare) {
+    size_t count = static_cast<size_t>(last - first);
+    size_t chunks = std::min<size_t>(parallelThreadCount(), count / 65536);
+    if (chunks <= 1) {
+        std::sort(first, last, compare);
+        return;
+    }
+
+    std::vector<size_t> bounds(chunks + 1);
+    for (size_t i = 0; i <= chunks; i++) {
+        bounds[i] = count * i / chunks;
+    }
+    parallelFor(chunks, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            std::sort(first + bounds[i], first + bounds[i + 1], compare);
+        }
+    }, 1);
+
+    for (size_t width = 1; width < chunks; width *= 2) {
+        size_t pairs = (chunks + 2 * width - 1) / (2 * width);
+        parallelFor(pairs, [&](size_t begin, size_t end) {
+            for (size_t p = begin; p < end; p++) {
+                size_t lo = p * 2 * width;
+                size_t mid = std::min(lo + width, chunks);
+                size_t hi = std::min(lo + 2 * width, chunks);
+                if (mid < hi) {
+                    std::inplace_merge(first + bounds[lo], first + bounds[mid], first + bounds[hi], compare);
+                }
+            }
+        }, 1);
+    }
+}
+
+// Exclusive prefix sum in place; returns the total
+template <typename T>
+T exclusiveScan(std::vector<T>& values) {
+    T sum = 0;
+    for (auto& value : values) {
+        T current = value;
+        value = sum;
+        sum += current;
+    }
+    return sum;
+}
+
+// Fixed set of worker threads running queued tasks in submission order. The destructor
+// finishes every queued task before joining.
+class ThreadPool {
+public:
+    explicit ThreadPool(unsigned int threadCount = parallelThreadCount()) {
+        threadCount = std::max(1u, threadCount);
+        // Tasks that use the parallel helpers share the machine with the other workers
+        unsigned int share = std::max(1u, parallelThreadCount() / threadCount);
+        for (unsigned int i = 0; i < threadCount; i++) {
+            workers.emplace_back([this, share]() {
+                parallelThreadLimitForThread() = share;
+                workerMain();
+            });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        taskAvailable.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push_back(std::move(task));
+            pending++;
+        }
+        taskAvailable.notify_one();
+    }
+
+    // Block until every submitted task has finished
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        allDone.wait(lock, [this]() { return pending == 0; });
+    }
+
+    size_t threadCount() const { return workers.size(); }
+
+private:
+    void workerMain() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending--;
+            }
+            allDone.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable allDone;
+    size_t pending = 0;
+    bool stopping = false;
+};
+
+#endif // PARALLEL_H
@@ -0,0 +1,358 @@
+// pipeline.cpp
+#include "pipeline.h"
+#include "parallel.h"
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+// Cache entries unused for this many updates are dropped, so switching back and forth
+// between a few parameter values stays cheap
+const unsigned long long KEEP_GENERATIONS = 4;
+
+const unsigned long long HASH_SEED = 14695981039346656037ull;
+
+// 64-bit FNV-1a over raw bytes, chained
+unsigned long long hashBytes(const void* data, size_t size, unsigned long long hash = HASH_SEED) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename T>
+unsigned long long hashValue(const T& value, unsigned long long hash) {
+    return hashBytes(&value, sizeof(T), hash);
+}
+
+unsigned long long hashMesh(const Mesh& mesh) {
+    unsigned long long hash = hashBytes(mesh.vertices.data(), mesh.vertices.size() * sizeof(float));
+    return hashBytes(mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int), hash);
+}
+
+unsigned long long hashContours(const Layer& layer) {
+    unsigned long long hash = hashValue(layer.height, HASH_SEED);
+    for (const Contour& contour : layer.contours) {
+        hash = hashValue(contour.closed, hash);
+        hash = hashValue(contour.points.size(), hash);
+        hash = hashBytes(contour.points.data(), contour.points.size() * sizeof(glm::vec2), hash);
+    }
+    return hash;
+}
+
+// Fields one by one; the structs have padding
+unsigned long long hashSliceSettings(const SliceSettings& settings, unsigned long long hash) {
+    hash = hashValue(settings.adaptive, hash);
+    if (settings.adaptive) {
+        hash = hashValue(settings.minLayerHeight, hash);
+        hash = hashValue(settings.maxLayerHeight, hash);
+        return hashValue(settings.cuspTolerance, hash);
+    }
+    return hashValue(settings.layerHeight, hash);
+}
+
+unsigned long long hashProfileSettings(const PipelineSettings& settings, float safeHeight, unsigned long long hash) {
+    hash = hashValue(settings.profile.toolRadius, hash);
+    hash = hashValue(settings.profile.feedrate, hash);
+    hash = hashValue(settings.profile.plungeFeedrate, hash);
+    hash = hashValue(settings.profile.climb, hash);
+    hash = hashValue(settings.profile.clearance, hash);
+    hash = hashValue(safeHeight, hash);
+    hash = hashValue(settings.fitArcs, hash);
+    if (settings.fitArcs) {
+        hash = hashValue(settings.arcFit.tolerance, hash);
+        hash = hashValue(settings.arcFit.minSegments, hash);
+        hash = hashValue(settings.arcFit.minRadius, hash);
+        hash = hashValue(settings.arcFit.maxRadius, hash);
+    }
+    return hash;
+}
+
+unsigned long long hashRestOperations(const PipelineSettings& settings, unsigned long long hash) {
+    hash = hashValue(settings.rest.size(), hash);
+    for (const RestOperation& operation : settings.rest) {
+        hash = hashValue(operation.toolRadius, hash);
+        hash = hashValue(operation.heights.size(), hash);
+        hash = hashBytes(operation.heights.data(), operation.heights.size() * sizeof(float), hash);
+    }
+    return hash;
+}
+
+unsigned long long hashRegion(const ClipperLib::Paths& region) {
+    unsigned long long hash = hashValue(region.size(), HASH_SEED);
+    for (const ClipperLib::Path& path : region) {
+        hash = hashValue(path.size(), hash);
+        hash = hashBytes(path.data(), path.size() * sizeof(ClipperLib::IntPoint), hash);
+    }
+    return hash;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+void ToolpathPipeline::setGeometry(std::vector<Mesh>& geometry) {
+    meshes = &geometry;
+    geometryDirty = true;
+}
+
+void ToolpathPipeline::clear() {
+    meshes = nullptr;
+    geometryDirty = false;
+    geometryHash = 0;
+    heightsKey = 0;
+    heights.clear();
+    sliceCache.clear();
+    currentLayers.clear();
+    layerHashes.clear();
+    toolpathCache.clear();
+    toolpathKeys.clear();
+    restKey = 0;
+    restHashes.clear();
+    currentRestStats = RestStats();
+    restCache.clear();
+    outputKeys.clear();
+    orderingKey = 0;
+    settingsKey = 0;
+    ordered.clear();
+    for (PipelineStageStats& stats : stageStats) stats = PipelineStageStats();
+}
+
+bool ToolpathPipeline::update(const PipelineSettings& settings) {
+    auto updateStart = std::chrono::steady_clock::now();
+    for (PipelineStageStats& stats : stageStats) stats = PipelineStageStats();
+    if (!meshes || meshes->empty()) return false;
+
+    // Nothing to do when neither the geometry nor any parameter changed, which keeps a
+    // per-frame update free and the cache generations meaningful
+    unsigned long long newSettingsKey = hashRestOperations(settings,
+        hashProfileSettings(settings, 0.0f, hashSliceSettings(settings.slice, HASH_SEED)));
+    if (!geometryDirty && newSettingsKey == settingsKey) {
+        for (PipelineStageStats& stats : stageStats) stats.reused = 1;
+        stageStats[STAGE_SLICES].reused = currentLayers.size();
+        stageStats[STAGE_TOOLPATHS].reused = currentLayers.size();
+        stageStats[STAGE_REST].reused = settings.rest.empty() ? 0 : currentLayers.size();
+        updateMs = millisecondsSince(updateStart);
+        return false;
+    }
+    settingsKey = newSettingsKey;
+    generation++;
+
+    // Slicing and hashing read the CPU copies; released ones come back for the update
+    bool restored = false;
+    auto needCpuCopies = [&]() {
+        if (!restored) {
+            ensureCpuCopies(*meshes);
+            restored = true;
+        }
+    };
+
+    // Geometry: import and placement both end up in the vertex data
+    auto start = std::chrono::steady_clock::now();
+    if (geometryDirty) {
+        needCpuCopies();
+        std::vector<unsigned long long> meshHashes(meshes->size());
+        parallelFor(meshes->size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) meshHashes[i] = hashMesh((*meshes)[i]);
+        }, 1);
+        geometryHash = hashBytes(meshHashes.data(), meshHashes.size() * sizeof(unsigned long long));
+        geometryDirty = false;
+        stageStats[STAGE_GEOMETRY].computed = 1;
+    }
+    else {
+        stageStats[STAGE_GEOMETRY].reused = 1;
+    }
+    stageStats[STAGE_GEOMETRY].ms = millisecondsSince(start);
+
+    // Layer heights
+    start = std::chrono::steady_clock::now();
+    unsigned long long newHeightsKey = hashSliceSettings(settings.slice, geometryHash);
+    if (newHeightsKey != heightsKey) {
+        needCpuCopies();
+        heights = layerHeights(*meshes, settings.slice);
+        heightsKey = newHeightsKey;
+        stageStats[STAGE_HEIGHTS].computed = 1;
+    }
+    else {
+        stageStats[STAGE_HEIGHTS].reused = 1;
+    }
+    stageStats[STAGE_HEIGHTS].ms = millisecondsSince(start);
+
+    // Slices: one cache entry per plane, so a new layer height only cuts the planes that
+    // did not exist before
+    start = std::chrono::steady_clock::now();
+    std::vector<unsigned long long> sliceKeys(heights.size());
+    std::vector<float> missingHeights;
+    for (size_t i = 0; i < heights.size(); i++) {
+        sliceKeys[i] = hashValue(heights[i], geometryHash);
+        auto found = sliceCache.find(sliceKeys[i]);
+        if (found == sliceCache.end()) {
+            missingHeights.push_back(heights[i]);
+        }
+        else {
+            found->second.lastUsed = generation;
+        }
+    }
+    if (!missingHeights.empty()) {
+        needCpuCopies();
+        std::vector<Layer> sliced = sliceMeshes(*meshes, missingHeights);
+        std::vector<unsigned long long> hashes(sliced.size());
+        parallelFor(sliced.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) hashes[i] = hashContours(sliced[i]);
+        }, 1);
+        for (size_t i = 0; i < sliced.size(); i++) {
+            CachedLayer& cached = sliceCache[hashValue(sliced[i].height, geometryHash)];
+            cached.layer = std::move(sliced[i]);
+            cached.contentHash = hashes[i];
+            cached.lastUsed = generation;
+        }
+    }
+    if (restored) {
+        applyMemoryPolicy(*meshes);
+    }
+    currentLayers.resize(heights.size());
+    layerHashes.resize(heights.size());
+    float bottom = heights.empty() ? 0.0f : heights.front();
+    for (const Mesh& mesh : *meshes) {
+        bottom = std::min(bottom, mesh.boundsMin.y);
+    }
+    for (size_t i = 0; i < heights.size(); i++) {
+        const CachedLayer& cached = sliceCache[sliceKeys[i]];
+        currentLayers[i] = cached.layer;
+        currentLayers[i].thickness = heights[i] - (i > 0 ? heights[i - 1] : bottom);
+        layerHashes[i] = cached.contentHash;
+    }
+    stageStats[STAGE_SLICES].computed = missingHeights.size();
+    stageStats[STAGE_SLICES].reused = heights.size() - missingHeights.size();
+    stageStats[STAGE_SLICES].ms = millisecondsSince(start);
+
+    // Toolpaths per layer, keyed by the layer's contours and the parameters that shape them.
+    // Layers with identical contours at the same height share an entry.
+    start = std::chrono::steady_clock::now();
+    float safeHeight = profileSafeHeight(currentLayers, settings.profile);
+    unsigned long long profileKey = hashProfileSettings(settings, safeHeight, HASH_SEED);
+    toolpathKeys.resize(currentLayers.size());
+    std::vector<size_t> missingLayers;
+    for (size_t i = 0; i < currentLayers.size(); i++) {
+        toolpathKeys[i] = hashValue(layerHashes[i], profileKey);
+        auto found = toolpathCache.find(toolpathKeys[i]);
+        if (found == toolpathCache.end()) {
+            toolpathCache[toolpathKeys[i]].lastUsed = generation;  // Filled below
+            missingLayers.push_back(i);
+        }
+        else {
+            found->second.lastUsed = generation;
+        }
+    }
+    std::vector<std::vector<Toolpath>> computed(missingLayers.size());
+    parallelFor(missingLayers.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            computed[i] = generateLayerProfile(currentLayers[missingLayers[i]], safeHeight, settings.profile);
+            if (settings.fitArcs) {
+                computed[i] = fitArcs(computed[i], settings.arcFit);
+            }
+        }
+    }, 1);
+    for (size_t i = 0; i < missingLayers.size(); i++) {
+        toolpathCache[toolpathKeys[missingLayers[i]]].toolpaths = std::move(computed[i]);
+    }
+    stageStats[STAGE_TOOLPATHS].computed = missingLayers.size();
+    stageStats[STAGE_TOOLPATHS].reused = currentLayers.size() - missingLayers.size();
+    stageStats[STAGE_TOOLPATHS].ms = millisecondsSince(start);
+
+    // Rest restriction, as the profile button does with rest machining on. The rest material
+    // of a layer depends on the layers the earlier operations cut at, so it is recomputed for
+    // all layers when any layer or operation changes; the restricted toolpaths are cached per
+    // layer under their toolpaths and the layer's rest, so unchanged layers are not clipped again.
+    start = std::chrono::steady_clock::now();
+    std::unordered_map<unsigned long long, CachedToolpaths>* outputCache = &toolpathCache;
+    outputKeys = toolpathKeys;
+    if (!settings.rest.empty()) {
+        RestSettings restSettings;
+        restSettings.toolRadius = settings.profile.toolRadius;
+        unsigned long long newRestKey = hashValue(restSettings.toolRadius, hashRestOperations(settings,
+            hashBytes(layerHashes.data(), layerHashes.size() * sizeof(unsigned long long))));
+        std::vector<ClipperLib::Paths> restMaterial;
+        if (newRestKey != restKey || restHashes.size() != currentLayers.size()) {
+            restMaterial = computeRestMaterial(currentLayers, settings.rest, restSettings, &currentRestStats);
+            restHashes.resize(restMaterial.size());
+            for (size_t i = 0; i < restMaterial.size(); i++) restHashes[i] = hashRegion(restMaterial[i]);
+            restKey = newRestKey;
+        }
+        std::vector<size_t> missingRest;
+        for (size_t i = 0; i < currentLayers.size(); i++) {
+            outputKeys[i] = hashValue(restHashes[i], toolpathKeys[i]);
+            auto found = restCache.find(outputKeys[i]);
+            if (found == restCache.end()) {
+                restCache[outputKeys[i]].lastUsed = generation;     // Filled below
+                missingRest.push_back(i);
+            }
+            else {
+                found->second.lastUsed = generation;
+            }
+        }
+        if (!missingRest.empty() && restMaterial.empty()) {
+            // Cached rest hashes but evicted toolpaths: the material is needed again
+            restMaterial = computeRestMaterial(currentLayers, settings.rest, restSettings, &currentRestStats);
+        }
+        std::vector<std::vector<Toolpath>> restricted(missingRest.size());
+        parallelFor(missingRest.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                size_t layer = missingRest[i];
+                restricted[i] = restrictToRest(toolpathCache.at(toolpathKeys[layer]).toolpaths, { currentLayers[layer] },
+                    { restMaterial[layer] }, restSettings);
+            }
+        }, 1);
+        for (size_t i = 0; i < missingRest.size(); i++) {
+            restCache[outputKeys[missingRest[i]]].toolpaths = std::move(restricted[i]);
+        }
+        outputCache = &restCache;
+        stageStats[STAGE_REST].computed = missingRest.size();
+        stageStats[STAGE_REST].reused = currentLayers.size() - missingRest.size();
+    }
+    else {
+        currentRestStats = RestStats();
+        restKey = 0;
+    }
+    stageStats[STAGE_REST].ms = millisecondsSince(start);
+
+    // Ordering: top layer first, as generateProfileToolpaths does
+    start = std::chrono::steady_clock::now();
+    unsigned long long newOrderingKey = hashBytes(outputKeys.data(), outputKeys.size() * sizeof(unsigned long long));
+    bool changed = newOrderingKey != orderingKey;
+    if (changed) {
+        ordered.clear();
+        for (size_t i = outputKeys.size(); i-- > 0;) {
+            const std::vector<Toolpath>& layerPaths = (*outputCache)[outputKeys[i]].toolpaths;
+            ordered.insert(ordered.end(), layerPaths.begin(), layerPaths.end());
+        }
+        orderingKey = newOrderingKey;
+        stageStats[STAGE_ORDERING].computed = 1;
+    }
+    else {
+        stageStats[STAGE_ORDERING].reused = 1;
+    }
+    stageStats[STAGE_ORDERING].ms = millisecondsSince(start);
+
+    evict();
+    updateMs = millisecondsSince(updateStart);
+    return changed;
+}
+
+void ToolpathPipeline::evict() {
+    if (generation <= KEEP_GENERATIONS) return;
+    unsigned long long oldest = generation - KEEP_GENERATIONS;
+    for (auto it = sliceCache.begin(); it != sliceCache.end();) {
+        it = it->second.lastUsed < oldest ? sliceCache.erase(it) : std::next(it);
+    }
+    for (auto it = toolpathCache.begin(); it != toolpathCache.end();) {
+        it = it->second.lastUsed < oldest ? toolpathCache.erase(it) : std::next(it);
+    }
+    for (auto it = restCache.begin(); it != restCache.end();) {
+        it = it->second.lastUsed < oldest ? restCache.erase(it) : std::next(it);
+    }
+}
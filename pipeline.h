@@ -0,0 +1,105 @@
+// pipeline.h
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <vector>
+#include <unordered_map>
+#include "model.h"
+#include "slicer.h"
+#include "toolpath.h"
+#include "arcfit.h"
+#include "rest.h"
+
+// Incremental version of the CAM chain: geometry (import and placement) -> layer heights ->
+// slices -> toolpaths -> rest restriction -> ordering. Every result is cached under a hash of everything it
+// depends on, and slices and toolpaths are cached per layer, so changing one parameter only
+// recomputes the nodes (and layers) it reaches. The ordered toolpaths feed the compact
+// buffer and the G-code writer, which only need rebuilding when the output hash changes.
+
+enum PipelineStage {
+    STAGE_GEOMETRY,
+    STAGE_HEIGHTS,
+    STAGE_SLICES,
+    STAGE_TOOLPATHS,
+    STAGE_REST,
+    STAGE_ORDERING,
+    STAGE_COUNT
+};
+
+struct PipelineSettings {
+    SliceSettings slice;
+    ProfileSettings profile;
+    bool fitArcs = false;
+    ArcFitSettings arcFit;
+    std::vector<RestOperation> rest;    // Earlier operations; when set, toolpaths only cut their rest material
+};
+
+// Work done by a stage in the last update; layered stages count layers
+struct PipelineStageStats {
+    size_t computed = 0;
+    size_t reused = 0;
+    double ms = 0.0;
+};
+
+class ToolpathPipeline {
+public:
+    // Use these meshes as the geometry; call again after they are loaded or moved. The
+    // content is hashed on the next update, so unchanged geometry keeps its caches.
+    void setGeometry(std::vector<Mesh>& meshes);
+
+    // Recompute whatever the settings or geometry invalidated. Returns true when the ordered
+    // toolpaths changed.
+    bool update(const PipelineSettings& settings);
+
+    void clear();
+
+    const std::vector<Layer>& layers() const { return currentLayers; }
+    const std::vector<Toolpath>& toolpaths() const { return ordered; }
+    unsigned long long outputHash() const { return orderingKey; }
+    const PipelineStageStats& stats(PipelineStage stage) const { return stageStats[stage]; }
+    double lastUpdateMs() const { return updateMs; }
+    const RestStats& restStats() const { return currentRestStats; }
+
+private:
+    struct CachedLayer {
+        Layer layer;
+        unsigned long long contentHash = 0;
+        unsigned long long lastUsed = 0;
+    };
+    struct CachedToolpaths {
+        std::vector<Toolpath> toolpaths;
+        unsigned long long lastUsed = 0;
+    };
+
+    void evict();
+
+    std::vector<Mesh>* meshes = nullptr;
+    bool geometryDirty = false;
+    unsigned long long geometryHash = 0;
+    unsigned long long settingsKey = 0;         // All parameters of the last update
+
+    unsigned long long heightsKey = 0;
+    std::vector<float> heights;
+
+    std::unordered_map<unsigned long long, CachedLayer> sliceCache;          // Geometry + height
+    std::vector<Layer> currentLayers;
+    std::vector<unsigned long long> layerHashes;
+
+    std::unordered_map<unsigned long long, CachedToolpaths> toolpathCache;   // Layer content + profile
+    std::vector<unsigned long long> toolpathKeys;
+
+    unsigned long long restKey = 0;                                         // All layers + operations + tool
+    std::vector<unsigned long long> restHashes;                             // Rest material per layer
+    RestStats currentRestStats;
+    std::unordered_map<unsigned long long, CachedToolpaths> restCache;      // Layer toolpaths + layer rest
+    std::vector<unsigned long long> outputKeys;                             // Per layer, into restCache or toolpathCache
+
+    unsigned long long orderingKey = 0;
+    std::vector<Toolpath> ordered;
+
+    unsigned long long generation = 0;
+    PipelineStageStats stageStats[STAGE_COUNT];
+    double updateMs = 0.0;
+};
+
+#endif // PIPELINE_H
@@ -0,0 +1,287 @@
+// rest.cpp
+#include "rest.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const float HEIGHT_TOLERANCE = 1e-4f;
+
+ClipperLib::Paths clip(ClipperLib::ClipType type, const ClipperLib::Paths& subject, const ClipperLib::Paths& clipPaths) {
+    ClipperLib::Clipper clipper;
+    clipper.AddPaths(subject, ClipperLib::ptSubject, true);
+    clipper.AddPaths(clipPaths, ClipperLib::ptClip, true);
+    ClipperLib::Paths result;
+    clipper.Execute(type, result, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+    return result;
+}
+
+ClipperLib::Paths offsetRegion(const ClipperLib::Paths& region, float delta, float arcTolerance) {
+    ClipperLib::ClipperOffset offset;
+    offset.ArcTolerance = arcTolerance * CLIPPER_SCALE;
+    offset.AddPaths(region, ClipperLib::jtRound, ClipperLib::etClosedPolygon);
+    ClipperLib::Paths result;
+    offset.Execute(result, delta * CLIPPER_SCALE);
+    return result;
+}
+
+// Clipper regions never overlap themselves, so a point is inside when an odd number of
+// their paths (outers and holes) contain it
+bool insideRegion(const ClipperLib::Paths& region, const glm::vec2& point) {
+    ClipperLib::IntPoint p = toClipperPoint(point);
+    int count = 0;
+    for (const ClipperLib::Path& path : region) {
+        if (ClipperLib::PointInPolygon(p, path) != 0) count++;
+    }
+    return count % 2 == 1;
+}
+
+// Layer closest to a height; layers are sorted bottom-up
+size_t nearestLayer(const std::vector<Layer>& layers, float height) {
+    auto it = std::lower_bound(layers.begin(), layers.end(), height, [](const Layer& layer, float h) { return layer.height < h; });
+    if (it == layers.end()) return layers.size() - 1;
+    size_t index = it - layers.begin();
+    if (index > 0 && height - layers[index - 1].height < it->height - height) index--;
+    return index;
+}
+
+ClipperLib::Paths layerPart(const Layer& layer) {
+    ClipperLib::Clipper clipper;
+    clipper.AddPaths(contoursToClipperPaths(layer.contours), ClipperLib::ptSubject, true);
+    ClipperLib::Paths part;
+    clipper.Execute(ClipperLib::ctUnion, part, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+    return part;
+}
+
+// Everything a tool of this radius clears around the part: the opening of the free space
+ClipperLib::Paths toolFootprint(const ClipperLib::Paths& box, const ClipperLib::Paths& part, float radius) {
+    float arcTolerance = 0.01f * radius;
+    ClipperLib::Paths centres = clip(ClipperLib::ctDifference, box, offsetRegion(part, radius, arcTolerance));
+    return offsetRegion(centres, radius, arcTolerance);
+}
+
+// Cutting point of a flat toolpath, with the feedrate of the move that reaches it
+struct CutPoint {
+    glm::vec2 position;
+    float feedrate = 0.0f;
+    bool vertex = true;                 // False for points added by densify
+};
+
+// Cutting moves of a toolpath that plunges once, cuts at one height and retracts. Returns
+// false for any other shape.
+bool flatCut(const Toolpath& toolpath, float arcTolerance, float& height, std::vector<CutPoint>& points) {
+    if (toolpath.moves.size() < 2 || toolpath.moves.front().type != MoveType::Linear) return false;
+    height = toolpath.moves.front().target.y;
+    glm::vec3 from = toolpath.moves.front().target;
+    points.push_back({ glm::vec2(from.x, from.z), toolpath.moves.front().feedrate });
+    bool retracted = false;
+    std::vector<glm::vec3> arcPoints;
+    for (size_t i = 1; i < toolpath.moves.size(); i++) {
+        const ToolpathMove& move = toolpath.moves[i];
+        if (move.type == MoveType::Rapid) {
+            retracted = true;
+            continue;
+        }
+        if (retracted || std::fabs(move.target.y - height) > HEIGHT_TOLERANCE) return false;
+        if (isArc(move.type)) {
+            arcPoints.clear();
+            interpolateArc(from, move, arcTolerance, arcPoints);
+            for (const glm::vec3& p : arcPoints) points.push_back({ glm::vec2(p.x, p.z), move.feedrate });
+        }
+        else {
+            points.push_back({ glm::vec2(move.target.x, move.target.z), move.feedrate });
+        }
+        from = move.target;
+    }
+    return true;
+}
+
+// Splits segments so that consecutive points are at most spacing apart
+std::vector<CutPoint> densify(const std::vector<CutPoint>& points, float spacing) {
+    std::vector<CutPoint> dense;
+    dense.reserve(points.size());
+    dense.push_back(points.front());
+    for (size_t i = 1; i < points.size(); i++) {
+        glm::vec2 from = points[i - 1].position, to = points[i].position;
+        int pieces = std::max(1, static_cast<int>(std::ceil(glm::distance(from, to) / spacing)));
+        for (int j = 1; j <= pieces; j++) {
+            dense.push_back({ glm::mix(from, to, float(j) / pieces), points[i].feedrate, j == pieces });
+        }
+    }
+    return dense;
+}
+
+} // namespace
+
+std::vector<ClipperLib::Paths> computeRestMaterial(const std::vector<Layer>& layers, const std::vector<RestOperation>& previous,
+    const RestSettings& settings, RestStats* stats) {
+    if (stats) *stats = RestStats();
+    std::vector<ClipperLib::Paths> rest(layers.size());
+    if (layers.empty() || settings.toolRadius <= 0.0f) return rest;
+
+    // Working area: the layers' bounding box with room for the largest tool around it.
+    // Footprints cover all of it except near the part, so its size does not matter.
+    glm::vec2 boundsMin(std::numeric_limits<float>::max()), boundsMax(-std::numeric_limits<float>::max());
+    for (const Layer& layer : layers) {
+        for (const Contour& contour : layer.contours) {
+            for (const glm::vec2& p : contour.points) {
+                boundsMin = glm::min(boundsMin, p);
+                boundsMax = glm::max(boundsMax, p);
+            }
+        }
+    }
+    if (boundsMin.x > boundsMax.x) return rest;
+    float largest = settings.toolRadius;
+    for (const RestOperation& operation : previous) largest = std::max(largest, operation.toolRadius);
+    boundsMin -= glm::vec2(3.0f * largest);
+    boundsMax += glm::vec2(3.0f * largest);
+    ClipperLib::Paths box = { {
+        toClipperPoint(boundsMin), toClipperPoint(glm::vec2(boundsMax.x, boundsMin.y)),
+        toClipperPoint(boundsMax), toClipperPoint(glm::vec2(boundsMin.x, boundsMax.y)) } };
+
+    std::vector<ClipperLib::Paths> parts(layers.size());
+    parallelFor(layers.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) parts[i] = layerPart(layers[i]);
+    }, 1);
+
+    // One footprint per cut depth of every earlier operation, using the layer nearest to it
+    struct Footprint {
+        float height = 0.0f;
+        float radius = 0.0f;
+        ClipperLib::Paths cleared;
+    };
+    std::vector<std::vector<Footprint>> footprints(previous.size());
+    std::vector<Footprint*> pending;
+    for (size_t i = 0; i < previous.size(); i++) {
+        if (previous[i].toolRadius <= 0.0f) continue;
+        std::vector<float> heights = previous[i].heights;
+        std::sort(heights.begin(), heights.end());
+        for (float height : heights) footprints[i].push_back({ height, previous[i].toolRadius, {} });
+        for (Footprint& footprint : footprints[i]) pending.push_back(&footprint);
+    }
+    parallelFor(pending.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            Footprint& footprint = *pending[i];
+            footprint.cleared = toolFootprint(box, parts[nearestLayer(layers, footprint.height)], footprint.radius);
+        }
+    }, 1);
+
+    // Reachable material minus, per operation, the footprint of its nearest cut at or below the layer
+    float radius = settings.toolRadius;
+    parallelFor(layers.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            ClipperLib::Paths material = clip(ClipperLib::ctDifference, box, parts[i]);
+            ClipperLib::Paths result = clip(ClipperLib::ctIntersection, material, toolFootprint(box, parts[i], radius));
+            for (const std::vector<Footprint>& operation : footprints) {
+                auto above = std::upper_bound(operation.begin(), operation.end(), layers[i].height + HEIGHT_TOLERANCE,
+                    [](float h, const Footprint& footprint) { return h < footprint.height; });
+                if (above == operation.begin()) continue;   // The operation never cut this deep
+                result = clip(ClipperLib::ctDifference, result, std::prev(above)->cleared);
+            }
+            if (settings.minWidth > 0.0f && !result.empty()) {
+                float half = 0.5f * settings.minWidth;
+                result = offsetRegion(offsetRegion(result, -half, 0.01f * radius), half, 0.01f * radius);
+            }
+            rest[i] = std::move(result);
+        }
+    }, 1);
+
+    if (stats) {
+        for (const ClipperLib::Paths& region : rest) {
+            if (region.empty()) continue;
+            stats->layers++;
+            for (const ClipperLib::Path& path : region) stats->area += ClipperLib::Area(path) / (CLIPPER_SCALE * CLIPPER_SCALE);
+        }
+    }
+    return rest;
+}
+
+std::vector<Toolpath> restrictToRest(const std::vector<Toolpath>& toolpaths, const std::vector<Layer>& layers,
+    const std::vector<ClipperLib::Paths>& rest, const RestSettings& settings) {
+    if (layers.empty() || rest.size() != layers.size()) return toolpaths;
+    float radius = settings.toolRadius;
+    float spacing = 0.25f * radius;
+    float bridge = 2.0f * radius;       // Gaps shorter than this are cut through instead of retracting
+
+    // Tool centres that touch rest material
+    std::vector<ClipperLib::Paths> zones(layers.size());
+    parallelFor(layers.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (!rest[i].empty()) zones[i] = offsetRegion(rest[i], radius, 0.01f * radius);
+        }
+    }, 1);
+
+    std::vector<std::vector<Toolpath>> restricted(toolpaths.size());
+    parallelFor(toolpaths.size(), [&](size_t begin, size_t end) {
+        for (size_t t = begin; t < end; t++) {
+            const Toolpath& toolpath = toolpaths[t];
+            float height = 0.0f;
+            std::vector<CutPoint> points;
+            if (!flatCut(toolpath, 0.01f * radius, height, points)) {
+                restricted[t].push_back(toolpath);
+                continue;
+            }
+            size_t layer = nearestLayer(layers, height);
+            if (std::fabs(layers[layer].height - height) > HEIGHT_TOLERANCE) {
+                restricted[t].push_back(toolpath);
+                continue;
+            }
+            const ClipperLib::Paths& zone = zones[layer];
+            if (zone.empty()) continue;
+
+            std::vector<CutPoint> dense = densify(points, spacing);
+            std::vector<char> keep(dense.size());
+            for (size_t i = 0; i < dense.size(); i++) keep[i] = insideRegion(zone, dense[i].position);
+
+            // The tool may touch rest between two samples; keep one sample on either side
+            std::vector<char> widened = keep;
+            for (size_t i = 0; i < dense.size(); i++) {
+                if (keep[i]) continue;
+                widened[i] = (i > 0 && keep[i - 1]) || (i + 1 < dense.size() && keep[i + 1]);
+            }
+            keep = widened;
+
+            // Bridge short gaps between kept runs
+            size_t lastKept = std::numeric_limits<size_t>::max();
+            for (size_t i = 0; i < dense.size(); i++) {
+                if (!keep[i]) continue;
+                if (lastKept != std::numeric_limits<size_t>::max() && i > lastKept + 1 && (i - lastKept) * spacing <= bridge) {
+                    std::fill(keep.begin() + lastKept + 1, keep.begin() + i, 1);
+                }
+                lastKept = i;
+            }
+
+            float safeHeight = toolpath.start.y;
+            float plungeFeedrate = toolpath.moves.front().feedrate;
+            for (size_t i = 0; i < dense.size();) {
+                if (!keep[i]) {
+                    i++;
+                    continue;
+                }
+                size_t runEnd = i;
+                while (runEnd + 1 < dense.size() && keep[runEnd + 1]) runEnd++;
+                if (runEnd > i) {
+                    Toolpath piece;
+                    glm::vec2 first = dense[i].position, last = dense[runEnd].position;
+                    piece.start = glm::vec3(first.x, safeHeight, first.y);
+                    piece.moves.push_back({ MoveType::Linear, glm::vec3(first.x, height, first.y), plungeFeedrate });
+                    for (size_t j = i + 1; j <= runEnd; j++) {
+                        if (!dense[j].vertex && j != runEnd) continue;   // Samples only mark where runs end
+                        piece.moves.push_back({ MoveType::Linear, glm::vec3(dense[j].position.x, height, dense[j].position.y), dense[j].feedrate });
+                    }
+                    piece.moves.push_back({ MoveType::Rapid, glm::vec3(last.x, safeHeight, last.y), 0.0f });
+                    restricted[t].push_back(std::move(piece));
+                }
+                i = runEnd + 1;
+            }
+        }
+    }, 1);
+
+    std::vector<Toolpath> result;
+    for (std::vector<Toolpath>& pieces : restricted) {
+        for (Toolpath& piece : pieces) result.push_back(std::move(piece));
+    }
+    return result;
+}
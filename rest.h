@@ -0,0 +1,45 @@
+// rest.h
+#ifndef REST_H
+#define REST_H
+
+#include <vector>
+#include <cstddef>
+#include "slicer.h"
+#include "toolpath.h"
+
+// Rest machining: a following (smaller) tool only cuts what earlier operations left behind.
+// Each earlier operation is modelled by its tool radius and cut depths. At a cut depth the
+// tool clears every point it can reach without touching the part there (the opening of the
+// free space by the tool). The tool is a cylinder, so that footprint is also cleared at every
+// height above it; seen from above the operations form a stepped heightfield. The rest on a
+// layer is the material the new tool can reach minus the footprints of the nearest cut at or
+// below that layer, one per earlier operation. Walls are assumed not to overhang, which 2.5D
+// machining cannot cut anyway.
+
+struct RestOperation {
+    float toolRadius = 3.0f;
+    std::vector<float> heights;         // Cut depths, any order
+};
+
+struct RestSettings {
+    float toolRadius = 1.0f;            // Radius of the following tool
+    float minWidth = 0.05f;             // Rest thinner than this is ignored
+};
+
+struct RestStats {
+    size_t layers = 0;                  // Layers with rest material
+    double area = 0.0;                  // Total rest area over all layers
+};
+
+// Rest material of every layer (same order as the layers) after the earlier operations.
+// Footprints and per-layer booleans run in parallel.
+std::vector<ClipperLib::Paths> computeRestMaterial(const std::vector<Layer>& layers, const std::vector<RestOperation>& previous,
+    const RestSettings& settings, RestStats* stats = nullptr);
+
+// Keeps the parts of flat toolpaths (one cutting height, such as profiles) where the tool
+// touches rest material on the layer at that height, with short gaps cut through at depth.
+// Arcs are flattened to lines; toolpaths that are not flat or match no layer are kept whole.
+std::vector<Toolpath> restrictToRest(const std::vector<Toolpath>& toolpaths, const std::vector<Layer>& layers,
+    const std::vector<ClipperLib::Paths>& rest, const RestSettings& settings);
+
+#endif // REST_H
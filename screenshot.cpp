@@ -0,0 +1,369 @@
+// screenshot.cpp
+#include "screenshot.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <zlib.h>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <iostream>
+
+namespace {
+
+// Bands that may wait for the encoder before rendering pauses; bounds memory to a few bands
+const size_t MAX_QUEUED_BANDS = 2;
+const size_t DEFLATE_CHUNK = 256 * 1024;
+
+void putBigEndian(unsigned char* out, unsigned int value) {
+    out[0] = static_cast<unsigned char>(value >> 24);
+    out[1] = static_cast<unsigned char>(value >> 16);
+    out[2] = static_cast<unsigned char>(value >> 8);
+    out[3] = static_cast<unsigned char>(value);
+}
+
+void writePngChunk(std::ofstream& out, const char* type, const unsigned char* data, size_t length) {
+    unsigned char header[8];
+    putBigEndian(header, static_cast<unsigned int>(length));
+    std::memcpy(header + 4, type, 4);
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    if (length > 0) {
+        out.write(reinterpret_cast<const char*>(data), length);
+    }
+
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, reinterpret_cast<const Bytef*>(type), 4);
+    if (length > 0) {
+        crc = crc32(crc, data, static_cast<uInt>(length));
+    }
+    unsigned char footer[4];
+    putBigEndian(footer, static_cast<unsigned int>(crc));
+    out.write(reinterpret_cast<const char*>(footer), sizeof(footer));
+}
+
+} // namespace
+
+ScreenshotCapture::ScreenshotCapture() : rowsEncoded(0), encoderDone(false), failed(false) {
+}
+
+ScreenshotCapture::~ScreenshotCapture() {
+    if (encoderThread.joinable()) {
+        if (capturing) {
+            // Let the encoder finish what it has so it can exit
+            std::lock_guard<std::mutex> lock(encoderMutex);
+            Band last;
+            last.last = true;
+            encoderQueue.push_back(std::move(last));
+        }
+        encoderCondition.notify_all();
+        encoderThread.join();
+    }
+}
+
+bool ScreenshotCapture::begin(const std::string& outputPath, int imageWidth, int imageHeight, float fieldOfView, int tile) {
+    if (isBusy()) {
+        std::cerr << "Error: A screenshot is already being saved" << std::endl;
+        return false;
+    }
+    if (imageWidth <= 0 || imageHeight <= 0 || tile <= 0) {
+        std::cerr << "Error: Invalid screenshot size " << imageWidth << "x" << imageHeight << std::endl;
+        return false;
+    }
+
+    errorMessage.clear();
+    failed = false;
+    out = std::ofstream(outputPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        fail("Cannot write screenshot " + outputPath);
+        return false;
+    }
+
+    path = outputPath;
+    width = imageWidth;
+    height = imageHeight;
+    tileSize = std::min(tile, std::max(width, height));
+    tilesX = (width + tileSize - 1) / tileSize;
+    tilesY = (height + tileSize - 1) / tileSize;
+    fovY = fieldOfView;
+    nextTile = 0;
+    pendingTile = -1;
+    bandTilesDone = 0;
+    rowsEncoded = 0;
+    encoderDone = false;
+    encoderQueue.clear();
+
+    createTargets();
+    if (!framebuffer) {
+        out.close();
+        std::remove(path.c_str());
+        fail("Cannot create the screenshot framebuffer");
+        return false;
+    }
+
+    currentBand = Band();
+    currentBand.rows = std::min(tileSize, height);
+    currentBand.pixels.resize(size_t(width) * currentBand.rows * 3);
+
+    capturing = true;
+    encoderThread = std::thread(&ScreenshotCapture::encoderMain, this);
+    return true;
+}
+
+float ScreenshotCapture::progress() const {
+    int totalTiles = tilesX * tilesY;
+    if (totalTiles == 0) return 0.0f;
+    return 0.5f * float(nextTile) / float(totalTiles) + 0.5f * float(rowsEncoded) / float(height);
+}
+
+void ScreenshotCapture::tileRect(int tile, int& x, int& top, int& w, int& h) const {
+    x = (tile % tilesX) * tileSize;
+    top = (tile / tilesX) * tileSize;
+    w = std::min(tileSize, width - x);
+    h = std::min(tileSize, height - top);
+}
+
+// Offscreen target of one tile, set up the same way as the viewer framebuffer
+void ScreenshotCapture::createTargets() {
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    glGenTextures(1, &colorTexture);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, tileSize, tileSize, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+
+    glGenRenderbuffers(1, &depthRenderbuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, tileSize, tileSize);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        std::cerr << "ERROR::FRAMEBUFFER:: Screenshot framebuffer is not complete!" << std::endl;
+        destroyTargets();
+        return;
+    }
+
+    glGenBuffers(2, pbo);
+    for (int i = 0; i < 2; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size_t(tileSize) * tileSize * 3, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void ScreenshotCapture::destroyTargets() {
+    if (pbo[0]) glDeleteBuffers(2, pbo);
+    if (depthRenderbuffer) glDeleteRenderbuffers(1, &depthRenderbuffer);
+    if (colorTexture) glDeleteTextures(1, &colorTexture);
+    if (framebuffer) glDeleteFramebuffers(1, &framebuffer);
+    pbo[0] = pbo[1] = 0;
+    depthRenderbuffer = colorTexture = framebuffer = 0;
+}
+
+// Start an asynchronous copy of the rendered tile into a pixel buffer object
+void ScreenshotCapture::readbackTile(int tile, int slot) {
+    int x, top, w, h;
+    tileRect(tile, x, top, w, h);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[slot]);
+    glReadPixels(0, 0, w, h, GL_RGB, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+// Copy a finished readback into the current band, flipping rows to top-down order, and
+// hand the band to the encoder once all of its tiles are in
+void ScreenshotCapture::copyTile(int tile, int slot) {
+    int x, top, w, h;
+    tileRect(tile, x, top, w, h);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo[slot]);
+    const unsigned char* src = static_cast<const unsigned char*>(glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY));
+    if (src) {
+        for (int row = 0; row < h; row++) {
+            unsigned char* dst = currentBand.pixels.data() + (size_t(h - 1 - row) * width + x) * 3;
+            std::memcpy(dst, src + size_t(row) * w * 3, size_t(w) * 3);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else {
+        std::cerr << "Error: Failed to map screenshot pixel buffer" << std::endl;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    if (++bandTilesDone < tilesX) return;
+
+    int band = tile / tilesX;
+    currentBand.last = band == tilesY - 1;
+    {
+        std::lock_guard<std::mutex> lock(encoderMutex);
+        encoderQueue.push_back(std::move(currentBand));
+    }
+    encoderCondition.notify_one();
+
+    bandTilesDone = 0;
+    currentBand = Band();
+    if (band + 1 < tilesY) {
+        currentBand.rows = std::min(tileSize, height - (band + 1) * tileSize);
+        currentBand.pixels.resize(size_t(width) * currentBand.rows * 3);
+    }
+}
+
+void ScreenshotCapture::step(const RenderCallback& render, int tilesPerFrame) {
+    if (capturing && failed) {
+        abortCapture();
+    }
+    if (!capturing) {
+        if (encoderThread.joinable() && encoderDone) {
+            encoderThread.join();
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(encoderMutex);
+        if (encoderQueue.size() >= MAX_QUEUED_BANDS) return;
+    }
+
+    GLint savedViewport[4];
+    glGetIntegerv(GL_VIEWPORT, savedViewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    glm::mat4 projection = glm::perspective(fovY, float(width) / float(height), 0.1f, 100.0f);
+    int totalTiles = tilesX * tilesY;
+    for (int i = 0; i < tilesPerFrame && nextTile < totalTiles; i++) {
+        int x, top, w, h;
+        tileRect(nextTile, x, top, w, h);
+        int y = height - top - h;  // GL rows start at the bottom
+
+        // Map the tile's part of the full view volume onto the whole tile viewport
+        float left = 2.0f * x / width - 1.0f;
+        float right = 2.0f * (x + w) / width - 1.0f;
+        float bottom = 2.0f * y / height - 1.0f;
+        float topNdc = 2.0f * (y + h) / height - 1.0f;
+        glm::mat4 crop = glm::translate(glm::mat4(1.0f), glm::vec3(-(left + right) / (right - left), -(bottom + topNdc) / (topNdc - bottom), 0.0f));
+        crop = glm::scale(crop, glm::vec3(2.0f / (right - left), 2.0f / (topNdc - bottom), 1.0f));
+
+        glViewport(0, 0, w, h);
+        render(crop * projection);
+
+        // Read this tile into one PBO while the previous tile's PBO is drained
+        int slot = nextTile % 2;
+        readbackTile(nextTile, slot);
+        if (pendingTile >= 0) {
+            copyTile(pendingTile, pendingSlot);
+        }
+        pendingTile = nextTile;
+        pendingSlot = slot;
+        nextTile++;
+    }
+
+    if (nextTile == totalTiles && pendingTile >= 0) {
+        copyTile(pendingTile, pendingSlot);
+        pendingTile = -1;
+        capturing = false;
+        destroyTargets();
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+}
+
+// Records the error before the flag, so error() is complete once hasFailed() is seen
+void ScreenshotCapture::fail(const std::string& message) {
+    std::cerr << "Error: " << message << std::endl;
+    errorMessage = message;
+    failed = true;
+}
+
+// Stops rendering tiles after the encoder failed; the encoder has already exited
+void ScreenshotCapture::abortCapture() {
+    capturing = false;
+    pendingTile = -1;
+    bandTilesDone = 0;
+    currentBand = Band();
+    destroyTargets();
+    std::lock_guard<std::mutex> lock(encoderMutex);
+    encoderQueue.clear();
+}
+
+// Worker thread: filter each row (PNG "Sub" filter), deflate, and write IDAT chunks as the
+// bands arrive, so the full image never has to be held in memory
+void ScreenshotCapture::encoderMain() {
+    const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    unsigned char ihdr[13];
+    putBigEndian(ihdr, static_cast<unsigned int>(width));
+    putBigEndian(ihdr + 4, static_cast<unsigned int>(height));
+    ihdr[8] = 8;    // Bit depth
+    ihdr[9] = 2;    // Colour type RGB
+    ihdr[10] = 0;   // Deflate
+    ihdr[11] = 0;   // Adaptive filtering
+    ihdr[12] = 0;   // No interlace
+    out.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+    writePngChunk(out, "IHDR", ihdr, sizeof(ihdr));
+
+    z_stream stream = {};
+    deflateInit(&stream, Z_DEFAULT_COMPRESSION);
+    std::vector<unsigned char> compressed(DEFLATE_CHUNK);
+    std::vector<unsigned char> filtered;
+    size_t rowBytes = size_t(width) * 3;
+
+    auto deflateInto = [&](int flush) {
+        do {
+            stream.next_out = compressed.data();
+            stream.avail_out = static_cast<uInt>(compressed.size());
+            deflate(&stream, flush);
+            size_t produced = compressed.size() - stream.avail_out;
+            if (produced > 0) {
+                writePngChunk(out, "IDAT", compressed.data(), produced);
+            }
+        } while (stream.avail_out == 0);
+    };
+
+    bool last = false;
+    while (!last && out) {
+        Band band;
+        {
+            std::unique_lock<std::mutex> lock(encoderMutex);
+            encoderCondition.wait(lock, [this] { return !encoderQueue.empty(); });
+            band = std::move(encoderQueue.front());
+            encoderQueue.pop_front();
+        }
+        last = band.last;
+
+        filtered.resize(size_t(band.rows) * (rowBytes + 1));
+        for (int row = 0; row < band.rows; row++) {
+            const unsigned char* src = band.pixels.data() + size_t(row) * rowBytes;
+            unsigned char* dst = filtered.data() + size_t(row) * (rowBytes + 1);
+            dst[0] = 1;
+            std::memcpy(dst + 1, src, 3);
+            for (size_t i = 3; i < rowBytes; i++) {
+                dst[1 + i] = static_cast<unsigned char>(src[i] - src[i - 3]);
+            }
+        }
+
+        stream.next_in = filtered.data();
+        stream.avail_in = static_cast<uInt>(filtered.size());
+        deflateInto(Z_NO_FLUSH);
+        rowsEncoded += band.rows;
+    }
+
+    if (out) {
+        deflateInto(Z_FINISH);
+        writePngChunk(out, "IEND", nullptr, 0);
+    }
+    deflateEnd(&stream);
+    out.close();
+
+    // A write error (disk full, removed drive) leaves a broken file; drop it and stop the capture
+    if (out.fail()) {
+        std::remove(path.c_str());
+        fail("Failed writing screenshot " + path);
+    }
+    else if (rowsEncoded == height) {
+        std::cout << "Saved screenshot " << path << " (" << width << "x" << height << ")" << std::endl;
+    }
+    encoderDone = true;
+}
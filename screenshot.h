@@ -0,0 +1,95 @@
+// screenshot.h
+#ifndef SCREENSHOT_H
+#define SCREENSHOT_H
+
+#include <vector>
+#include <string>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <glm/glm.hpp>
+#include <GL/glew.h>      // Must be included before other OpenGL headers
+#include <GLFW/glfw3.h>   // GLFW should come after GLEW
+
+// Renders the scene at an arbitrary resolution into PNG, one tile at a time. Each tile is
+// drawn into an offscreen framebuffer with a sub-frustum of the full projection, read back
+// through two alternating pixel buffer objects, and complete bands of tiles are handed to a
+// worker thread that filters, deflates and writes them, so the UI keeps running.
+class ScreenshotCapture {
+public:
+    // Draws the scene with the given projection into the currently bound framebuffer
+    typedef std::function<void(const glm::mat4& projection)> RenderCallback;
+
+    ScreenshotCapture();
+    ~ScreenshotCapture();
+
+    // Start a capture; fails if one is already running or the file cannot be created
+    bool begin(const std::string& path, int width, int height, float fovY, int tileSize = 1024);
+
+    // Render and read back up to tilesPerFrame tiles. Call once per frame on the GL thread.
+    void step(const RenderCallback& render, int tilesPerFrame = 2);
+
+    // True until the PNG has been completely written
+    bool isBusy() const { return capturing || encoderThread.joinable(); }
+    bool isCapturing() const { return capturing; }
+    float progress() const;
+    int imageHeight() const { return height; }
+
+    // Set when the last capture could not be written; the capture stops at the first error.
+    // error() is the message and stays valid until the next begin().
+    bool hasFailed() const { return failed; }
+    const std::string& error() const { return errorMessage; }
+
+private:
+    struct Band {
+        std::vector<unsigned char> pixels;  // RGB rows, top to bottom
+        int rows = 0;
+        bool last = false;
+    };
+
+    // Tile rectangle in image pixels, rows counted from the top
+    void tileRect(int tile, int& x, int& top, int& w, int& h) const;
+    void createTargets();
+    void destroyTargets();
+    void readbackTile(int tile, int slot);
+    void copyTile(int tile, int slot);
+    void encoderMain();
+    void fail(const std::string& message);
+    void abortCapture();
+
+    std::string path;
+    std::ofstream out;          // Opened by begin(), written by the encoder
+    std::string errorMessage;
+    int width = 0;
+    int height = 0;
+    int tileSize = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    int nextTile = 0;
+    int pendingTile = -1;       // Tile whose pixels are in flight in pbo[pendingSlot]
+    int pendingSlot = 0;
+    float fovY = 0.0f;
+    bool capturing = false;
+
+    GLuint framebuffer = 0;
+    GLuint colorTexture = 0;
+    GLuint depthRenderbuffer = 0;
+    GLuint pbo[2] = { 0, 0 };
+
+    Band currentBand;
+    int bandTilesDone = 0;
+
+    std::thread encoderThread;
+    std::mutex encoderMutex;
+    std::condition_variable encoderCondition;
+    std::deque<Band> encoderQueue;
+    std::atomic<int> rowsEncoded;
+    std::atomic<bool> encoderDone;
+    std::atomic<bool> failed;
+};
+
+#endif // SCREENSHOT_H
@@ -0,0 +1,220 @@
+// section.cpp
+#include "section.h"
+#include "callbacks.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace {
+
+// Layer closest to a height; layers are sorted bottom-up
+size_t nearestLayerIndex(const std::vector<Layer>& layers, float height) {
+    auto it = std::lower_bound(layers.begin(), layers.end(), height, [](const Layer& layer, float h) { return layer.height < h; });
+    if (it == layers.end()) return layers.size() - 1;
+    size_t index = it - layers.begin();
+    if (index > 0 && height - layers[index - 1].height < it->height - height) index--;
+    return index;
+}
+
+// Position + colour, as the line shaders expect
+void appendLineVertex(std::vector<float>& vertices, const glm::vec3& position, const glm::vec3& color) {
+    vertices.insert(vertices.end(), { position.x, position.y, position.z, color.r, color.g, color.b });
+}
+
+} // namespace
+
+SectionView::~SectionView() {
+    release();
+}
+
+glm::vec4 SectionView::plane(const glm::mat4& model) const {
+    float worldHeight = (model * glm::vec4(0.0f, height, 0.0f, 1.0f)).y;
+    return glm::vec4(0.0f, -1.0f, 0.0f, worldHeight);
+}
+
+void SectionView::begin(GLuint program, const glm::mat4& model) const {
+    if (!enabled) return;
+    glUseProgram(program);
+    glUniform4fv(glGetUniformLocation(program, "clipPlane"), 1, glm::value_ptr(plane(model)));
+    glEnable(GL_CLIP_DISTANCE0);
+}
+
+void SectionView::end() const {
+    glDisable(GL_CLIP_DISTANCE0);
+}
+
+void SectionView::renderCap(GLuint meshProgram, GLuint capProgram, const std::vector<Mesh>& meshes, const glm::mat4& model,
+    const glm::mat4& view, const glm::mat4& projection) {
+    if (!enabled || !cap || meshes.empty()) return;
+
+    // Bounds come from the upload, so released CPU copies do not matter
+    glm::vec3 boundsMin(std::numeric_limits<float>::max()), boundsMax(-std::numeric_limits<float>::max());
+    for (const Mesh& mesh : meshes) {
+        if (mesh.VAO == 0) continue;
+        boundsMin = glm::min(boundsMin, mesh.boundsMin);
+        boundsMax = glm::max(boundsMax, mesh.boundsMax);
+    }
+    if (boundsMin.x > boundsMax.x || height <= boundsMin.y || height >= boundsMax.y) return;
+
+    if (capVAO == 0) {
+        // Unit square in the XZ plane facing up, as a strip
+        const float quad[] = {
+            -1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+             1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f,
+            -1.0f, 0.0f,  1.0f, 0.0f, 1.0f, 0.0f,
+             1.0f, 0.0f,  1.0f, 0.0f, 1.0f, 0.0f
+        };
+        glGenVertexArrays(1, &capVAO);
+        glGenBuffers(1, &capVBO);
+        glBindVertexArray(capVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, capVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+    }
+
+    GLint polygonMode[2] = { GL_FILL, GL_FILL };
+    glGetIntegerv(GL_POLYGON_MODE, polygonMode);
+    GLboolean culling = glIsEnabled(GL_CULL_FACE);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDisable(GL_CULL_FACE);
+
+    // Parity of the remaining surfaces along each pixel's ray: odd where the plane is inside
+    // the solid. Depth testing is off so hidden surfaces count as well.
+    glEnable(GL_STENCIL_TEST);
+    glStencilMask(1);
+    glClear(GL_STENCIL_BUFFER_BIT);
+    glStencilFunc(GL_ALWAYS, 0, 1);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_INVERT);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glDisable(GL_DEPTH_TEST);
+
+    begin(meshProgram, model);
+    glUniformMatrix4fv(glGetUniformLocation(meshProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    glUniformMatrix4fv(glGetUniformLocation(meshProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(meshProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    for (const Mesh& mesh : meshes) {
+        if (mesh.VAO == 0) continue;
+        glBindVertexArray(mesh.VAO);
+        glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
+        renderStats.drawCalls++;
+        renderStats.triangles += mesh.indexCount / 3;
+    }
+    end();
+
+    // Fill the plane where the parity is odd. The offset keeps contour lines on top.
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+    glStencilFunc(GL_EQUAL, 1, 1);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(1.0f, 1.0f);
+
+    glm::vec3 center = 0.5f * (boundsMin + boundsMax);
+    glm::vec3 extent = 0.5f * (boundsMax - boundsMin) * 1.01f + glm::vec3(1e-3f);
+    glm::mat4 capModel = glm::translate(model, glm::vec3(center.x, height, center.z));
+    capModel = glm::scale(capModel, glm::vec3(extent.x, 1.0f, extent.z));
+    glUseProgram(capProgram);
+    glUniformMatrix4fv(glGetUniformLocation(capProgram, "model"), 1, GL_FALSE, glm::value_ptr(capModel));
+    glUniformMatrix4fv(glGetUniformLocation(capProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(capProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    glUniform3fv(glGetUniformLocation(capProgram, "objectColor"), 1, glm::value_ptr(capColor));
+    glBindVertexArray(capVAO);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    renderStats.drawCalls++;
+    renderStats.triangles += 2;
+
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glStencilMask(0xFF);
+    glDisable(GL_STENCIL_TEST);
+    glPolygonMode(GL_FRONT_AND_BACK, polygonMode[0]);
+    if (culling) glEnable(GL_CULL_FACE);
+}
+
+float SectionView::nearestLayerHeight(const std::vector<Layer>& layers) const {
+    if (layers.empty()) return height;
+    return layers[nearestLayerIndex(layers, height)].height;
+}
+
+void SectionView::updateContour(const std::vector<Layer>& layers, unsigned int generation) {
+    if (!enabled || !showContour || layers.empty()) {
+        contourVertexCount = 0;
+        contourValid = false;
+        return;
+    }
+
+    // Only the layer the plane is in; between layers there is no exact contour to show
+    size_t index = nearestLayerIndex(layers, height);
+    const Layer& layer = layers[index];
+    float tolerance = std::max(0.5f * layer.thickness, 1e-3f);
+    if (std::fabs(layer.height - height) > tolerance) {
+        contourVertexCount = 0;
+        contourValid = false;
+        return;
+    }
+    if (contourValid && generation == contourGeneration && index == contourLayer) return;
+    contourValid = true;
+    contourGeneration = generation;
+    contourLayer = index;
+    contourHeight = layer.height;
+
+    std::vector<float> vertices;
+    for (const Contour& contour : layer.contours) {
+        size_t count = contour.points.size();
+        size_t segments = contour.closed ? count : (count > 0 ? count - 1 : 0);
+        for (size_t i = 0; i < segments; i++) {
+            const glm::vec2& a = contour.points[i];
+            const glm::vec2& b = contour.points[(i + 1) % count];
+            appendLineVertex(vertices, glm::vec3(a.x, layer.height, a.y), contourColor);
+            appendLineVertex(vertices, glm::vec3(b.x, layer.height, b.y), contourColor);
+        }
+    }
+
+    if (contourVAO == 0) {
+        glGenVertexArrays(1, &contourVAO);
+        glGenBuffers(1, &contourVBO);
+        glBindVertexArray(contourVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, contourVBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, contourVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    contourVertexCount = static_cast<GLsizei>(vertices.size() / 6);
+}
+
+void SectionView::renderContour(GLuint lineProgram, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) const {
+    if (!enabled || !showContour || contourVertexCount == 0) return;
+
+    // Drawn on the plane even when it sits between the layer and the next one
+    glm::mat4 contourModel = glm::translate(model, glm::vec3(0.0f, height - contourHeight, 0.0f));
+    glUseProgram(lineProgram);
+    glUniformMatrix4fv(glGetUniformLocation(lineProgram, "model"), 1, GL_FALSE, glm::value_ptr(contourModel));
+    glUniformMatrix4fv(glGetUniformLocation(lineProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(lineProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    glBindVertexArray(contourVAO);
+    glDrawArrays(GL_LINES, 0, contourVertexCount);
+    glBindVertexArray(0);
+}
+
+void SectionView::release() {
+    if (capVBO) glDeleteBuffers(1, &capVBO);
+    if (capVAO) glDeleteVertexArrays(1, &capVAO);
+    if (contourVBO) glDeleteBuffers(1, &contourVBO);
+    if (contourVAO) glDeleteVertexArrays(1, &contourVAO);
+    capVAO = capVBO = contourVAO = contourVBO = 0;
+    contourVertexCount = 0;
+    contourValid = false;
+}
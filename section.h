@@ -0,0 +1,68 @@
+// section.h
+#ifndef SECTION_H
+#define SECTION_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <GL/glew.h>      // Must be included before other OpenGL headers
+#include <GLFW/glfw3.h>   // GLFW should come after GLEW
+#include "model.h"
+#include "slicer.h"
+
+// Interactive horizontal section through the model, done entirely on the GPU. Meshes are
+// drawn with the SHADER_SECTION variant, which cuts away everything above the plane through
+// gl_ClipDistance. The cut surface is capped with the stencil buffer: drawing the clipped
+// meshes again with GL_INVERT leaves an odd count, where the plane lies inside the solid, and
+// a quad on the plane is filled there. Moving the plane only changes a uniform, so scrubbing
+// costs one extra colourless pass over the meshes and no CPU geometry work. The contour of
+// the cached slice at the plane height can be drawn on top; its lines are rebuilt only when
+// the plane reaches another layer.
+class SectionView {
+public:
+    ~SectionView();
+
+    bool enabled = false;
+    float height = 0.0f;                // Plane height in mesh coordinates (viewer Y)
+    bool cap = true;
+    bool showContour = true;
+    glm::vec3 capColor = glm::vec3(0.85f, 0.35f, 0.25f);
+    glm::vec3 contourColor = glm::vec3(1.0f, 0.9f, 0.2f);
+
+    bool isActive() const { return enabled; }
+
+    // Clip plane for programs of the SHADER_SECTION variant: keeps what is below the plane
+    glm::vec4 plane(const glm::mat4& model) const;
+
+    // Sets the plane on a SHADER_SECTION program and enables the clip distance; end() disables
+    // it again before programs without the variant draw
+    void begin(GLuint program, const glm::mat4& model) const;
+    void end() const;
+
+    // Fills the cut surface of the meshes drawn since begin(). meshProgram is the SECTION
+    // program they were drawn with, capProgram an unlit one (SHADER_WIREFRAME).
+    void renderCap(GLuint meshProgram, GLuint capProgram, const std::vector<Mesh>& meshes, const glm::mat4& model,
+        const glm::mat4& view, const glm::mat4& projection);
+
+    // Picks the slicer layer at the plane height; the overlay is rebuilt when it changes.
+    // generation must change whenever the caller replaces the layers.
+    void updateContour(const std::vector<Layer>& layers, unsigned int generation);
+    void renderContour(GLuint lineProgram, const glm::mat4& model, const glm::mat4& view, const glm::mat4& projection) const;
+
+    // Height of the layer nearest to the plane, or the plane height without layers
+    float nearestLayerHeight(const std::vector<Layer>& layers) const;
+
+    void release();
+
+private:
+    GLuint capVAO = 0;
+    GLuint capVBO = 0;
+    GLuint contourVAO = 0;
+    GLuint contourVBO = 0;
+    GLsizei contourVertexCount = 0;
+    bool contourValid = false;
+    unsigned int contourGeneration = 0;     // Layers and layer the overlay was built from
+    size_t contourLayer = 0;
+    float contourHeight = 0.0f;
+};
+
+#endif // SECTION_H
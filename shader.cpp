@@ -1,5 +1,9 @@
 #include "shader.h"
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstdio>
 
 // Optimized Vertex Shader
 const char* vertexShaderSource = R"glsl(
@@ -10,15 +14,30 @@ const char* vertexShaderSource = R"glsl(
     uniform mat4 model;
     uniform mat4 view;
     uniform mat4 projection;
+    #ifdef QUANTIZED
+    uniform vec3 quantScale;    // Positions arrive as normalized integers in [-1, 1]
+    uniform vec3 quantOffset;
+    #endif
+    #ifdef SECTION
+    uniform vec4 clipPlane;     // World space; geometry on the negative side is cut away
+    #endif
 
     out vec3 FragPos;
     out vec3 Normal;
 
     void main() {
+    #ifdef QUANTIZED
+        vec3 position = aPos * quantScale + quantOffset;
+    #else
+        vec3 position = aPos;
+    #endif
         // Calculate the fragment position and normal
-        FragPos = vec3(model * vec4(aPos, 1.0));
+        FragPos = vec3(model * vec4(position, 1.0));
         Normal = normalize(mat3(model) * aNormal); // Avoiding transpose(inverse) for performance
         gl_Position = projection * view * vec4(FragPos, 1.0);
+    #ifdef SECTION
+        gl_ClipDistance[0] = dot(vec4(FragPos, 1.0), clipPlane);
+    #endif
     }
 )glsl";
 
@@ -37,6 +56,10 @@ const char* fragmentShaderSource = R"glsl(
     uniform float lightIntensity;
 
     void main() {
+    #ifdef WIREFRAME
+        // Flat edges; lighting only makes wires flicker
+        FragColor = vec4(objectColor, 1.0);
+    #else
         // Ambient lighting
         vec3 ambient = 0.1 * lightColor * lightIntensity;
 
@@ -55,6 +78,43 @@ const char* fragmentShaderSource = R"glsl(
         // Combine results
         vec3 result = (ambient + diffuse + specular) * objectColor;
         FragColor = vec4(result, 1.0);
+    #endif
+    }
+)glsl";
+
+// Unlit coloured lines
+const char* lineVertexShaderSource = R"glsl(
+    #version 330 core
+    layout (location = 0) in vec3 aPos;
+    layout (location = 1) in vec3 aColor;
+
+    uniform mat4 model;
+    uniform mat4 view;
+    uniform mat4 projection;
+    #ifdef SECTION
+    uniform vec4 clipPlane;
+    #endif
+
+    out vec3 Color;
+
+    void main() {
+        Color = aColor;
+        vec4 worldPos = model * vec4(aPos, 1.0);
+        gl_Position = projection * view * worldPos;
+    #ifdef SECTION
+        gl_ClipDistance[0] = dot(worldPos, clipPlane);
+    #endif
+    }
+)glsl";
+
+const char* lineFragmentShaderSource = R"glsl(
+    #version 330 core
+    out vec4 FragColor;
+
+    in vec3 Color;
+
+    void main() {
+        FragColor = vec4(Color, 1.0);
     }
 )glsl";
 
@@ -103,3 +163,255 @@ GLuint createShaderProgram(const char* vertexSource, const char* fragmentSource)
 
     return shaderProgram;
 }
+
+namespace {
+
+// 64-bit FNV-1a, chained over several strings
+unsigned long long hashString(const std::string& text, unsigned long long hash = 14695981039346656037ull) {
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string glString(GLenum name) {
+    const GLubyte* value = glGetString(name);
+    return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+// Inserts the variant defines after the #version line, which must stay first
+std::string applyDefines(const std::string& source, const std::string& defines) {
+    size_t version = source.find("#version");
+    if (version == std::string::npos) return defines + source;
+    size_t lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos) return source + "\n" + defines;
+    return source.substr(0, lineEnd + 1) + defines + source.substr(lineEnd + 1);
+}
+
+// Like createShader, but returns 0 when compilation fails so that callers can keep an older program
+GLuint compileShader(GLenum type, const std::string& source, const std::string& name) {
+    GLuint shader = glCreateShader(type);
+    const char* text = source.c_str();
+    glShaderSource(shader, 1, &text, NULL);
+    glCompileShader(shader);
+
+    GLint success;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char infoLog[1024];
+        glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+        std::cerr << "Error: Shader compilation failed (" << name << ")\n" << infoLog << std::endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+bool linkSucceeded(GLuint program, bool report) {
+    GLint success;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if (!success && report) {
+        char infoLog[1024];
+        glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+        std::cerr << "Error: Shader linking failed\n" << infoLog << std::endl;
+    }
+    return success != 0;
+}
+
+// Cache file layout: header followed by the driver's program binary
+struct ProgramBinaryHeader {
+    char magic[4];          // "SHBC"
+    unsigned int format;    // Driver-specific binary format
+    unsigned int length;
+    unsigned int reserved;
+};
+
+} // namespace
+
+ShaderManager::~ShaderManager() {
+    release();
+}
+
+void ShaderManager::init(const std::string& cacheDirectory, const std::string& sourceDirectory) {
+    release();
+    cacheDir = cacheDirectory;
+    sourceDir = sourceDirectory;
+
+    GLint formats = 0;
+    if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    }
+    binaryCacheSupported = formats > 0 && !cacheDir.empty();
+    if (binaryCacheSupported) {
+        std::error_code error;
+        std::filesystem::create_directories(cacheDir, error);
+    }
+    driverHash = hashString(glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION));
+
+    const char* names[4] = { "mesh.vert", "mesh.frag", "line.vert", "line.frag" };
+    const char* builtIns[4] = { vertexShaderSource, fragmentShaderSource, lineVertexShaderSource, lineFragmentShaderSource };
+    for (int i = 0; i < 4; i++) {
+        sources[i] = SourceFile();
+        sources[i].name = names[i];
+        sources[i].builtIn = builtIns[i];
+        loadSource(sources[i]);
+    }
+    lastPoll = std::chrono::steady_clock::now();
+}
+
+// Uses the file in the source directory when there is one, the built-in text otherwise
+bool ShaderManager::loadSource(SourceFile& source) {
+    std::string previous = source.text;
+    source.text = source.builtIn;
+    source.fromDisk = false;
+    source.stamp = std::filesystem::file_time_type();
+
+    if (!sourceDir.empty()) {
+        std::filesystem::path path = std::filesystem::path(sourceDir) / source.name;
+        std::error_code error;
+        std::filesystem::file_time_type stamp = std::filesystem::last_write_time(path, error);
+        if (!error) {
+            std::ifstream file(path, std::ios::binary);
+            std::stringstream text;
+            text << file.rdbuf();
+            if (file) {
+                source.text = text.str();
+                source.fromDisk = true;
+                source.stamp = stamp;
+            }
+        }
+    }
+    return source.text != previous;
+}
+
+std::string ShaderManager::defines(unsigned int variant) {
+    std::string text;
+    if (variant & SHADER_QUANTIZED) text += "#define QUANTIZED\n";
+    if (variant & SHADER_WIREFRAME) text += "#define WIREFRAME\n";
+    if (variant & SHADER_TOOLPATH) text += "#define TOOLPATH\n";
+    if (variant & SHADER_SECTION) text += "#define SECTION\n";
+    return text;
+}
+
+GLuint ShaderManager::program(unsigned int variant) {
+    auto found = programs.find(variant);
+    if (found != programs.end()) return found->second;
+
+    GLuint built = buildProgram(variant);
+    programs[variant] = built;
+    return built;
+}
+
+GLuint ShaderManager::buildProgram(unsigned int variant) {
+    const SourceFile& vertex = sources[variant & SHADER_TOOLPATH ? 2 : 0];
+    const SourceFile& fragment = sources[variant & SHADER_TOOLPATH ? 3 : 1];
+    std::string header = defines(variant);
+    std::string vertexText = applyDefines(vertex.text, header);
+    std::string fragmentText = applyDefines(fragment.text, header);
+
+    // Driver strings and sources together, so that a driver update or an edited shader
+    // never picks up a stale binary
+    unsigned long long key = hashString(fragmentText, hashString(vertexText, driverHash));
+    char keyText[17];
+    std::snprintf(keyText, sizeof(keyText), "%016llx", key);
+    std::filesystem::path cachePath = std::filesystem::path(cacheDir) / (std::string(keyText) + ".bin");
+
+    if (binaryCacheSupported) {
+        std::ifstream file(cachePath, std::ios::binary | std::ios::ate);
+        std::streamoff fileSize = file ? static_cast<std::streamoff>(file.tellg()) : 0;
+        file.seekg(0);
+        ProgramBinaryHeader cached;
+        // A truncated or corrupt file must not make us allocate whatever its length says
+        if (file.read(reinterpret_cast<char*>(&cached), sizeof(cached)) && std::string(cached.magic, 4) == "SHBC"
+            && cached.length > 0 && cached.length == fileSize - static_cast<std::streamoff>(sizeof(cached))) {
+            std::vector<char> binary(cached.length);
+            if (file.read(binary.data(), binary.size())) {
+                GLuint program = glCreateProgram();
+                glProgramBinary(program, cached.format, binary.data(), static_cast<GLsizei>(binary.size()));
+                if (linkSucceeded(program, false)) {
+                    cacheHits++;
+                    return program;
+                }
+                // Rejected by the driver (updated or different GPU); rebuild below
+                glDeleteProgram(program);
+            }
+        }
+    }
+
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexText, vertex.name);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentText, fragment.name);
+    if (!vertexShader || !fragmentShader) {
+        if (vertexShader) glDeleteShader(vertexShader);
+        if (fragmentShader) glDeleteShader(fragmentShader);
+        return 0;
+    }
+
+    GLuint program = glCreateProgram();
+    if (binaryCacheSupported) {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    if (!linkSucceeded(program, true)) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    compiled++;
+
+    if (binaryCacheSupported) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length > 0) {
+            std::vector<char> binary(length);
+            GLenum format = 0;
+            glGetProgramBinary(program, length, &length, &format, binary.data());
+
+            ProgramBinaryHeader cached = { { 'S', 'H', 'B', 'C' }, format, static_cast<unsigned int>(length), 0 };
+            std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&cached), sizeof(cached));
+            file.write(binary.data(), length);
+        }
+    }
+    return program;
+}
+
+bool ShaderManager::reloadIfChanged() {
+    if (sourceDir.empty()) return false;
+
+    // Polling a handful of files twice a second is cheap enough to leave on
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastPoll < std::chrono::milliseconds(500)) return false;
+    lastPoll = now;
+
+    bool changed = false;
+    for (SourceFile& source : sources) {
+        std::error_code error;
+        std::filesystem::file_time_type stamp = std::filesystem::last_write_time(std::filesystem::path(sourceDir) / source.name, error);
+        bool onDisk = !error;
+        if (onDisk != source.fromDisk || (onDisk && stamp != source.stamp)) {
+            changed |= loadSource(source);
+        }
+    }
+    if (!changed) return false;
+
+    // Rebuild every variant in use; a variant that fails keeps its previous program
+    for (auto& entry : programs) {
+        GLuint rebuilt = buildProgram(entry.first);
+        if (rebuilt == 0) continue;
+        if (entry.second) glDeleteProgram(entry.second);
+        entry.second = rebuilt;
+    }
+    std::cout << "Shaders reloaded" << std::endl;
+    return true;
+}
+
+void ShaderManager::release() {
+    for (auto& entry : programs) {
+        if (entry.second) glDeleteProgram(entry.second);
+    }
+    programs.clear();
+}
@@ -4,6 +4,10 @@
 
 #include <GL/glew.h>      // Must be included before other OpenGL headers
 #include <GLFW/glfw3.h>   // GLFW should come after GLEW
+#include <string>
+#include <unordered_map>
+#include <filesystem>
+#include <chrono>
 
 // Vertex Shader source code
 extern const char* vertexShaderSource;
@@ -11,10 +15,72 @@ extern const char* vertexShaderSource;
 // Fragment Shader source code
 extern const char* fragmentShaderSource;
 
+// Line shaders for toolpaths and overlays (position + per-vertex colour)
+extern const char* lineVertexShaderSource;
+extern const char* lineFragmentShaderSource;
+
 // Function to compile a shader
 GLuint createShader(GLenum type, const char* source);
 
 // Function to create and link shader program
 GLuint createShaderProgram(const char* vertexSource, const char* fragmentSource);
 
+// Variant flags; each one becomes a #define in front of the shader source
+enum ShaderVariant : unsigned int {
+    SHADER_DEFAULT = 0,
+    SHADER_QUANTIZED = 1 << 0,  // Positions as normalized integers scaled by quantScale/quantOffset
+    SHADER_WIREFRAME = 1 << 1,  // Unlit object colour
+    SHADER_TOOLPATH = 1 << 2,   // Line sources with per-vertex colour instead of the mesh sources
+    SHADER_SECTION = 1 << 3     // Cut by the clipPlane uniform through gl_ClipDistance[0]
+};
+
+// Builds shader variants on first use and keeps the linked programs. Programs are also saved
+// with glGetProgramBinary, keyed by the driver strings and the final source text, so later
+// runs skip GLSL compilation. Sources in the source directory (mesh.vert, mesh.frag,
+// line.vert, line.frag) override the built-in ones and are reloaded when they change.
+class ShaderManager {
+public:
+    ~ShaderManager();
+
+    void init(const std::string& cacheDirectory, const std::string& sourceDirectory);
+
+    // Program for a combination of ShaderVariant flags; 0 if it failed to build. The id
+    // changes after a reload, so fetch it each frame rather than keeping it.
+    GLuint program(unsigned int variant);
+
+    // Rebuilds the programs in use when a source file was added, changed or removed.
+    // Polls at most twice a second; call once per frame.
+    bool reloadIfChanged();
+
+    void release();
+
+    int cacheHitCount() const { return cacheHits; }
+    int compiledCount() const { return compiled; }
+    bool isBinaryCacheSupported() const { return binaryCacheSupported; }
+
+    static std::string defines(unsigned int variant);
+
+private:
+    struct SourceFile {
+        std::string name;
+        const char* builtIn = "";
+        std::string text;
+        bool fromDisk = false;
+        std::filesystem::file_time_type stamp;
+    };
+
+    bool loadSource(SourceFile& source);
+    GLuint buildProgram(unsigned int variant);
+
+    SourceFile sources[4];
+    std::unordered_map<unsigned int, GLuint> programs;
+    std::string cacheDir;
+    std::string sourceDir;
+    unsigned long long driverHash = 0;
+    bool binaryCacheSupported = false;
+    int cacheHits = 0;
+    int compiled = 0;
+    std::chrono::steady_clock::time_point lastPoll;
+};
+
 #endif // SHADER_H
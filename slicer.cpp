@@ -0,0 +1,345 @@
+// slicer.cpp
+#include "slicer.h"
+#include "parallel.h"
+#include <algorithm>
+#include <unordered_map>
+#include <mutex>
+#include <limits>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+const size_t MAX_ADAPTIVE_BINS = size_t(1) << 18;
+
+// Height range of all meshes along the up axis
+bool meshHeightRange(const std::vector<Mesh>& meshes, float& bottom, float& top) {
+    bottom = std::numeric_limits<float>::max();
+    top = -std::numeric_limits<float>::max();
+    for (const Mesh& mesh : meshes) {
+        if (mesh.vertices.empty()) continue;
+        glm::vec3 min, max;
+        computeBoundingBox(mesh, min, max);
+        bottom = std::min(bottom, min.y);
+        top = std::max(top, max.y);
+    }
+    return bottom < top;
+}
+
+glm::vec3 meshVertex(const Mesh& mesh, unsigned int index) {
+    const float* v = &mesh.vertices[size_t(index) * 6];
+    return glm::vec3(v[0], v[1], v[2]);
+}
+
+// Index of the first vertex at the same position as each vertex. Vertices split along creases
+// or with per-face normals would otherwise leave the plane's crossings unconnected.
+std::vector<unsigned int> weldByPosition(const Mesh& mesh) {
+    size_t vertexCount = mesh.vertices.size() / 6;
+    std::vector<unsigned int> order(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) order[i] = static_cast<unsigned int>(i);
+    auto position = [&](unsigned int i) { return meshVertex(mesh, i); };
+    parallelSort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+        glm::vec3 pa = position(a), pb = position(b);
+        if (pa.x != pb.x) return pa.x < pb.x;
+        if (pa.y != pb.y) return pa.y < pb.y;
+        if (pa.z != pb.z) return pa.z < pb.z;
+        return a < b;
+    });
+
+    std::vector<unsigned int> weld(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        bool same = i > 0 && position(order[i]) == position(order[i - 1]);
+        weld[order[i]] = same ? weld[order[i - 1]] : order[i];
+    }
+    return weld;
+}
+
+struct Segment {
+    glm::vec2 start;
+    glm::vec2 end;
+    uint64_t startKey;      // Mesh edge the segment starts on (welded vertex indices)
+    uint64_t endKey;
+};
+
+// Point where the plane crosses the edge (a, b). The point is computed from the ordered
+// edge so both triangles sharing the edge produce bit-identical results.
+glm::vec2 edgeCrossing(const Mesh& mesh, unsigned int a, unsigned int b, float height, uint64_t& key) {
+    if (a > b) std::swap(a, b);
+    key = (uint64_t(a) << 32) | b;
+    glm::vec3 pa = meshVertex(mesh, a);
+    glm::vec3 pb = meshVertex(mesh, b);
+    float t = (height - pa.y) / (pb.y - pa.y);
+    return glm::vec2(pa.x + t * (pb.x - pa.x), pa.z + t * (pb.z - pa.z));
+}
+
+// Segment of a triangle at the plane, oriented so the solid is on its left. Vertices on the
+// plane count as above it, which slices just below the plane and keeps flat faces exact.
+bool triangleSegment(const Mesh& mesh, const std::vector<unsigned int>& weld, size_t triangle, float height, Segment& segment) {
+    unsigned int idx[3] = { weld[mesh.indices[triangle * 3]], weld[mesh.indices[triangle * 3 + 1]], weld[mesh.indices[triangle * 3 + 2]] };
+    glm::vec3 p[3] = { meshVertex(mesh, idx[0]), meshVertex(mesh, idx[1]), meshVertex(mesh, idx[2]) };
+    bool above[3] = { p[0].y >= height, p[1].y >= height, p[2].y >= height };
+    int aboveCount = above[0] + above[1] + above[2];
+    if (aboveCount == 0 || aboveCount == 3) return false;
+
+    glm::vec2 points[2];
+    uint64_t keys[2];
+    int found = 0;
+    for (int e = 0; e < 3; e++) {
+        int i = e, j = (e + 1) % 3;
+        if (above[i] != above[j]) {
+            points[found] = edgeCrossing(mesh, idx[i], idx[j], height, keys[found]);
+            found++;
+        }
+    }
+
+    glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+    glm::vec2 direction = points[1] - points[0];
+    glm::vec2 right(direction.y, -direction.x);
+    if (glm::dot(right, glm::vec2(normal.x, normal.z)) < 0.0f) {
+        std::swap(points[0], points[1]);
+        std::swap(keys[0], keys[1]);
+    }
+
+    segment.start = points[0];
+    segment.end = points[1];
+    segment.startKey = keys[0];
+    segment.endKey = keys[1];
+    return true;
+}
+
+// Join segments that share mesh edges into polylines. Chains without a predecessor are
+// open (holes in the mesh); everything left afterwards forms closed loops.
+void chainSegments(const std::vector<Segment>& segments, std::vector<Contour>& contours) {
+    std::unordered_map<uint64_t, unsigned int> byStart;
+    std::unordered_map<uint64_t, unsigned int> byEnd;
+    byStart.reserve(segments.size());
+    byEnd.reserve(segments.size());
+    for (unsigned int i = 0; i < segments.size(); i++) {
+        byStart[segments[i].startKey] = i;
+        byEnd[segments[i].endKey] = i;
+    }
+
+    std::vector<char> used(segments.size(), 0);
+    auto follow = [&](unsigned int first, bool closed) {
+        Contour contour;
+        contour.closed = closed;
+        contour.points.push_back(segments[first].start);
+        unsigned int current = first;
+        while (true) {
+            used[current] = 1;
+            auto next = byStart.find(segments[current].endKey);
+            if (next == byStart.end() || used[next->second]) {
+                if (!closed) contour.points.push_back(segments[current].end);
+                break;
+            }
+            contour.points.push_back(segments[next->second].start);
+            current = next->second;
+        }
+        if (contour.points.size() >= (closed ? 3u : 2u)) {
+            contours.push_back(std::move(contour));
+        }
+    };
+
+    for (unsigned int i = 0; i < segments.size(); i++) {
+        if (!used[i] && byEnd.find(segments[i].startKey) == byEnd.end()) follow(i, false);
+    }
+    for (unsigned int i = 0; i < segments.size(); i++) {
+        if (!used[i]) follow(i, true);
+    }
+}
+
+} // namespace
+
+std::vector<float> uniformLayerHeights(float bottom, float top, float layerHeight) {
+    std::vector<float> heights;
+    if (layerHeight <= 0.0f || top <= bottom) return heights;
+
+    size_t count = static_cast<size_t>(std::ceil((top - bottom) / layerHeight - 1e-4f));
+    for (size_t i = 1; i <= count; i++) {
+        heights.push_back(std::min(top, bottom + layerHeight * i));
+    }
+    return heights;
+}
+
+std::vector<float> adaptiveLayerHeights(const std::vector<Mesh>& meshes, const SliceSettings& settings) {
+    std::vector<float> heights;
+    float bottom, top;
+    if (!meshHeightRange(meshes, bottom, top)) return heights;
+
+    float minHeight = std::max(settings.minLayerHeight, 1e-4f);
+    float maxHeight = std::max(settings.maxLayerHeight, minHeight);
+    float tolerance = std::max(settings.cuspTolerance, 0.0f);
+
+    // Largest allowed step per height bin: the tightest limit of all facets overlapping it
+    float binSize = std::max(minHeight * 0.25f, (top - bottom) / MAX_ADAPTIVE_BINS);
+    size_t binCount = static_cast<size_t>(std::ceil((top - bottom) / binSize)) + 1;
+    std::vector<float> limits(binCount, maxHeight);
+    std::vector<float> flats;
+    std::mutex mergeMutex;
+
+    for (const Mesh& mesh : meshes) {
+        if (mesh.vertices.empty()) continue;
+        size_t triangleCount = mesh.indices.size() / 3;
+
+        parallelFor(triangleCount, [&](size_t begin, size_t end) {
+            std::vector<float> localLimits(binCount, maxHeight);
+            std::vector<float> localFlats;
+            for (size_t t = begin; t < end; t++) {
+                glm::vec3 a = meshVertex(mesh, mesh.indices[t * 3]);
+                glm::vec3 b = meshVertex(mesh, mesh.indices[t * 3 + 1]);
+                glm::vec3 c = meshVertex(mesh, mesh.indices[t * 3 + 2]);
+                glm::vec3 n = glm::cross(b - a, c - a);
+                float length = glm::length(n);
+                if (length <= 0.0f) continue;
+
+                float slope = std::fabs(n.y) / length;   // |cos| of the angle to the up axis
+                if (slope > 0.9999f) {
+                    localFlats.push_back(a.y);           // Floors and ceilings get their own plane
+                    continue;
+                }
+                // Cusp height of a step h on this facet is h * slope
+                float limit = slope > 0.0f ? glm::clamp(tolerance / slope, minHeight, maxHeight) : maxHeight;
+                if (limit >= maxHeight) continue;
+
+                float yMin = std::min(a.y, std::min(b.y, c.y));
+                float yMax = std::max(a.y, std::max(b.y, c.y));
+                size_t first = static_cast<size_t>((yMin - bottom) / binSize);
+                size_t last = std::min(binCount - 1, static_cast<size_t>((yMax - bottom) / binSize));
+                for (size_t bin = first; bin <= last; bin++) {
+                    localLimits[bin] = std::min(localLimits[bin], limit);
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mergeMutex);
+            for (size_t bin = 0; bin < binCount; bin++) {
+                limits[bin] = std::min(limits[bin], localLimits[bin]);
+            }
+            flats.insert(flats.end(), localFlats.begin(), localFlats.end());
+        }, 16384);
+    }
+
+    std::sort(flats.begin(), flats.end());
+    flats.erase(std::unique(flats.begin(), flats.end(), [&](float x, float y) { return y - x < minHeight * 0.01f; }), flats.end());
+
+    auto minLimit = [&](float from, float to) {
+        size_t first = static_cast<size_t>(std::max(0.0f, (from - bottom) / binSize));
+        size_t last = std::min(binCount - 1, static_cast<size_t>((to - bottom) / binSize));
+        float result = maxHeight;
+        for (size_t bin = first; bin <= last; bin++) result = std::min(result, limits[bin]);
+        return result;
+    };
+
+    float z = bottom;
+    size_t nextFlat = 0;
+    while (z < top - minHeight * 0.01f) {
+        // Shrink the step until every facet in the layer accepts it
+        float h = maxHeight;
+        while (true) {
+            float limit = minLimit(z, z + h);
+            if (limit >= h) break;
+            h = std::max(limit, minHeight);
+            if (h <= minHeight) break;
+        }
+
+        // Land exactly on flat faces inside the step
+        while (nextFlat < flats.size() && flats[nextFlat] <= z + minHeight * 0.01f) nextFlat++;
+        if (nextFlat < flats.size() && flats[nextFlat] < z + h && flats[nextFlat] - z >= minHeight) {
+            h = flats[nextFlat] - z;
+        }
+
+        z = std::min(top, z + h);
+        heights.push_back(z);
+    }
+    return heights;
+}
+
+std::vector<float> layerHeights(const std::vector<Mesh>& meshes, const SliceSettings& settings) {
+    if (settings.adaptive) {
+        return adaptiveLayerHeights(meshes, settings);
+    }
+    float bottom, top;
+    if (!meshHeightRange(meshes, bottom, top)) return std::vector<float>();
+    return uniformLayerHeights(bottom, top, settings.layerHeight);
+}
+
+std::vector<Layer> sliceMeshes(const std::vector<Mesh>& meshes, const std::vector<float>& heights) {
+    std::vector<Layer> layers(heights.size());
+    if (heights.empty()) return layers;
+
+    float bottom, top;
+    if (!meshHeightRange(meshes, bottom, top)) bottom = heights.front();
+    for (size_t i = 0; i < heights.size(); i++) {
+        layers[i].height = heights[i];
+        layers[i].thickness = heights[i] - (i > 0 ? heights[i - 1] : bottom);
+    }
+
+    // Per mesh, the triangles crossing each plane (a triangle crosses plane h when
+    // yMin < h <= yMax), stored as one list per layer
+    struct LayerTriangles {
+        std::vector<unsigned int> start;
+        std::vector<unsigned int> triangles;
+        std::vector<unsigned int> weld;
+    };
+    std::vector<LayerTriangles> perMesh(meshes.size());
+
+    for (size_t m = 0; m < meshes.size(); m++) {
+        const Mesh& mesh = meshes[m];
+        if (mesh.vertices.empty()) continue;
+        size_t triangleCount = mesh.indices.size() / 3;
+
+        std::vector<unsigned int> firstLayer(triangleCount), endLayer(triangleCount);
+        parallelFor(triangleCount, [&](size_t begin, size_t end) {
+            for (size_t t = begin; t < end; t++) {
+                float y0 = mesh.vertices[size_t(mesh.indices[t * 3]) * 6 + 1];
+                float y1 = mesh.vertices[size_t(mesh.indices[t * 3 + 1]) * 6 + 1];
+                float y2 = mesh.vertices[size_t(mesh.indices[t * 3 + 2]) * 6 + 1];
+                float yMin = std::min(y0, std::min(y1, y2));
+                float yMax = std::max(y0, std::max(y1, y2));
+                firstLayer[t] = static_cast<unsigned int>(std::upper_bound(heights.begin(), heights.end(), yMin) - heights.begin());
+                endLayer[t] = static_cast<unsigned int>(std::upper_bound(heights.begin(), heights.end(), yMax) - heights.begin());
+            }
+        });
+
+        LayerTriangles& lists = perMesh[m];
+        lists.weld = weldByPosition(mesh);
+        lists.start.assign(heights.size() + 1, 0);
+        for (size_t t = 0; t < triangleCount; t++) {
+            for (unsigned int l = firstLayer[t]; l < endLayer[t]; l++) lists.start[l]++;
+        }
+        exclusiveScan(lists.start);
+        lists.triangles.resize(lists.start.back());
+        std::vector<unsigned int> fill(lists.start.begin(), lists.start.end() - 1);
+        for (size_t t = 0; t < triangleCount; t++) {
+            for (unsigned int l = firstLayer[t]; l < endLayer[t]; l++) {
+                lists.triangles[fill[l]++] = static_cast<unsigned int>(t);
+            }
+        }
+    }
+
+    parallelFor(layers.size(), [&](size_t begin, size_t end) {
+        std::vector<Segment> segments;
+        for (size_t l = begin; l < end; l++) {
+            for (size_t m = 0; m < meshes.size(); m++) {
+                const LayerTriangles& lists = perMesh[m];
+                if (lists.start.empty()) continue;
+
+                segments.clear();
+                for (unsigned int i = lists.start[l]; i < lists.start[l + 1]; i++) {
+                    Segment segment;
+                    if (triangleSegment(meshes[m], lists.weld, lists.triangles[i], heights[l], segment)) {
+                        segments.push_back(segment);
+                    }
+                }
+                chainSegments(segments, layers[l].contours);
+            }
+        }
+    }, 1);
+
+    return layers;
+}
+
+Layer sliceMeshesAt(const std::vector<Mesh>& meshes, float height) {
+    std::vector<Layer> layers = sliceMeshes(meshes, std::vector<float>(1, height));
+    layers[0].thickness = 0.0f;
+    return layers[0];
+}
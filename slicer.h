@@ -0,0 +1,50 @@
+// slicer.h
+#ifndef SLICER_H
+#define SLICER_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include "model.h"
+
+// Layers are cut perpendicular to the viewer's up axis (world Y, the machine Z axis once the
+// model sits on the grid). Contour points are (x, z) in mesh coordinates.
+
+// Polyline in the layer plane. Closed outer boundaries run counter-clockwise and holes
+// clockwise, so the material is always on the left.
+struct Contour {
+    std::vector<glm::vec2> points;
+    bool closed = false;
+};
+
+struct Layer {
+    float height = 0.0f;        // Position of the cutting plane
+    float thickness = 0.0f;     // Distance to the plane below (or to the model bottom)
+    std::vector<Contour> contours;
+};
+
+struct SliceSettings {
+    float layerHeight = 1.0f;       // Uniform step
+    bool adaptive = false;
+    float minLayerHeight = 0.1f;    // Bounds for adaptive steps
+    float maxLayerHeight = 2.0f;
+    float cuspTolerance = 0.05f;    // Largest scallop (cusp) height left on sloped walls
+};
+
+// Evenly spaced plane heights from bottom (exclusive) to top (inclusive)
+std::vector<float> uniformLayerHeights(float bottom, float top, float layerHeight);
+
+// Variable plane heights from the slope of the mesh faces: vertical walls get the largest
+// steps, shallow slopes smaller ones so that the cusp height stays within tolerance, and
+// flat floors get a plane of their own.
+std::vector<float> adaptiveLayerHeights(const std::vector<Mesh>& meshes, const SliceSettings& settings);
+
+// Plane heights for the settings (uniform or adaptive)
+std::vector<float> layerHeights(const std::vector<Mesh>& meshes, const SliceSettings& settings);
+
+// Cut every mesh at the given plane heights (ascending); layers are computed in parallel
+std::vector<Layer> sliceMeshes(const std::vector<Mesh>& meshes, const std::vector<float>& heights);
+
+// Contours of a single plane
+Layer sliceMeshesAt(const std::vector<Mesh>& meshes, float height);
+
+#endif // SLICER_H
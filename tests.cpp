@@ -0,0 +1,73 @@
+// tests.cpp
+// Entry point of the test target, which runs without a window or display server:
+//   tests [scenes.txt] [--record]
+// runs the toolpath checks and then the render regression scenes (see benchmark.h). The
+// exit code is the benchmark's, or 1 when a check failed.
+#include <iostream>
+#include <string>
+#include "benchmark.h"
+#include "camera.h"
+#include "toolpath.h"
+
+// callbacks.cpp steers the viewer's camera; the benchmark places its own
+Camera camera(glm::vec3(5.0f, 5.0f, 5.0f), glm::vec3(0.0f, 0.0f, 0.0f));
+
+namespace {
+
+bool check(bool condition, const char* name) {
+    std::cout << (condition ? "PASS " : "FAIL ") << name << std::endl;
+    return condition;
+}
+
+// Twice the signed area enclosed by the cutting moves in machine XY; negative is clockwise
+// seen from above
+double machineArea(const Toolpath& toolpath) {
+    double area = 0.0;
+    glm::vec3 previous = toMachine(toolpath.start);
+    for (const ToolpathMove& move : toolpath.moves) {
+        glm::vec3 next = toMachine(move.target);
+        if (move.type != MoveType::Rapid) area += double(previous.x) * next.y - double(next.x) * previous.y;
+        previous = next;
+    }
+    return area;
+}
+
+// A 10 mm square block, as the slicer would cut it at one height
+Layer squareLayer() {
+    Layer layer;
+    layer.height = 0.0f;
+    layer.thickness = 1.0f;
+    Contour square;
+    square.points = { glm::vec2(0.0f, 0.0f), glm::vec2(10.0f, 0.0f), glm::vec2(10.0f, 10.0f), glm::vec2(0.0f, 10.0f) };
+    square.closed = true;
+    layer.contours.push_back(square);
+    return layer;
+}
+
+// With M3, climb milling keeps the material on the tool's right: clockwise around outer walls
+int checkProfileDirection() {
+    int failures = 0;
+    ProfileSettings settings;
+    settings.climb = true;
+    std::vector<Toolpath> climb = generateLayerProfile(squareLayer(), 5.0f, settings);
+    if (!check(climb.size() == 1 && machineArea(climb[0]) < 0.0, "climb profile runs clockwise around a square")) failures++;
+    settings.climb = false;
+    std::vector<Toolpath> conventional = generateLayerProfile(squareLayer(), 5.0f, settings);
+    if (!check(conventional.size() == 1 && machineArea(conventional[0]) > 0.0, "conventional profile runs counter-clockwise")) failures++;
+    return failures;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string scenePath = "bench/scenes.txt";
+    bool record = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--record") record = true;
+        else scenePath = argv[i];
+    }
+
+    int failures = checkProfileDirection();
+    int result = runBenchmark(scenePath, record);
+    return failures > 0 && result == 0 ? 1 : result;
+}
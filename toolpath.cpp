@@ -0,0 +1,285 @@
+// toolpath.cpp
+#include "toolpath.h"
+#include "parallel.h"
+#include "compacttoolpath.h"
+#include "frustum.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/constants.hpp>
+
+ClipperLib::IntPoint toClipperPoint(const glm::vec2& point) {
+    return ClipperLib::IntPoint(static_cast<ClipperLib::cInt>(std::llround(point.x * CLIPPER_SCALE)),
+        static_cast<ClipperLib::cInt>(std::llround(point.y * CLIPPER_SCALE)));
+}
+
+glm::vec2 fromClipperPoint(const ClipperLib::IntPoint& point) {
+    return glm::vec2(static_cast<float>(point.X / CLIPPER_SCALE), static_cast<float>(point.Y / CLIPPER_SCALE));
+}
+
+ClipperLib::Path toClipperPath(const std::vector<glm::vec2>& points) {
+    ClipperLib::Path path;
+    path.reserve(points.size());
+    for (const glm::vec2& p : points) {
+        path.push_back(toClipperPoint(p));
+    }
+    return path;
+}
+
+ClipperLib::Paths contoursToClipperPaths(const std::vector<Contour>& contours) {
+    ClipperLib::Paths paths;
+    paths.reserve(contours.size());
+    for (const Contour& contour : contours) {
+        if (!contour.closed || contour.points.size() < 3) continue;
+        paths.push_back(toClipperPath(contour.points));
+    }
+    return paths;
+}
+
+namespace {
+
+// One closed loop at a fixed height: rapid above the first point, plunge, cut around, retract
+Toolpath loopToolpath(const ClipperLib::Path& loop, float height, float safeHeight, const ProfileSettings& settings) {
+    Toolpath toolpath;
+    glm::vec2 first = fromClipperPoint(loop.front());
+    toolpath.start = glm::vec3(first.x, safeHeight, first.y);
+    toolpath.moves.reserve(loop.size() + 3);
+
+    toolpath.moves.push_back({ MoveType::Linear, glm::vec3(first.x, height, first.y), settings.plungeFeedrate });
+    for (size_t i = 1; i <= loop.size(); i++) {
+        glm::vec2 p = fromClipperPoint(loop[i % loop.size()]);
+        toolpath.moves.push_back({ MoveType::Linear, glm::vec3(p.x, height, p.y), settings.feedrate });
+    }
+    toolpath.moves.push_back({ MoveType::Rapid, glm::vec3(first.x, safeHeight, first.y), 0.0f });
+    return toolpath;
+}
+
+} // namespace
+
+float profileSafeHeight(const std::vector<Layer>& layers, const ProfileSettings& settings) {
+    if (layers.empty()) return settings.clearance;
+    float top = layers.front().height;
+    for (const Layer& layer : layers) top = std::max(top, layer.height);
+    return top + settings.clearance;
+}
+
+std::vector<Toolpath> generateLayerProfile(const Layer& layer, float safeHeight, const ProfileSettings& settings) {
+    // Merge overlapping parts first so the offset never gouges a neighbour
+    ClipperLib::Clipper clipper;
+    clipper.AddPaths(contoursToClipperPaths(layer.contours), ClipperLib::ptSubject, true);
+    ClipperLib::Paths regions;
+    clipper.Execute(ClipperLib::ctUnion, regions, ClipperLib::pftNonZero, ClipperLib::pftNonZero);
+
+    ClipperLib::ClipperOffset offset;
+    offset.ArcTolerance = 0.005 * CLIPPER_SCALE;
+    offset.AddPaths(regions, ClipperLib::jtRound, ClipperLib::etClosedPolygon);
+    ClipperLib::Paths loops;
+    offset.Execute(loops, settings.toolRadius * CLIPPER_SCALE);
+
+    std::vector<Toolpath> toolpaths;
+    for (ClipperLib::Path& loop : loops) {
+        if (loop.size() < 3) continue;
+        // Offsets keep the union's orientation: outers positive in (x, z), holes negative.
+        // toMachine mirrors z, so outers run clockwise in machine XY with the material on
+        // the tool's right, which is climb milling with M3. Conventional milling reverses them.
+        if (!settings.climb) std::reverse(loop.begin(), loop.end());
+        toolpaths.push_back(loopToolpath(loop, layer.height, safeHeight, settings));
+    }
+    return toolpaths;
+}
+
+std::vector<Toolpath> generateProfileToolpaths(const std::vector<Layer>& layers, const ProfileSettings& settings) {
+    if (layers.empty()) return {};
+
+    float safeHeight = profileSafeHeight(layers, settings);
+
+    // Layers come from the slicer bottom-up; cut them top-down
+    std::vector<std::vector<Toolpath>> perLayer(layers.size());
+    parallelFor(layers.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            perLayer[i] = generateLayerProfile(layers[layers.size() - 1 - i], safeHeight, settings);
+        }
+    }, 1);
+
+    std::vector<Toolpath> toolpaths;
+    for (std::vector<Toolpath>& layerPaths : perLayer) {
+        for (Toolpath& toolpath : layerPaths) toolpaths.push_back(std::move(toolpath));
+    }
+    return toolpaths;
+}
+
+float arcSweep(const glm::vec3& from, const ToolpathMove& move) {
+    glm::vec3 start = toMachine(from) - toMachine(move.center);
+    glm::vec3 end = toMachine(move.target) - toMachine(move.center);
+    float turn = std::atan2(end.y, end.x) - std::atan2(start.y, start.x);
+    const float fullTurn = 2.0f * glm::pi<float>();
+
+    // Counter-clockwise sweeps lie in (0, 2pi], clockwise ones in [-2pi, 0)
+    if (move.type == MoveType::ArcCCW) {
+        while (turn <= 1e-6f) turn += fullTurn;
+        while (turn > fullTurn + 1e-6f) turn -= fullTurn;
+    }
+    else {
+        while (turn >= -1e-6f) turn -= fullTurn;
+        while (turn < -fullTurn - 1e-6f) turn += fullTurn;
+    }
+    return turn;
+}
+
+void interpolateArc(const glm::vec3& from, const ToolpathMove& move, float tolerance, std::vector<glm::vec3>& points) {
+    glm::vec3 center = toMachine(move.center);
+    glm::vec3 start = toMachine(from);
+    glm::vec3 end = toMachine(move.target);
+    float radius = glm::length(glm::vec2(start - center));
+    float sweep = arcSweep(from, move);
+
+    // Chord error r(1 - cos(step / 2)) within the tolerance
+    float step = radius > tolerance ? 2.0f * std::acos(1.0f - tolerance / radius) : glm::pi<float>() / 4.0f;
+    int count = std::clamp(static_cast<int>(std::ceil(std::fabs(sweep) / std::max(step, 1e-3f))), 1, 4096);
+
+    float startAngle = std::atan2(start.y - center.y, start.x - center.x);
+    for (int i = 1; i < count; i++) {
+        float t = float(i) / count;
+        float angle = startAngle + sweep * t;
+        glm::vec3 p(center.x + radius * std::cos(angle), center.y + radius * std::sin(angle), start.z + (end.z - start.z) * t);
+        points.push_back(fromMachine(p));
+    }
+    points.push_back(move.target);
+}
+
+size_t countMoves(const std::vector<Toolpath>& toolpaths) {
+    size_t count = 0;
+    for (const Toolpath& toolpath : toolpaths) count += toolpath.moves.size();
+    return count;
+}
+
+namespace {
+
+// Two vertices (position + colour) per line, drawn as GL_LINES; arcs are drawn as chords
+void appendMoveLines(std::vector<float>& vertices, std::vector<glm::vec3>& arcPoints, glm::vec3 from, const ToolpathMove& move,
+    bool highlighted) {
+    const glm::vec3 rapidColor(0.9f, 0.8f, 0.2f);
+    const glm::vec3 cutColor(0.2f, 0.7f, 1.0f);
+    const glm::vec3 highlightColor(1.0f, 0.15f, 0.15f);
+    glm::vec3 color = highlighted ? highlightColor : move.type == MoveType::Rapid ? rapidColor : cutColor;
+
+    arcPoints.clear();
+    if (isArc(move.type)) interpolateArc(from, move, 0.01f, arcPoints);
+    else arcPoints.push_back(move.target);
+    for (const glm::vec3& to : arcPoints) {
+        for (const glm::vec3& p : { from, to }) {
+            vertices.insert(vertices.end(), { p.x, p.y, p.z, color.r, color.g, color.b });
+        }
+        from = to;
+    }
+}
+
+} // namespace
+
+ToolpathPreview::~ToolpathPreview() {
+    release();
+}
+
+void ToolpathPreview::build(const std::vector<Toolpath>& toolpaths, const std::vector<char>* highlighted) {
+    std::vector<float> vertices;
+    vertices.reserve(countMoves(toolpaths) * 12);
+    std::vector<glm::vec3> arcPoints;
+    size_t moveIndex = 0;
+    for (const Toolpath& toolpath : toolpaths) {
+        glm::vec3 from = toolpath.start;
+        for (const ToolpathMove& move : toolpath.moves) {
+            bool marked = highlighted && moveIndex < highlighted->size() && (*highlighted)[moveIndex];
+            appendMoveLines(vertices, arcPoints, from, move, marked);
+            from = move.target;
+            moveIndex++;
+        }
+    }
+
+    ranges.clear();
+    upload(vertices);
+}
+
+void ToolpathPreview::build(const CompactToolpath& toolpath, const std::vector<char>* highlighted) {
+    // One vertex range per chunk, so that render() can skip chunks outside the view
+    std::vector<float> vertices;
+    vertices.reserve(toolpath.moveCount() * 12);
+    std::vector<glm::vec3> arcPoints;
+    std::vector<ToolpathMove> moves;
+    std::vector<glm::vec3> from;
+    ranges.clear();
+    for (size_t c = 0; c < toolpath.chunkCount(); c++) {
+        const CompactToolpathChunk& chunk = toolpath.chunk(c);
+        toolpath.decodeChunk(c, moves, from);
+
+        ChunkRange range;
+        range.first = static_cast<GLint>(vertices.size() / 6);
+        for (size_t i = 0; i < moves.size(); i++) {
+            size_t moveIndex = static_cast<size_t>(chunk.firstMove) + i;
+            bool marked = highlighted && moveIndex < highlighted->size() && (*highlighted)[moveIndex];
+            appendMoveLines(vertices, arcPoints, from[i], moves[i], marked);
+        }
+        range.count = static_cast<GLsizei>(vertices.size() / 6) - range.first;
+        range.boundsMin = glm::vec3(chunk.boundsMin[0], chunk.boundsMin[1], chunk.boundsMin[2]);
+        range.boundsMax = glm::vec3(chunk.boundsMax[0], chunk.boundsMax[1], chunk.boundsMax[2]);
+        ranges.push_back(range);
+    }
+    upload(vertices);
+}
+
+void ToolpathPreview::upload(const std::vector<float>& vertices) {
+    if (VAO == 0) {
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    vertexCount = static_cast<GLsizei>(vertices.size() / 6);
+}
+
+void ToolpathPreview::render(GLuint lineProgram, const glm::mat4& view, const glm::mat4& projection) const {
+    if (vertexCount == 0) return;
+
+    glUseProgram(lineProgram);
+    glm::mat4 model(1.0f);
+    glUniformMatrix4fv(glGetUniformLocation(lineProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+    glUniformMatrix4fv(glGetUniformLocation(lineProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(glGetUniformLocation(lineProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+
+    glBindVertexArray(VAO);
+    if (ranges.empty()) {
+        glDrawArrays(GL_LINES, 0, vertexCount);
+    }
+    else {
+        glm::vec4 planes[6];
+        extractFrustumPlanes(projection * view, planes);
+
+        visibleFirst.clear();
+        visibleCount.clear();
+        for (const ChunkRange& range : ranges) {
+            if (range.count == 0 || !boxInFrustum(planes, range.boundsMin, range.boundsMax)) continue;
+            visibleFirst.push_back(range.first);
+            visibleCount.push_back(range.count);
+        }
+        if (!visibleFirst.empty()) {
+            glMultiDrawArrays(GL_LINES, visibleFirst.data(), visibleCount.data(), static_cast<GLsizei>(visibleFirst.size()));
+        }
+    }
+    glBindVertexArray(0);
+}
+
+void ToolpathPreview::release() {
+    if (VBO) glDeleteBuffers(1, &VBO);
+    if (VAO) glDeleteVertexArrays(1, &VAO);
+    VAO = 0;
+    VBO = 0;
+    vertexCount = 0;
+    ranges.clear();
+}
@@ -0,0 +1,120 @@
+// toolpath.h
+#ifndef TOOLPATH_H
+#define TOOLPATH_H
+
+#include <vector>
+#include <glm/glm.hpp>
+#include <GL/glew.h>      // Must be included before other OpenGL headers
+#include <GLFW/glfw3.h>   // GLFW should come after GLEW
+#include <polyclipping/clipper.hpp>
+#include "slicer.h"
+
+// Toolpaths are stored in mesh coordinates (Y up, as in the viewer). toMachine converts a
+// point or direction to machine axes (X right, Y away from the operator, Z up).
+
+enum class MoveType {
+    Rapid,      // G0
+    Linear,     // G1
+    ArcCW,      // G2
+    ArcCCW      // G3
+};
+
+struct ToolpathMove {
+    MoveType type = MoveType::Linear;
+    glm::vec3 target = glm::vec3(0.0f);   // End point of the move
+    float feedrate = 0.0f;                // Units per minute; rapids use the machine rapid rate
+    glm::vec3 center = glm::vec3(0.0f);   // Arc centre (arcs only)
+};
+
+struct Toolpath {
+    glm::vec3 start = glm::vec3(0.0f);    // Tool position before the first move
+    std::vector<ToolpathMove> moves;
+};
+
+inline glm::vec3 toMachine(const glm::vec3& p) {
+    return glm::vec3(p.x, -p.z, p.y);
+}
+
+inline glm::vec3 fromMachine(const glm::vec3& p) {
+    return glm::vec3(p.x, p.z, -p.y);
+}
+
+inline bool isArc(MoveType type) {
+    return type == MoveType::ArcCW || type == MoveType::ArcCCW;
+}
+
+// Arcs turn about the machine Z axis (G17 plane); a change in height makes them helical.
+// Clockwise and counter-clockwise are as seen from above. Returns the signed sweep in
+// radians (positive counter-clockwise); an arc that ends where it starts is a full circle.
+float arcSweep(const glm::vec3& from, const ToolpathMove& move);
+
+// Appends points along an arc move (excluding from, including the target) so that the chords
+// stay within the tolerance of the arc
+void interpolateArc(const glm::vec3& from, const ToolpathMove& move, float tolerance, std::vector<glm::vec3>& points);
+
+// Clipper works on integers; contour coordinates are scaled by this factor
+const double CLIPPER_SCALE = 1000.0;
+
+ClipperLib::IntPoint toClipperPoint(const glm::vec2& point);
+glm::vec2 fromClipperPoint(const ClipperLib::IntPoint& point);
+ClipperLib::Path toClipperPath(const std::vector<glm::vec2>& points);
+
+// Closed contours of a layer as Clipper paths (open contours are skipped)
+ClipperLib::Paths contoursToClipperPaths(const std::vector<Contour>& contours);
+
+struct ProfileSettings {
+    float toolRadius = 3.0f;
+    float feedrate = 1000.0f;         // Units per minute
+    float plungeFeedrate = 300.0f;
+    float clearance = 5.0f;           // Rapid height above the highest layer
+    bool climb = true;                // Climb milling (tool travels clockwise around outer walls)
+};
+
+// Profile toolpaths around the contours of every layer, offset by the tool radius, cut from
+// the top layer down. Layers are processed in parallel.
+std::vector<Toolpath> generateProfileToolpaths(const std::vector<Layer>& layers, const ProfileSettings& settings);
+
+// Rapid height used by generateProfileToolpaths: clearance above the highest layer
+float profileSafeHeight(const std::vector<Layer>& layers, const ProfileSettings& settings);
+
+// Profile toolpaths of a single layer
+std::vector<Toolpath> generateLayerProfile(const Layer& layer, float safeHeight, const ProfileSettings& settings);
+
+// Total number of moves in a set of toolpaths
+size_t countMoves(const std::vector<Toolpath>& toolpaths);
+
+class CompactToolpath;
+
+// Line rendering of toolpaths: rapids and cutting moves in different colours, with an
+// optional per-move highlight (one flag per move, in toolpath order). A compact toolpath is
+// decoded chunk by chunk and its chunk bounds are used to skip chunks outside the view.
+class ToolpathPreview {
+public:
+    ~ToolpathPreview();
+
+    void build(const std::vector<Toolpath>& toolpaths, const std::vector<char>* highlighted = nullptr);
+    void build(const CompactToolpath& toolpath, const std::vector<char>* highlighted = nullptr);
+    void render(GLuint lineProgram, const glm::mat4& view, const glm::mat4& projection) const;
+    void release();
+
+    bool isEmpty() const { return vertexCount == 0; }
+
+private:
+    struct ChunkRange {
+        GLint first = 0;
+        GLsizei count = 0;
+        glm::vec3 boundsMin;
+        glm::vec3 boundsMax;
+    };
+
+    void upload(const std::vector<float>& vertices);
+
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+    GLsizei vertexCount = 0;
+    std::vector<ChunkRange> ranges;
+    mutable std::vector<GLint> visibleFirst;
+    mutable std::vector<GLsizei> visibleCount;
+};
+
+#endif // TOOLPATH_H
@@ -0,0 +1,612 @@
+// workerfarm.cpp
+#include "workerfarm.h"
+#include "parallel.h"
+#include <chrono>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <csignal>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const unsigned int UNIT_MAGIC = 0x55575054;    // "TPWU"
+const unsigned int RESULT_MAGIC = 0x52575054;  // "TPWR"
+const unsigned long long MAX_MESSAGE = 1ull << 34;
+
+// Work units and results are flat little-endian records; both ends are the same executable
+class WireWriter {
+public:
+    template <typename T>
+    void put(const T& value) {
+        const char* bytes = reinterpret_cast<const char*>(&value);
+        buffer.append(bytes, sizeof(T));
+    }
+    void putVec2(const glm::vec2& v) { put(v.x); put(v.y); }
+    void putVec3(const glm::vec3& v) { put(v.x); put(v.y); put(v.z); }
+
+    std::string buffer;
+};
+
+class WireReader {
+public:
+    explicit WireReader(const std::string& buffer) : data(buffer.data()), remaining(buffer.size()) {}
+
+    template <typename T>
+    bool get(T& value) {
+        if (remaining < sizeof(T)) return false;
+        std::memcpy(&value, data, sizeof(T));
+        data += sizeof(T);
+        remaining -= sizeof(T);
+        return true;
+    }
+    bool getVec2(glm::vec2& v) { return get(v.x) && get(v.y); }
+    bool getVec3(glm::vec3& v) { return get(v.x) && get(v.y) && get(v.z); }
+    bool atEnd() const { return remaining == 0; }
+
+private:
+    const char* data;
+    size_t remaining;
+};
+
+// Layers [first, last) of the job. The clearance is rebased on the unit's top layer so the
+// safe height matches the one the whole job would use.
+std::string serializeUnit(const FarmJob& job, size_t first, size_t last) {
+    float jobTop = job.layers.front().height;
+    float unitTop = job.layers[first].height;
+    for (const Layer& layer : job.layers) jobTop = std::max(jobTop, layer.height);
+    for (size_t i = first; i < last; i++) unitTop = std::max(unitTop, job.layers[i].height);
+
+    WireWriter out;
+    out.put(UNIT_MAGIC);
+    out.put(job.profile.toolRadius);
+    out.put(job.profile.feedrate);
+    out.put(job.profile.plungeFeedrate);
+    out.put(jobTop + job.profile.clearance - unitTop);
+    out.put<unsigned char>(job.profile.climb);
+    out.put<unsigned char>(job.fitArcs);
+    out.put(job.arcFit.tolerance);
+    out.put(job.arcFit.minSegments);
+    out.put(job.arcFit.minRadius);
+    out.put(job.arcFit.maxRadius);
+    out.put<unsigned int>(static_cast<unsigned int>(last - first));
+    for (size_t i = first; i < last; i++) {
+        const Layer& layer = job.layers[i];
+        out.put(layer.height);
+        out.put(layer.thickness);
+        out.put<unsigned int>(static_cast<unsigned int>(layer.contours.size()));
+        for (const Contour& contour : layer.contours) {
+            out.put<unsigned char>(contour.closed);
+            out.put<unsigned int>(static_cast<unsigned int>(contour.points.size()));
+            for (const glm::vec2& point : contour.points) out.putVec2(point);
+        }
+    }
+    return out.buffer;
+}
+
+bool parseUnit(const std::string& message, FarmJob& job) {
+    WireReader in(message);
+    unsigned int magic = 0, layerCount = 0;
+    unsigned char climb = 0, fitArcs = 0;
+    if (!in.get(magic) || magic != UNIT_MAGIC) return false;
+    bool ok = in.get(job.profile.toolRadius) && in.get(job.profile.feedrate) && in.get(job.profile.plungeFeedrate)
+        && in.get(job.profile.clearance) && in.get(climb) && in.get(fitArcs) && in.get(job.arcFit.tolerance)
+        && in.get(job.arcFit.minSegments) && in.get(job.arcFit.minRadius) && in.get(job.arcFit.maxRadius) && in.get(layerCount);
+    if (!ok) return false;
+    job.profile.climb = climb != 0;
+    job.fitArcs = fitArcs != 0;
+
+    job.layers.resize(layerCount);
+    for (Layer& layer : job.layers) {
+        unsigned int contourCount = 0;
+        if (!in.get(layer.height) || !in.get(layer.thickness) || !in.get(contourCount)) return false;
+        layer.contours.resize(contourCount);
+        for (Contour& contour : layer.contours) {
+            unsigned char closed = 0;
+            unsigned int pointCount = 0;
+            if (!in.get(closed) || !in.get(pointCount)) return false;
+            contour.closed = closed != 0;
+            contour.points.resize(pointCount);
+            for (glm::vec2& point : contour.points) {
+                if (!in.getVec2(point)) return false;
+            }
+        }
+    }
+    return in.atEnd();
+}
+
+std::string serializeResult(const std::vector<Toolpath>& toolpaths) {
+    WireWriter out;
+    out.put(RESULT_MAGIC);
+    out.put<unsigned long long>(toolpaths.size());
+    for (const Toolpath& toolpath : toolpaths) {
+        out.putVec3(toolpath.start);
+        out.put<unsigned long long>(toolpath.moves.size());
+        for (const ToolpathMove& move : toolpath.moves) {
+            out.put<unsigned char>(static_cast<unsigned char>(move.type));
+            out.putVec3(move.target);
+            out.put(move.feedrate);
+            out.putVec3(move.center);
+        }
+    }
+    return out.buffer;
+}
+
+bool parseResult(const std::string& message, std::vector<Toolpath>& toolpaths) {
+    WireReader in(message);
+    unsigned int magic = 0;
+    unsigned long long count = 0;
+    if (!in.get(magic) || magic != RESULT_MAGIC || !in.get(count) || count > message.size()) return false;
+    toolpaths.resize(static_cast<size_t>(count));
+    for (Toolpath& toolpath : toolpaths) {
+        unsigned long long moveCount = 0;
+        if (!in.getVec3(toolpath.start) || !in.get(moveCount) || moveCount > message.size()) return false;
+        toolpath.moves.resize(static_cast<size_t>(moveCount));
+        for (ToolpathMove& move : toolpath.moves) {
+            unsigned char type = 0;
+            if (!in.get(type) || type > static_cast<unsigned char>(MoveType::ArcCCW)) return false;
+            move.type = static_cast<MoveType>(type);
+            if (!in.getVec3(move.target) || !in.get(move.feedrate) || !in.getVec3(move.center)) return false;
+        }
+    }
+    return in.atEnd();
+}
+
+// The coordinator's pipe I/O gives up at a deadline (Deadline::max() waits forever); the
+// worker's own reads and writes pass none and simply block
+typedef std::chrono::steady_clock::time_point Deadline;
+
+// Milliseconds left before the deadline, or -1 for none
+long long millisecondsLeft(const Deadline& deadline) {
+    if (deadline == Deadline::max()) return -1;
+    auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    return std::max<long long>(0, left.count());
+}
+
+#ifdef _WIN32
+typedef HANDLE PipeHandle;
+const PipeHandle NO_PIPE = NULL;
+
+// Anonymous pipes cannot do overlapped I/O, so the coordinator's end of each worker pipe is
+// a named pipe instance opened with FILE_FLAG_OVERLAPPED; the child gets an ordinary
+// inheritable handle to the other end
+bool createWorkerPipe(PipeHandle& coordinatorEnd, HANDLE& childEnd, bool childReads) {
+    static std::atomic<unsigned int> serial{ 0 };
+    std::string name = "\\\\.\\pipe\\camsw1-worker-" + std::to_string(GetCurrentProcessId()) + "-" + std::to_string(serial++);
+    DWORD access = (childReads ? PIPE_ACCESS_OUTBOUND : PIPE_ACCESS_INBOUND) | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE;
+    coordinatorEnd = CreateNamedPipeA(name.c_str(), access, PIPE_TYPE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS, 1, 1 << 16, 1 << 16, 0, NULL);
+    if (coordinatorEnd == INVALID_HANDLE_VALUE) {
+        coordinatorEnd = NULL;
+        return false;
+    }
+    SECURITY_ATTRIBUTES inherit = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+    childEnd = CreateFileA(name.c_str(), childReads ? GENERIC_READ : GENERIC_WRITE, 0, &inherit, OPEN_EXISTING, 0, NULL);
+    if (childEnd == INVALID_HANDLE_VALUE) {
+        childEnd = NULL;
+        CloseHandle(coordinatorEnd);
+        coordinatorEnd = NULL;
+        return false;
+    }
+    return true;
+}
+
+// One overlapped read or write; cancelled when the deadline passes first
+bool transferBefore(PipeHandle pipe, char* bytes, DWORD request, bool write, const Deadline& deadline, DWORD& done) {
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (!overlapped.hEvent) return false;
+    BOOL started = write ? WriteFile(pipe, bytes, request, NULL, &overlapped) : ReadFile(pipe, bytes, request, NULL, &overlapped);
+    bool ok = started || GetLastError() == ERROR_IO_PENDING;
+    if (ok) {
+        long long left = millisecondsLeft(deadline);
+        DWORD timeout = left < 0 ? INFINITE : static_cast<DWORD>(std::min<long long>(left, INFINITE - 1));
+        if (WaitForSingleObject(overlapped.hEvent, timeout) != WAIT_OBJECT_0) {
+            CancelIo(pipe);
+            GetOverlappedResult(pipe, &overlapped, &done, TRUE);
+            ok = false;
+        }
+        else {
+            ok = GetOverlappedResult(pipe, &overlapped, &done, FALSE) && done > 0;
+        }
+    }
+    CloseHandle(overlapped.hEvent);
+    return ok;
+}
+
+bool readPipe(PipeHandle pipe, void* data, size_t size, const Deadline* deadline = nullptr) {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        DWORD done = 0;
+        DWORD request = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+        if (deadline ? !transferBefore(pipe, bytes, request, false, *deadline, done) : !ReadFile(pipe, bytes, request, &done, NULL) || done == 0) return false;
+        bytes += done;
+        size -= done;
+    }
+    return true;
+}
+
+bool writePipe(PipeHandle pipe, const void* data, size_t size, const Deadline* deadline = nullptr) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        DWORD done = 0;
+        DWORD request = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+        if (deadline ? !transferBefore(pipe, const_cast<char*>(bytes), request, true, *deadline, done) : !WriteFile(pipe, bytes, request, &done, NULL) || done == 0) return false;
+        bytes += done;
+        size -= done;
+    }
+    return true;
+}
+
+void closePipe(PipeHandle& pipe) {
+    if (pipe) CloseHandle(pipe);
+    pipe = NULL;
+}
+#else
+typedef int PipeHandle;
+const PipeHandle NO_PIPE = -1;
+
+// Waits until the pipe is ready for the transfer; false once the deadline has passed
+bool waitPipe(PipeHandle pipe, short events, const Deadline& deadline) {
+    while (true) {
+        pollfd entry = { pipe, events, 0 };
+        long long left = millisecondsLeft(deadline);
+        int ready = ::poll(&entry, 1, left < 0 ? -1 : static_cast<int>(std::min<long long>(left, INT_MAX)));
+        if (ready < 0 && errno == EINTR) continue;
+        return ready > 0;   // Errors and hang-ups show up in the read or write that follows
+    }
+}
+
+bool readPipe(PipeHandle pipe, void* data, size_t size, const Deadline* deadline = nullptr) {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        if (deadline && !waitPipe(pipe, POLLIN, *deadline)) return false;
+        ssize_t done = ::read(pipe, bytes, size);
+        if (done < 0 && errno == EINTR) continue;
+        if (done <= 0) return false;
+        bytes += done;
+        size -= size_t(done);
+    }
+    return true;
+}
+
+bool writePipe(PipeHandle pipe, const void* data, size_t size, const Deadline* deadline = nullptr) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        if (deadline && !waitPipe(pipe, POLLOUT, *deadline)) return false;
+        ssize_t done = ::write(pipe, bytes, size);
+        if (done < 0 && errno == EINTR) continue;
+        if (done <= 0) return false;
+        bytes += done;
+        size -= size_t(done);
+    }
+    return true;
+}
+
+void closePipe(PipeHandle& pipe) {
+    if (pipe >= 0) ::close(pipe);
+    pipe = -1;
+}
+#endif
+
+// Messages are a 64-bit length followed by the payload
+bool readMessage(PipeHandle pipe, std::string& message, const Deadline* deadline = nullptr) {
+    unsigned long long size = 0;
+    if (!readPipe(pipe, &size, sizeof(size), deadline) || size > MAX_MESSAGE) return false;
+    message.resize(static_cast<size_t>(size));
+    return size == 0 || readPipe(pipe, &message[0], message.size(), deadline);
+}
+
+bool writeMessage(PipeHandle pipe, const std::string& message, const Deadline* deadline = nullptr) {
+    unsigned long long size = message.size();
+    return writePipe(pipe, &size, sizeof(size), deadline) && writePipe(pipe, message.data(), message.size(), deadline);
+}
+
+std::string executablePath() {
+#ifdef _WIN32
+    char path[MAX_PATH];
+    DWORD length = GetModuleFileNameA(NULL, path, MAX_PATH);
+    return std::string(path, length);
+#else
+    char path[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    return length > 0 ? std::string(path, size_t(length)) : std::string();
+#endif
+}
+
+// Spawns are serialized so that no child inherits the pipe ends of a sibling
+std::mutex spawnMutex;
+
+// One worker process and the coordinator's ends of its pipes
+class WorkerProcess {
+public:
+    ~WorkerProcess() { stop(false); }
+
+    bool isRunning() const { return toWorker != NO_PIPE; }
+
+    bool spawn(const std::string& executable) {
+        std::lock_guard<std::mutex> lock(spawnMutex);
+#ifdef _WIN32
+        HANDLE childIn = NULL, childOut = NULL;
+        if (!createWorkerPipe(toWorker, childIn, true)) return false;
+        if (!createWorkerPipe(fromWorker, childOut, false)) {
+            CloseHandle(childIn);
+            closePipe(toWorker);
+            return false;
+        }
+
+        STARTUPINFOA startup = {};
+        startup.cb = sizeof(startup);
+        startup.dwFlags = STARTF_USESTDHANDLES;
+        startup.hStdInput = childIn;
+        startup.hStdOutput = childOut;
+        startup.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+        PROCESS_INFORMATION info = {};
+        std::string commandLine = "\"" + executable + "\" --worker";
+        BOOL created = CreateProcessA(executable.c_str(), &commandLine[0], NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &startup, &info);
+        CloseHandle(childIn);
+        CloseHandle(childOut);
+        if (!created) {
+            std::cerr << "Error: Could not start worker " << executable << std::endl;
+            closePipe(toWorker);
+            closePipe(fromWorker);
+            return false;
+        }
+        CloseHandle(info.hThread);
+        process = info.hProcess;
+#else
+        int input[2], output[2];
+        if (pipe(input) != 0) return false;
+        if (pipe(output) != 0) {
+            ::close(input[0]);
+            ::close(input[1]);
+            return false;
+        }
+        fcntl(input[1], F_SETFD, FD_CLOEXEC);
+        fcntl(output[0], F_SETFD, FD_CLOEXEC);
+
+        pid_t child = fork();
+        if (child == 0) {
+            dup2(input[0], STDIN_FILENO);
+            dup2(output[1], STDOUT_FILENO);
+            ::close(input[0]);
+            ::close(output[1]);
+            execl(executable.c_str(), executable.c_str(), "--worker", (char*)NULL);
+            _exit(127);
+        }
+        ::close(input[0]);
+        ::close(output[1]);
+        if (child < 0) {
+            std::cerr << "Error: Could not start worker " << executable << std::endl;
+            ::close(input[1]);
+            ::close(output[0]);
+            return false;
+        }
+        toWorker = input[1];
+        fromWorker = output[0];
+        process = child;
+#endif
+        return true;
+    }
+
+    // Sends a unit and waits for its result; false when the worker died, answered garbage or
+    // missed the deadline
+    bool run(const std::string& request, std::string& response, const Deadline& deadline) {
+        return writeMessage(toWorker, request, &deadline) && readMessage(fromWorker, response, &deadline);
+    }
+
+    // Closing stdin ends a healthy worker; a failed one is killed
+    void stop(bool kill) {
+        if (!isRunning()) return;
+        closePipe(toWorker);
+#ifdef _WIN32
+        if (kill) TerminateProcess(process, 1);
+        WaitForSingleObject(process, INFINITE);
+        CloseHandle(process);
+        process = NULL;
+#else
+        if (kill) ::kill(process, SIGKILL);
+        waitpid(process, nullptr, 0);
+        process = -1;
+#endif
+        closePipe(fromWorker);
+    }
+
+private:
+    PipeHandle toWorker = NO_PIPE;
+    PipeHandle fromWorker = NO_PIPE;
+#ifdef _WIN32
+    HANDLE process = NULL;
+#else
+    pid_t process = -1;
+#endif
+};
+
+} // namespace
+
+struct WorkerFarm::Job {
+    std::vector<std::vector<Toolpath>> unitToolpaths;
+    std::promise<FarmResult> promise;
+    std::mutex mutex;
+    size_t remaining = 0;
+    size_t retries = 0;
+    size_t failedUnits = 0;
+};
+
+WorkerFarm::~WorkerFarm() {
+    stop();
+}
+
+bool WorkerFarm::start(const FarmSettings& farmSettings) {
+    if (isRunning()) return true;
+#ifndef _WIN32
+    signal(SIGPIPE, SIG_IGN);   // A dead worker must fail the write, not the coordinator
+#endif
+    settings = farmSettings;
+    settings.layersPerUnit = std::max(1u, settings.layersPerUnit);
+    unsigned int count = settings.workers > 0 ? settings.workers : parallelThreadCount();
+    stopping = false;
+    for (unsigned int i = 0; i < count; i++) {
+        dispatchers.emplace_back(&WorkerFarm::dispatchMain, this);
+    }
+    return true;
+}
+
+void WorkerFarm::stop() {
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        stopping = true;
+    }
+    queueCondition.notify_all();
+    for (std::thread& dispatcher : dispatchers) dispatcher.join();
+    dispatchers.clear();
+}
+
+size_t WorkerFarm::queuedUnits() {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return queue.size();
+}
+
+std::future<FarmResult> WorkerFarm::submit(FarmJob farmJob) {
+    std::shared_ptr<Job> job = std::make_shared<Job>();
+    std::future<FarmResult> future = job->promise.get_future();
+
+    size_t unitCount = (farmJob.layers.size() + settings.layersPerUnit - 1) / settings.layersPerUnit;
+    if (unitCount == 0 || !isRunning()) {
+        FarmResult result;
+        result.ok = unitCount == 0;
+        job->promise.set_value(result);
+        return future;
+    }
+    job->unitToolpaths.resize(unitCount);
+    job->remaining = unitCount;
+
+    // Serialize on the caller's thread; the job's layers are not kept after this
+    std::vector<Unit> units(unitCount);
+    parallelFor(unitCount, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            size_t first = i * settings.layersPerUnit;
+            size_t last = std::min(farmJob.layers.size(), first + settings.layersPerUnit);
+            units[i].job = job;
+            units[i].index = i;
+            units[i].request = serializeUnit(farmJob, first, last);
+        }
+    }, 1);
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        for (Unit& unit : units) queue.push_back(std::move(unit));
+    }
+    queueCondition.notify_all();
+    return future;
+}
+
+void WorkerFarm::dispatchMain() {
+    std::string executable = executablePath();
+    WorkerProcess worker;
+    std::string response;
+
+    while (true) {
+        Unit unit;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queueCondition.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (queue.empty()) break;
+            unit = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        std::vector<Toolpath> toolpaths;
+        bool ok = worker.isRunning() || worker.spawn(executable);
+        Deadline deadline = settings.unitTimeoutMs > 0
+            ? std::chrono::steady_clock::now() + std::chrono::milliseconds(settings.unitTimeoutMs) : Deadline::max();
+        ok = ok && worker.run(unit.request, response, deadline) && parseResult(response, toolpaths);
+        if (!ok) {
+            // The worker crashed, hung or is out of step; replace it and retry the unit elsewhere
+            if (deadline != Deadline::max() && std::chrono::steady_clock::now() >= deadline) {
+                std::cerr << "Error: Work unit " << unit.index << " timed out after " << settings.unitTimeoutMs << " ms" << std::endl;
+            }
+            failures++;
+            worker.stop(true);
+            if (unit.attempts < settings.maxRetries) {
+                unit.attempts++;
+                {
+                    std::lock_guard<std::mutex> lock(unit.job->mutex);
+                    unit.job->retries++;
+                }
+                std::lock_guard<std::mutex> lock(queueMutex);
+                queue.push_back(std::move(unit));
+                queueCondition.notify_one();
+                continue;
+            }
+            std::cerr << "Error: Work unit " << unit.index << " failed after " << unit.attempts + 1 << " attempts" << std::endl;
+        }
+        finishUnit(unit, ok, toolpaths);
+    }
+    worker.stop(false);
+}
+
+void WorkerFarm::finishUnit(const Unit& unit, bool ok, std::vector<Toolpath>& toolpaths) {
+    Job& job = *unit.job;
+    std::lock_guard<std::mutex> lock(job.mutex);
+    job.unitToolpaths[unit.index] = std::move(toolpaths);
+    if (!ok) job.failedUnits++;
+    if (--job.remaining > 0) return;
+
+    // Units are bottom-up and each one is cut top-down, so the top unit comes first
+    FarmResult result;
+    result.units = job.unitToolpaths.size();
+    result.retries = job.retries;
+    result.failedUnits = job.failedUnits;
+    result.ok = job.failedUnits == 0;
+    for (size_t i = job.unitToolpaths.size(); i-- > 0;) {
+        for (Toolpath& toolpath : job.unitToolpaths[i]) result.toolpaths.push_back(std::move(toolpath));
+    }
+    job.unitToolpaths.clear();
+    job.promise.set_value(std::move(result));
+}
+
+int runToolpathWorker() {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+    PipeHandle input = GetStdHandle(STD_INPUT_HANDLE);
+    PipeHandle output = GetStdHandle(STD_OUTPUT_HANDLE);
+#else
+    PipeHandle input = STDIN_FILENO;
+    PipeHandle output = STDOUT_FILENO;
+#endif
+    // The pool already has one process per core
+    parallelThreadLimit() = 1;
+
+    std::string message;
+    while (readMessage(input, message)) {
+        FarmJob job;
+        if (!parseUnit(message, job)) {
+            std::cerr << "Error: Worker received a malformed work unit" << std::endl;
+            return 1;
+        }
+        std::vector<Toolpath> toolpaths = generateProfileToolpaths(job.layers, job.profile);
+        if (job.fitArcs) {
+            toolpaths = fitArcs(toolpaths, job.arcFit);
+        }
+        if (!writeMessage(output, serializeResult(toolpaths))) {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+// workerfarm.h
+#ifndef WORKERFARM_H
+#define WORKERFARM_H
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "slicer.h"
+#include "toolpath.h"
+#include "arcfit.h"
+
+// Runs toolpath jobs in a pool of worker processes, so one machine's cores are used by many
+// address spaces and a crash only costs the work unit that caused it. Workers are this
+// executable started with "--worker"; they read work units from stdin and write results to
+// stdout through anonymous pipes. A job is split into units of consecutive layers, units of
+// all queued jobs share the pool, and units whose worker dies or overruns its deadline are
+// retried on a fresh one.
+
+struct FarmSettings {
+    unsigned int workers = 0;           // Worker processes (0 = one per hardware thread)
+    unsigned int layersPerUnit = 4;
+    unsigned int maxRetries = 2;        // Further attempts after a unit's worker failed
+    unsigned int unitTimeoutMs = 120000;    // A worker still busy with a unit after this is killed (0 = no limit)
+};
+
+struct FarmJob {
+    std::vector<Layer> layers;          // Bottom-up, as the slicer returns them
+    ProfileSettings profile;
+    bool fitArcs = false;
+    ArcFitSettings arcFit;
+};
+
+struct FarmResult {
+    bool ok = false;                    // False when some unit failed after all retries
+    std::vector<Toolpath> toolpaths;    // Same order as generateProfileToolpaths (top-down)
+    size_t units = 0;
+    size_t retries = 0;
+    size_t failedUnits = 0;
+};
+
+class WorkerFarm {
+public:
+    WorkerFarm() = default;
+    ~WorkerFarm();
+
+    WorkerFarm(const WorkerFarm&) = delete;
+    WorkerFarm& operator=(const WorkerFarm&) = delete;
+
+    // Starts the dispatch threads; each launches its worker process on first use
+    bool start(const FarmSettings& settings = FarmSettings());
+
+    // Finishes the queued units, then shuts the workers down
+    void stop();
+
+    // Queues a job; the future is ready once every unit has been merged or given up
+    std::future<FarmResult> submit(FarmJob job);
+
+    bool isRunning() const { return !dispatchers.empty(); }
+    size_t workerCount() const { return dispatchers.size(); }
+    size_t queuedUnits();
+    size_t workerFailures() const { return failures; }
+
+private:
+    struct Job;
+
+    struct Unit {
+        std::shared_ptr<Job> job;
+        size_t index = 0;               // Position in the job, bottom-up
+        std::string request;            // Serialized work unit
+        unsigned int attempts = 0;
+    };
+
+    void dispatchMain();
+    void finishUnit(const Unit& unit, bool ok, std::vector<Toolpath>& toolpaths);
+
+    FarmSettings settings;
+    std::vector<std::thread> dispatchers;   // One per worker process
+    std::deque<Unit> queue;
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    bool stopping = false;
+    std::atomic<size_t> failures{ 0 };
+};
+
+// Entry point of "--worker": serves work units from stdin until it is closed
+int runToolpathWorker();
+
+#endif // WORKERFARM_H